@@ -0,0 +1,103 @@
+#include <bench/bench.h>
+#include <bench/tradelayer_util.h>
+
+#include <tradelayer/mdex.h>
+#include <tradelayer/tally.h>
+#include <tradelayer/tradelayer.h>
+#include <tradelayer/tx.h>
+
+#include <amount.h>
+#include <arith_uint256.h>
+#include <uint256.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <string>
+
+using namespace mastercore;
+
+/** Number of price levels of the synthetic order books. */
+static const int BOOK_DEPTH = 1000;
+/** Amount of every order of the synthetic order books. */
+static const int64_t ORDER_AMOUNT = 1000;
+/** Balance given to every trader, large enough for all iterations. */
+static const int64_t TRADER_BALANCE = 1000000000 * COIN;
+/** Best price of the synthetic ContractDEx books. */
+static const uint64_t CONTRACT_PRICE = 100 * COIN;
+/** Distance between two price levels of the synthetic ContractDEx books. */
+static const uint64_t CONTRACT_TICK = COIN / 100;
+
+static uint256 BenchTxid(uint64_t n)
+{
+    return ArithToUint256(arith_uint256(n));
+}
+
+// Matches a taker against the best level of a MetaDEx book with 1000 price
+// levels, then refills that level, so the depth stays the same.
+static void TradeLayerMetaDExMatching(benchmark::State& state)
+{
+    TradeLayerBenchSetup setup;
+
+    const uint32_t propertyForSale = 3;
+    const uint32_t propertyDesired = 4;
+    const std::string maker = BenchAddress(1);
+    const std::string taker = BenchAddress(2);
+    const std::string sentinel = BenchAddress(3);
+    uint64_t nTx = 0;
+
+    assert(update_tally_map(maker, propertyForSale, TRADER_BALANCE, BALANCE));
+    assert(update_tally_map(taker, propertyDesired, TRADER_BALANCE, BALANCE));
+    assert(update_tally_map(sentinel, propertyDesired, ORDER_AMOUNT, BALANCE));
+
+    // an order, which is never matched, so the makers always find a book of the other side
+    assert(0 == MetaDEx_ADD(sentinel, propertyDesired, ORDER_AMOUNT, TL_BENCH_BLOCK, propertyForSale, TRADER_BALANCE, BenchTxid(++nTx), 0));
+
+    for (int i = 0; i < BOOK_DEPTH; ++i) {
+        assert(0 == MetaDEx_ADD(maker, propertyForSale, ORDER_AMOUNT, TL_BENCH_BLOCK, propertyDesired, ORDER_AMOUNT + i, BenchTxid(++nTx), 0));
+    }
+
+    while (state.KeepRunning()) {
+        MetaDEx_ADD(taker, propertyDesired, ORDER_AMOUNT, TL_BENCH_BLOCK, propertyForSale, ORDER_AMOUNT, BenchTxid(++nTx), 0);
+        MetaDEx_ADD(maker, propertyForSale, ORDER_AMOUNT, TL_BENCH_BLOCK, propertyDesired, ORDER_AMOUNT, BenchTxid(++nTx), 0);
+    }
+}
+
+/** Fills one side of a ContractDEx book with orders at increasingly worse prices. */
+static void FillContractBook(const std::string& maker, uint32_t contractId, uint8_t tradingAction, uint64_t& nTx)
+{
+    for (int i = 0; i < BOOK_DEPTH; ++i) {
+        const uint64_t price = (tradingAction == SELL) ? CONTRACT_PRICE + i * CONTRACT_TICK : CONTRACT_PRICE - i * CONTRACT_TICK;
+        CMPContractDex order(maker, TL_BENCH_BLOCK, contractId, ORDER_AMOUNT, 0, 0, BenchTxid(++nTx), 0, CMPTransaction::ADD, price, tradingAction);
+        assert(ContractDex_INSERT(order));
+    }
+}
+
+// Buys from the best ask of one contract and sells to the best bid of another
+// one, each book having 1000 price levels, then refills both levels.
+static void TradeLayerContractDExMatching(benchmark::State& state)
+{
+    TradeLayerBenchSetup setup;
+
+    const uint32_t contractAsks = BenchCreateContract();
+    const uint32_t contractBids = BenchCreateContract();
+    const std::string maker = BenchAddress(1);
+    const std::string taker = BenchAddress(2);
+    uint64_t nTx = 0;
+
+    assert(update_tally_map(maker, TL_BENCH_COLLATERAL, TRADER_BALANCE, BALANCE));
+    assert(update_tally_map(taker, TL_BENCH_COLLATERAL, TRADER_BALANCE, BALANCE));
+
+    FillContractBook(maker, contractAsks, SELL, nTx);
+    FillContractBook(maker, contractBids, BUY, nTx);
+
+    while (state.KeepRunning()) {
+        ContractDex_ADD(taker, contractAsks, ORDER_AMOUNT, TL_BENCH_BLOCK, BenchTxid(++nTx), 0, CONTRACT_PRICE, BUY, 0);
+        ContractDex_INSERT(CMPContractDex(maker, TL_BENCH_BLOCK, contractAsks, ORDER_AMOUNT, 0, 0, BenchTxid(++nTx), 0, CMPTransaction::ADD, CONTRACT_PRICE, SELL));
+
+        ContractDex_ADD(taker, contractBids, ORDER_AMOUNT, TL_BENCH_BLOCK, BenchTxid(++nTx), 0, CONTRACT_PRICE, SELL, 0);
+        ContractDex_INSERT(CMPContractDex(maker, TL_BENCH_BLOCK, contractBids, ORDER_AMOUNT, 0, 0, BenchTxid(++nTx), 0, CMPTransaction::ADD, CONTRACT_PRICE, BUY));
+    }
+}
+
+BENCHMARK(TradeLayerMetaDExMatching, 2000);
+BENCHMARK(TradeLayerContractDExMatching, 500);
@@ -0,0 +1,56 @@
+#include <bench/bench.h>
+#include <bench/tradelayer_util.h>
+
+#include <tradelayer/parsing.h>
+#include <tradelayer/rules.h>
+#include <tradelayer/tradelayer.h>
+#include <tradelayer/tx.h>
+
+#include <coins.h>
+#include <key_io.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <script/standard.h>
+#include <sync.h>
+#include <util/strencodings.h>
+
+#include <assert.h>
+#include <utility>
+
+using namespace mastercore;
+
+// Parses a Class C simple send with a reference output, which spends a cached coin.
+static void TradeLayerParseClassC(benchmark::State& state)
+{
+    TradeLayerBenchSetup setup;
+
+    CMutableTransaction inputTx;
+    inputTx.vout.push_back(CTxOut(6000, GetScriptForDestination(DecodeDestination(BenchAddress(1)))));
+    const CTransaction prevTx(inputTx);
+    {
+        LOCK(cs_tx_cache);
+        Coin coin(prevTx.vout[0], 1, false);
+        view.AddCoin(COutPoint(prevTx.GetHash(), 0), std::move(coin), true);
+    }
+
+    CScript scriptPayload;
+    scriptPayload << OP_RETURN << ParseHex("6f6d6e6900000000000000070000000006dac2c0");
+
+    CMutableTransaction mutableTx;
+    mutableTx.vin.push_back(CTxIn(prevTx.GetHash(), 0));
+    mutableTx.vout.push_back(CTxOut(0, scriptPayload));
+    mutableTx.vout.push_back(CTxOut(6000, GetScriptForDestination(DecodeDestination(BenchAddress(2)))));
+    const CTransaction tx(mutableTx);
+
+    const int nBlock = ConsensusParams().NULLDATA_BLOCK + 1000;
+
+    while (state.KeepRunning()) {
+        CMPTransaction metaTx;
+        ParseTransaction(tx, nBlock, 1, metaTx);
+    }
+
+    LOCK(cs_tx_cache);
+    view.Flush();
+}
+
+BENCHMARK(TradeLayerParseClassC, 50 * 1000);
@@ -0,0 +1,71 @@
+#include <bench/bench.h>
+#include <bench/tradelayer_util.h>
+
+#include <tradelayer/mdex.h>
+#include <tradelayer/operators_algo_clearing.h>
+#include <tradelayer/tally.h>
+#include <tradelayer/tradelayer.h>
+#include <tradelayer/tradelayer_matrices.h>
+
+#include <amount.h>
+#include <arith_uint256.h>
+#include <uint256.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace mastercore;
+
+extern int n_cols;
+extern int n_rows;
+extern MatrixTLS *pt_ndatabase;
+extern std::vector<std::map<std::string, std::string>> path_elef;
+
+/** Number of traders, which open and net positions against each other. */
+static const int SETTLEMENT_TRADERS = 8;
+/** Number of matched trades of the synthetic history. */
+static const int SETTLEMENT_TRADES = 200;
+
+// Runs the FIFO settlement over the edges recorded by 200 ContractDEx trades
+// between 8 traders.
+static void TradeLayerSettlementFIFO(benchmark::State& state)
+{
+    TradeLayerBenchSetup setup;
+
+    const uint32_t contractId = BenchCreateContract();
+    const int64_t amount = 1000;
+    const uint64_t basePrice = 100 * COIN;
+    uint64_t nTx = 0;
+
+    for (int i = 0; i < SETTLEMENT_TRADERS; ++i) {
+        assert(update_tally_map(BenchAddress(i), TL_BENCH_COLLATERAL, 1000000 * COIN, BALANCE));
+    }
+
+    // the buyer index is always different from the seller's, because 2i+1 is odd
+    for (int i = 0; i < SETTLEMENT_TRADES; ++i) {
+        const std::string seller = BenchAddress(i % SETTLEMENT_TRADERS);
+        const std::string buyer = BenchAddress((i * 3 + 1) % SETTLEMENT_TRADERS);
+        const uint64_t price = basePrice + (i % 7) * (COIN / 10);
+
+        ContractDex_ADD(seller, contractId, amount, TL_BENCH_BLOCK, ArithToUint256(arith_uint256(++nTx)), 0, price, SELL, 0);
+        ContractDex_ADD(buyer, contractId, amount, TL_BENCH_BLOCK, ArithToUint256(arith_uint256(++nTx)), 0, price, BUY, 0);
+    }
+
+    n_rows = path_elef.size();
+    MatrixTLS M_file(n_rows, n_cols);
+    MatrixTLS database(n_rows, n_cols);
+    pt_ndatabase = &database;
+
+    while (state.KeepRunning()) {
+        fillingMatrix(M_file, database, path_elef);
+        settlement_algorithm_fifo(M_file, 0, basePrice);
+    }
+
+    pt_ndatabase = nullptr;
+    n_rows = 0;
+}
+
+BENCHMARK(TradeLayerSettlementFIFO, 20);
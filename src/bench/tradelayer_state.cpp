@@ -0,0 +1,131 @@
+#include <bench/bench.h>
+#include <bench/tradelayer_util.h>
+
+#include <tradelayer/consensushash.h>
+#include <tradelayer/persistence.h>
+#include <tradelayer/tally.h>
+#include <tradelayer/tradelayer.h>
+
+#include <amount.h>
+#include <arith_uint256.h>
+#include <chain.h>
+#include <fs.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <validation.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace mastercore;
+
+extern fs::path pathStateFiles;
+
+/** Number of addresses of the synthetic tally. */
+static const int TALLY_ADDRESSES = 10000;
+/** Number of properties held by every address of the synthetic tally. */
+static const uint32_t TALLY_PROPERTIES = 4;
+
+/** Credits every address of the synthetic tally, some of them with reserved tokens. */
+static void FillTally()
+{
+    for (int i = 0; i < TALLY_ADDRESSES; ++i) {
+        const std::string address = BenchAddress(i);
+        for (uint32_t propertyId = 1; propertyId <= TALLY_PROPERTIES; ++propertyId) {
+            assert(update_tally_map(address, propertyId, COIN + i, BALANCE));
+            if (i % 10 == 0) {
+                assert(update_tally_map(address, propertyId, i + 1, METADEX_RESERVE));
+            }
+        }
+    }
+}
+
+// Credits and debits an address of a tally with 10000 entries.
+static void TradeLayerUpdateTally(benchmark::State& state)
+{
+    TradeLayerBenchSetup setup;
+    FillTally();
+
+    std::vector<std::string> addresses;
+    for (int i = 0; i < TALLY_ADDRESSES; ++i) {
+        addresses.push_back(BenchAddress(i));
+    }
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        const std::string& address = addresses[n++ % addresses.size()];
+        update_tally_map(address, TL_PROPERTY_ALL, COIN, BALANCE);
+        update_tally_map(address, TL_PROPERTY_ALL, -COIN, BALANCE);
+    }
+}
+
+static void TradeLayerConsensusHash(benchmark::State& state)
+{
+    TradeLayerBenchSetup setup;
+    FillTally();
+
+    while (state.KeepRunning()) {
+        GetConsensusHash();
+    }
+}
+
+/**
+ * Registers a block index for the state files, because files of unknown
+ * blocks are pruned right after they were written.
+ */
+class BenchBlockIndex
+{
+private:
+    const uint256 hash;
+
+public:
+    CBlockIndex index;
+
+    BenchBlockIndex() : hash(ArithToUint256(arith_uint256(TL_BENCH_BLOCK)))
+    {
+        LOCK(cs_main);
+        index.nHeight = TL_BENCH_BLOCK;
+        index.phashBlock = &(mapBlockIndex.emplace(hash, &index).first->first);
+    }
+
+    ~BenchBlockIndex()
+    {
+        LOCK(cs_main);
+        mapBlockIndex.erase(hash);
+    }
+};
+
+static void TradeLayerPersistState(benchmark::State& state)
+{
+    TradeLayerBenchSetup setup;
+    BenchBlockIndex blockIndex;
+    FillTally();
+
+    while (state.KeepRunning()) {
+        PersistInMemoryState(&blockIndex.index);
+        FlushStatePersistence();
+    }
+}
+
+static void TradeLayerRestoreState(benchmark::State& state)
+{
+    TradeLayerBenchSetup setup;
+    BenchBlockIndex blockIndex;
+    FillTally();
+
+    assert(0 == PersistInMemoryState(&blockIndex.index));
+    FlushStatePersistence();
+    const fs::path path = pathStateFiles / strprintf("balances-%s.dat", blockIndex.index.GetBlockHash().ToString());
+
+    while (state.KeepRunning()) {
+        RestoreInMemoryState(path.string(), 0 /* balances */, true);
+    }
+}
+
+BENCHMARK(TradeLayerUpdateTally, 500 * 1000);
+BENCHMARK(TradeLayerConsensusHash, 20);
+BENCHMARK(TradeLayerPersistState, 20);
+BENCHMARK(TradeLayerRestoreState, 20);
@@ -0,0 +1,144 @@
+#include <bench/tradelayer_util.h>
+
+#include <tradelayer/dbspinfo.h>
+#include <tradelayer/dbstolist.h>
+#include <tradelayer/dbtradelist.h>
+#include <tradelayer/dbtransaction.h>
+#include <tradelayer/dbtxlist.h>
+#include <tradelayer/mdex.h>
+#include <tradelayer/sp.h>
+#include <tradelayer/tradelayer.h>
+#include <tradelayer/tradelayer_matrices.h>
+
+#include <amount.h>
+#include <chainparams.h>
+#include <chainparamsbase.h>
+#include <crypto/common.h>
+#include <fs.h>
+#include <key_io.h>
+#include <pubkey.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace mastercore;
+
+extern fs::path pathStateFiles;
+extern std::vector<std::map<std::string, std::string>> path_elef;
+extern std::map<uint32_t, std::vector<int64_t>> mapContractAmountTimesPrice;
+extern std::map<uint32_t, std::vector<int64_t>> mapContractVolume;
+extern std::map<uint32_t, int64_t> cachefees;
+
+/** Sets the global parameters, which are initialized by bitcoind's main() otherwise. */
+static void InitialConditions()
+{
+    static bool fInitialized = false;
+    if (fInitialized) return;
+    fInitialized = true;
+
+    extern int64_t factorE;
+    extern int64_t priceIndex;
+    extern int64_t allPrice;
+    extern double denMargin;
+    extern int n_cols;
+    extern int nVestingAddrs;
+    extern int64_t amountVesting;
+    extern int64_t totalVesting;
+    extern int volumeToVWAP;
+    extern int BlockS;
+    extern VectorTLS *pt_open_incr_long;
+    extern VectorTLS *pt_open_incr_short;
+    extern VectorTLS *pt_netted_npartly_long;
+    extern VectorTLS *pt_netted_npartly_short;
+    extern VectorTLS *pt_open_incr_anypos;
+    extern VectorTLS *pt_netted_npartly_anypos;
+    extern VectorTLS *pt_changepos_status;
+    extern VectorTLS *pt_expiration_dates;
+    extern std::string admin_addrs;
+    extern double CompoundRate;
+    extern double DecayRate;
+    extern double LongTailDecay;
+    extern int64_t SatoshiH;
+
+#include "initial_conditions.h"
+}
+
+/** Removes all balances, orders and trade history from memory. */
+static void ClearState()
+{
+    LOCK(cs_tally);
+
+    mp_tally_map.clear();
+    mapPropertyHolders.clear();
+    metadex.clear();
+    contractdex.clear();
+    path_elef.clear();
+    mapContractAmountTimesPrice.clear();
+    mapContractVolume.clear();
+    cachefees.clear();
+}
+
+TradeLayerBenchSetup::TradeLayerBenchSetup()
+{
+    SelectParams(CBaseChainParams::MAIN);
+    InitialConditions();
+
+    pDbTradeList = new CMPTradeList(GetDataDir() / "MP_tradelist", true);
+    pDbStoList = new CMPSTOList(GetDataDir() / "MP_stolist", true);
+    pDbTransactionList = new CMPTxList(GetDataDir() / "MP_txlist", true);
+    pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo", true);
+    pDbTransaction = new CTLTransactionDB(GetDataDir() / "TL_TXDB", true);
+
+    pathStateFiles = GetDataDir() / "MP_persist";
+    fs::create_directories(pathStateFiles);
+
+    ClearState();
+}
+
+TradeLayerBenchSetup::~TradeLayerBenchSetup()
+{
+    ClearState();
+
+    delete pDbTradeList;
+    pDbTradeList = nullptr;
+    delete pDbStoList;
+    pDbStoList = nullptr;
+    delete pDbTransactionList;
+    pDbTransactionList = nullptr;
+    delete pDbSpInfo;
+    pDbSpInfo = nullptr;
+    delete pDbTransaction;
+    pDbTransaction = nullptr;
+}
+
+std::string BenchAddress(uint32_t n)
+{
+    uint160 hash;
+    WriteLE32(hash.begin(), n + 1);
+    return EncodeDestination(CKeyID(hash));
+}
+
+uint32_t BenchCreateContract()
+{
+    CMPSPInfo::Entry sp;
+    sp.issuer = BenchAddress(1000000);
+    sp.prop_type = ALL_PROPERTY_TYPE_ORACLE_CONTRACT;
+    sp.name = "ALL F18";
+    sp.num_tokens = 0;
+    sp.blocks_until_expiration = 100000;
+    sp.notional_size = COIN;
+    sp.collateral_currency = TL_BENCH_COLLATERAL;
+    sp.margin_requirement = COIN;
+    sp.init_block = TL_BENCH_BLOCK;
+    sp.denomination = 0;
+    sp.oracle_high = 0;
+    sp.oracle_low = 0;
+    sp.oracle_last_update = 0;
+
+    return pDbSpInfo->putSP(TL_PROPERTY_MSC, sp);
+}
@@ -0,0 +1,33 @@
+#ifndef BITCOIN_BENCH_TRADELAYER_UTIL_H
+#define BITCOIN_BENCH_TRADELAYER_UTIL_H
+
+#include <stdint.h>
+#include <string>
+
+/** Block height used by the Trade Layer benchmarks, well before fees are activated. */
+static const int TL_BENCH_BLOCK = 500000;
+
+/** Collateral of the benchmark contracts, the trading fees of which stay in the fee cache. */
+static const uint32_t TL_BENCH_COLLATERAL = 4;
+
+/**
+ * Prepares the Trade Layer globals for a benchmark.
+ *
+ * Selects the main network, opens fresh databases in the benchmark data
+ * directory and clears the in-memory state. Everything is torn down again
+ * when the object goes out of scope.
+ */
+class TradeLayerBenchSetup
+{
+public:
+    TradeLayerBenchSetup();
+    ~TradeLayerBenchSetup();
+};
+
+/** Returns a deterministic, valid address for the given index. */
+std::string BenchAddress(uint32_t n);
+
+/** Registers an oracle contract, which is collateralized with ALL, and returns its identifier. */
+uint32_t BenchCreateContract();
+
+#endif // BITCOIN_BENCH_TRADELAYER_UTIL_H
@@ -555,7 +555,9 @@ void SetupServerArgs()
     // TODO: append help messages somewhere else
     // TODO: translation
     gArgs.AddArg("-startclean", "Clear all persistence files on startup; triggers reparsing of Trade Layer transactions (default: 0)", false, OptionsCategory::OMNI);
-    gArgs.AddArg("-tltxcache", "The maximum number of transactions in the input transaction cache (default: 500000)", false, OptionsCategory::OMNI);
+    gArgs.AddArg("-tltxcache", "The maximum number of transaction inputs in the input cache (default: 500000)", false, OptionsCategory::OMNI);
+    gArgs.AddArg("-tlparsedtxcache", "The maximum number of parsed mempool transactions kept until they are confirmed (default: 10000)", false, OptionsCategory::OMNI);
+    gArgs.AddArg("-tlstatebaseinterval", "Write full state files every n blocks, and only the changed lines in between (default: 0, always write full state files, at most: 1000)", false, OptionsCategory::OMNI);
     gArgs.AddArg("-tlprogressfrequency", "Time in seconds after which the initial scanning progress is reported (default: 30)", false, OptionsCategory::OMNI);
     gArgs.AddArg("-tlseedblockfilter", "Set skipping of blocks without Trade Layer transactions during initial scan (default: 1)", false, OptionsCategory::OMNI);
     gArgs.AddArg("-tllogfile", "The path of the log file (default: tradelayer.log)", false, OptionsCategory::OMNI);
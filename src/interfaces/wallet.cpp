@@ -483,6 +483,12 @@ public:
         }
         return result;
     }
+    std::vector<std::pair<COutPoint, CTxOut>> getAddressOutputs(const CTxDestination& dest) override
+    {
+        auto locked_chain = m_wallet->chain().lock();
+        LOCK(m_wallet->cs_wallet);
+        return m_wallet->GetAddressOutputs(*locked_chain, dest);
+    }
     CAmount getRequiredFee(unsigned int tx_bytes) override { return GetRequiredFee(*m_wallet, tx_bytes); }
     CAmount getMinimumFee(unsigned int tx_bytes,
         const CCoinControl& coin_control,
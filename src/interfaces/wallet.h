@@ -242,6 +242,9 @@ public:
     //! Return wallet transaction output information.
     virtual std::vector<WalletTxOut> getCoins(const std::vector<COutPoint>& outputs) = 0;
 
+    //! Return unspent and unlocked outputs of trusted wallet transactions, which pay to the destination.
+    virtual std::vector<std::pair<COutPoint, CTxOut>> getAddressOutputs(const CTxDestination& dest) = 0;
+
     //! Get required fee.
     virtual CAmount getRequiredFee(unsigned int tx_bytes) = 0;
 
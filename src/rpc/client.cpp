@@ -197,6 +197,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "tl_getfeedistribution", 0, "distributionid" },
     { "tl_getfeedistributions", 0, "propertyid" },
     { "tl_getbalanceshash", 0, "propertyid" },
+    { "tl_getperfstats", 0, "reset" },
+    { "tl_getoracleprices", 0, "contractid" },
+    { "tl_getoracleprices", 1, "count" },
+    { "tl_capturereplay", 1, "startblock" },
+    { "tl_capturereplay", 2, "endblock" },
+    { "tl_capturereplay", 3, "alltransactions" },
     { "tl_getwalletbalances", 0, "includewatchonly" },
     { "tl_getwalletaddressbalances", 0, "includewatchonly" },
 
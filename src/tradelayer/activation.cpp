@@ -8,6 +8,7 @@
 
 #include <tradelayer/activation.h>
 
+#include <tradelayer/blockevents.h>
 #include <tradelayer/log.h>
 #include <tradelayer/version.h>
 
@@ -70,6 +71,7 @@ void AddPendingActivation(uint16_t featureId, int activationBlock, uint32_t minC
     featureActivation.minClientVersion = minClientVersion;
 
     vecPendingActivations.push_back(featureActivation);
+    ScheduleBlockEvent(BLOCK_EVENT_ACTIVATION, activationBlock);
 
     uiInterface.TLStateChanged();
 }
@@ -125,6 +127,7 @@ void ClearActivations()
 {
     vecPendingActivations.clear();
     vecCompletedActivations.clear();
+    ClearBlockEvents(BLOCK_EVENT_ACTIVATION);
     uiInterface.TLStateChanged();
 }
 
@@ -0,0 +1,144 @@
+/**
+ * @file arith128.h
+ *
+ * This file provides 128-bit helpers for the matching and fee calculations.
+ *
+ * The products of two amounts always fit into 128 bits, so the results are
+ * computed without arith_uint256 or rational numbers. The results are exactly
+ * those of the arith_uint256 calculations, which they replace.
+ */
+
+#ifndef BITCOIN_TRADELAYER_ARITH128_H
+#define BITCOIN_TRADELAYER_ARITH128_H
+
+#include <tradelayer/uint256_extensions.h>
+
+#include <arith_uint256.h>
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <assert.h>
+#include <stdint.h>
+#include <limits>
+
+namespace mastercore {
+
+typedef boost::multiprecision::uint128_t uint128;
+
+/** Rounding of the quotient of a division. */
+enum RoundingMode {
+    ROUND_DOWN,     // floor(n / d)
+    ROUND_UP,       // ceil(n / d)
+    ROUND_HALF_UP,  // floor(n / d + 1/2)
+};
+
+namespace arith128_const {
+//! The highest number in range of int64_t as uint128
+static const uint128 max_int64(static_cast<uint64_t>(std::numeric_limits<int64_t>::max()));
+//! The highest number in range of uint128
+static const uint128 max_uint128(std::numeric_limits<uint128>::max());
+}
+
+/**
+ * Converts a positive primitive number to uint128.
+ */
+template<typename NumberT>
+inline uint128 ConvertTo128(const NumberT& number)
+{
+    assert(number >= 0);
+    return uint128(static_cast<uint64_t>(number));
+}
+
+/**
+ * Returns n / d, rounded as specified, of 128-bit numbers.
+ *
+ * Like arith_uint256, a division by zero throws uint_error.
+ */
+inline uint128 Divide128(const uint128& numerator, const uint128& denominator, RoundingMode mode)
+{
+    if (denominator == 0) {
+        throw uint_error("Division by zero");
+    }
+    uint128 quotient = numerator / denominator;
+    const uint128 remainder = numerator - quotient * denominator;
+    switch (mode) {
+        case ROUND_DOWN:
+            break;
+        case ROUND_UP:
+            if (remainder != 0) ++quotient;
+            break;
+        case ROUND_HALF_UP:
+            if (remainder >= denominator - remainder) ++quotient;
+            break;
+    }
+    return quotient;
+}
+
+/**
+ * Computes (a * b) / c of positive primitive numbers, rounded as specified.
+ *
+ * Returns false, if the result is out of range of int64_t.
+ */
+template<typename A, typename B, typename C>
+inline bool MulDivChecked(const A& a, const B& b, const C& c, int64_t& result, RoundingMode mode = ROUND_DOWN)
+{
+    const uint128 quotient = Divide128(ConvertTo128(a) * ConvertTo128(b), ConvertTo128(c), mode);
+    if (quotient > arith128_const::max_int64) {
+        return false;
+    }
+    result = quotient.convert_to<int64_t>();
+    return true;
+}
+
+/**
+ * Returns (a * b) / c of positive primitive numbers, rounded as specified.
+ *
+ * The result must be in range of int64_t.
+ */
+template<typename A, typename B, typename C>
+inline int64_t MulDiv(const A& a, const B& b, const C& c, RoundingMode mode = ROUND_DOWN)
+{
+    int64_t result = 0;
+    bool fInRange = MulDivChecked(a, b, c, result, mode);
+    assert(fInRange);
+    return result;
+}
+
+/**
+ * Returns (a * b * c) / (d * e) of positive primitive numbers, rounded down.
+ *
+ * The numerator may exceed 128 bits, in which case the calculation falls back
+ * to arith_uint256. The result must be in range of int64_t.
+ */
+template<typename A, typename B, typename C, typename D, typename E>
+inline int64_t MulMulDiv(const A& a, const B& b, const C& c, const D& d, const E& e)
+{
+    const uint128 ab = ConvertTo128(a) * ConvertTo128(b);
+    const uint128 uc = ConvertTo128(c);
+    if (uc != 0 && ab > arith128_const::max_uint128 / uc) {
+        return ConvertTo64(ConvertTo256(a) * ConvertTo256(b) * ConvertTo256(c) / (ConvertTo256(d) * ConvertTo256(e)));
+    }
+    const uint128 quotient = Divide128(ab * uc, ConvertTo128(d) * ConvertTo128(e), ROUND_DOWN);
+    assert(quotient <= arith128_const::max_int64);
+    return quotient.convert_to<int64_t>();
+}
+
+/**
+ * Compares the fractions a / b and c / d of non-negative numbers, with
+ * positive denominators.
+ *
+ * Returns -1, 0 or 1, if a / b is less than, equal to, or greater than c / d.
+ */
+inline int CompareFractions(int64_t a, int64_t b, int64_t c, int64_t d)
+{
+    assert(a >= 0 && b > 0 && c >= 0 && d > 0);
+    const uint128 ad = uint128(static_cast<uint64_t>(a)) * static_cast<uint64_t>(d);
+    const uint128 cb = uint128(static_cast<uint64_t>(c)) * static_cast<uint64_t>(b);
+    if (ad < cb) return -1;
+    if (ad > cb) return 1;
+    return 0;
+}
+
+} // namespace mastercore
+
+#endif // BITCOIN_TRADELAYER_ARITH128_H
@@ -0,0 +1,29 @@
+/**
+ * @file blockcontext.cpp
+ *
+ * This file contains the data of the block, which is currently processed,
+ * shared by the transactions within the block.
+ */
+
+#include <tradelayer/blockcontext.h>
+
+#include <tradelayer/rules.h>
+
+#include <chain.h>
+
+namespace mastercore
+{
+CBlockContext::CBlockContext() : nHeight(-1), nTime(0), pindex(nullptr)
+{
+}
+
+CBlockContext::CBlockContext(const CBlockIndex* pBlockIndex)
+  : nHeight(pBlockIndex->nHeight), hash(pBlockIndex->GetBlockHash()), nTime(pBlockIndex->GetBlockTime()), pindex(pBlockIndex)
+{
+}
+
+bool CBlockContext::IsTransactionTypeAllowed(uint32_t txProperty, uint16_t txType, uint16_t version) const
+{
+    return mastercore::IsTransactionTypeAllowed(nHeight, txProperty, txType, version);
+}
+}
@@ -0,0 +1,43 @@
+#ifndef BITCOIN_TRADELAYER_BLOCKCONTEXT_H
+#define BITCOIN_TRADELAYER_BLOCKCONTEXT_H
+
+class CBlockIndex;
+
+#include <uint256.h>
+
+#include <stdint.h>
+
+namespace mastercore
+{
+/**
+ * Data of the block, which is currently processed.
+ *
+ * It is built once per block in mastercore_handler_block_begin() and handed to
+ * the transactions of the block, so their logic doesn't need to look up the
+ * block in the active chain, which requires cs_main.
+ */
+class CBlockContext
+{
+public:
+    int nHeight;
+    uint256 hash;
+    int64_t nTime;
+    const CBlockIndex* pindex;
+
+    CBlockContext();
+    explicit CBlockContext(const CBlockIndex* pBlockIndex);
+
+    /** Whether the context belongs to the given block. */
+    bool IsFor(const CBlockIndex* pBlockIndex) const { return pindex != nullptr && pindex == pBlockIndex; }
+
+    /**
+     * Checks whether a transaction type and version is allowed in this block, see IsTransactionTypeAllowed().
+     *
+     * The result is not cached, because features can be activated or deactivated
+     * by earlier transactions of the same block.
+     */
+    bool IsTransactionTypeAllowed(uint32_t txProperty, uint16_t txType, uint16_t version) const;
+};
+}
+
+#endif // BITCOIN_TRADELAYER_BLOCKCONTEXT_H
@@ -0,0 +1,47 @@
+/**
+ * @file blockevents.cpp
+ *
+ * This file contains the block height keyed schedule of protocol deadlines,
+ * so only blocks, in which something expires, need to look at the affected
+ * containers.
+ */
+
+#include <tradelayer/blockevents.h>
+
+#include <assert.h>
+#include <map>
+#include <set>
+#include <string>
+
+namespace mastercore
+{
+//! Scheduled events, indexed by type and block
+static std::map<int, std::set<std::string> > mapBlockEvents[BLOCK_EVENT_TYPE_COUNT];
+
+void ScheduleBlockEvent(BlockEventType type, int block, const std::string& key)
+{
+    assert(type < BLOCK_EVENT_TYPE_COUNT);
+    mapBlockEvents[type][block].insert(key);
+}
+
+std::set<std::string> PopDueBlockEvents(BlockEventType type, int block)
+{
+    assert(type < BLOCK_EVENT_TYPE_COUNT);
+    std::map<int, std::set<std::string> >& events = mapBlockEvents[type];
+
+    std::set<std::string> keys;
+    std::map<int, std::set<std::string> >::iterator it = events.begin();
+    while (it != events.end() && it->first <= block) {
+        keys.insert(it->second.begin(), it->second.end());
+        events.erase(it++);
+    }
+
+    return keys;
+}
+
+void ClearBlockEvents(BlockEventType type)
+{
+    assert(type < BLOCK_EVENT_TYPE_COUNT);
+    mapBlockEvents[type].clear();
+}
+}
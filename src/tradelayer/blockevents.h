@@ -0,0 +1,35 @@
+#ifndef BITCOIN_TRADELAYER_BLOCKEVENTS_H
+#define BITCOIN_TRADELAYER_BLOCKEVENTS_H
+
+#include <set>
+#include <string>
+
+namespace mastercore
+{
+/** Kinds of protocol deadlines, which are handled once their block is reached. */
+enum BlockEventType
+{
+    BLOCK_EVENT_ACTIVATION = 0,   // key: none, a pending feature activation goes live
+    BLOCK_EVENT_WITHDRAWAL,       // key: channel address, a channel withdrawal is paid out
+    BLOCK_EVENT_ACCEPT_EXPIRY,    // key: accept order key, the payment window of a DEx accept ends
+    BLOCK_EVENT_ALERT_EXPIRY,     // key: none, an alert expires or needs to be checked again
+    BLOCK_EVENT_TYPE_COUNT
+};
+
+/** Schedules an event for the given block; scheduling the same key for the same block twice has no effect. */
+void ScheduleBlockEvent(BlockEventType type, int block, const std::string& key = "");
+/**
+ * Removes all events of a type, which are due at or before the given block.
+ *
+ * Events may outlive the object they were scheduled for, so the caller has
+ * to check whether the object still exists and whether its deadline was
+ * actually reached.
+ *
+ * @return The keys of the removed events in sorted order
+ */
+std::set<std::string> PopDueBlockEvents(BlockEventType type, int block);
+/** Removes all events of a type. */
+void ClearBlockEvents(BlockEventType type);
+}
+
+#endif // BITCOIN_TRADELAYER_BLOCKEVENTS_H
@@ -10,6 +10,7 @@
 #include <tradelayer/mdex.h>
 #include <tradelayer/log.h>
 #include <tradelayer/parse_string.h>
+#include <tradelayer/perfstats.h>
 #include <tradelayer/sp.h>
 
 #include <arith_uint256.h>
@@ -141,6 +142,8 @@ std::string GenerateConsensusString(const uint32_t propertyId, const std::string
  */
 uint256 GetConsensusHash()
 {
+    CPerfTimer perfTimer(PERF_CONSENSUS_HASH);
+
     // allocate and init a SHA256_CTX
     SHA256_CTX shaCtx;
     SHA256_Init(&shaCtx);
@@ -174,8 +177,10 @@ uint256 GetConsensusHash()
     std::vector<std::pair<arith_uint256, std::string> > vecDExOffers;
     for (OfferMap::iterator it = my_offers.begin(); it != my_offers.end(); ++it) {
         const CMPOffer& selloffer = it->second;
-        const std::string& sellCombo = it->first;
-        std::string seller = sellCombo.substr(0, sellCombo.size() - 2);
+        // the seller is cut from the former "address-propertyid" key with a fixed
+        // two-character suffix, so the hash stays unchanged for properties >= 10
+        const std::string sellCombo = strprintf("%s-%d", it->first.first, it->first.second);
+        const std::string seller = sellCombo.substr(0, sellCombo.size() - 2);
         std::string dataStr = GenerateConsensusString(selloffer, seller);
         vecDExOffers.push_back(std::make_pair(arith_uint256(selloffer.getHash().ToString()), dataStr));
     }
@@ -191,8 +196,7 @@ uint256 GetConsensusHash()
     std::vector<std::pair<std::string, std::string> > vecAccepts;
     for (AcceptMap::const_iterator it = my_accepts.begin(); it != my_accepts.end(); ++it) {
         const CMPAccept& accept = it->second;
-        const std::string& acceptCombo = it->first;
-        std::string buyer = acceptCombo.substr((acceptCombo.find("+") + 1), (acceptCombo.size()-(acceptCombo.find("+") + 1)));
+        const std::string& buyer = it->first.buyer;
         std::string dataStr = GenerateConsensusString(accept, buyer);
         std::string sortKey = strprintf("%s-%s", accept.getHash().GetHex(), buyer);
         vecAccepts.push_back(std::make_pair(sortKey, dataStr));
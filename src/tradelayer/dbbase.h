@@ -90,7 +90,7 @@ public:
     /**
      * Deletes all entries of the database, and resets the counters.
      */
-    void Clear();
+    virtual void Clear();
 };
 
 
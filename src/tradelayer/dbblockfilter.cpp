@@ -0,0 +1,275 @@
+#include <tradelayer/dbblockfilter.h>
+
+#include <tradelayer/log.h>
+
+#include <clientversion.h>
+#include <fs.h>
+#include <serialize.h>
+#include <streams.h>
+#include <uint256.h>
+
+#include <leveldb/db.h>
+#include <leveldb/iterator.h>
+#include <leveldb/slice.h>
+#include <leveldb/status.h>
+#include <leveldb/write_batch.h>
+
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace
+{
+//! Version of the stored entries, the entries are discarded, if they were stored by another version
+const int BLOCK_FILTER_VERSION = 1;
+
+//! Key of the version of the stored entries
+const char KEY_VERSION = 'v';
+//! Key of the ranges of the processed blocks and the anchor block
+const char KEY_RANGES = 'r';
+//! Prefix of the keys of the blocks with Trade Layer transactions
+const char KEY_TL_BLOCK = 'b';
+
+void PutValue(leveldb::WriteBatch& batch, const CDataStream& ssKey, const CDataStream& ssValue)
+{
+    batch.Put(leveldb::Slice(ssKey.data(), ssKey.size()), leveldb::Slice(ssValue.data(), ssValue.size()));
+}
+
+CDataStream BlockKey(int nBlock)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << std::make_pair(KEY_TL_BLOCK, nBlock);
+    return ssKey;
+}
+}
+
+CTLBlockFilter::CTLBlockFilter(const fs::path& path, bool fWipe) : nAnchorBlock(-1)
+{
+    leveldb::Status status = Open(path, fWipe);
+    PrintToConsole("Loading block filter database: %s\n", status.ToString());
+
+    if (status.ok()) Load();
+}
+
+CTLBlockFilter::~CTLBlockFilter()
+{
+    if (msc_debug_persistence) PrintToLog("CTLBlockFilter closed\n");
+}
+
+/**
+ * Reads the ranges and the heights of the blocks with Trade Layer transactions.
+ *
+ * If the entries were stored by another version, or can't be read, the
+ * database is cleared.
+ */
+void CTLBlockFilter::Load()
+{
+    assert(pdb);
+
+    int nVersion = 0;
+    bool fCorrupted = false;
+    leveldb::Iterator* it = NewIterator();
+
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        const leveldb::Slice& slKey = it->key();
+        const leveldb::Slice& slValue = it->value();
+        try {
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            char chType = 0;
+            ssKey >> chType;
+            if (chType == KEY_VERSION) {
+                ssValue >> nVersion;
+            } else if (chType == KEY_RANGES) {
+                ssValue >> mapRanges >> nAnchorBlock >> hashAnchorBlock;
+            } else if (chType == KEY_TL_BLOCK) {
+                int nBlock = 0;
+                ssKey >> nBlock;
+                setTLBlocks.insert(nBlock);
+            }
+            ++nRead;
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+            fCorrupted = true;
+            break;
+        }
+    }
+
+    delete it;
+
+    if (fCorrupted || nVersion != BLOCK_FILTER_VERSION) {
+        Clear();
+    }
+
+    if (msc_debug_persistence) {
+        PrintToLog("%s(): %d ranges of blocks, %d blocks with Trade Layer transactions\n",
+                __func__, mapRanges.size(), setTLBlocks.size());
+    }
+}
+
+/**
+ * Stores the ranges, and the changes of the heights, together.
+ */
+void CTLBlockFilter::WriteRanges(leveldb::WriteBatch& batch)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << KEY_RANGES;
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    ssValue << mapRanges << nAnchorBlock << hashAnchorBlock;
+    PutValue(batch, ssKey, ssValue);
+
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    ++nWritten;
+
+    if (!status.ok()) {
+        PrintToLog("%s(): ERROR: %s\n", __func__, status.ToString());
+    }
+}
+
+/**
+ * Deletes all entries of the database, and removes all ranges.
+ */
+void CTLBlockFilter::Clear()
+{
+    CDBBase::Clear();
+    mapRanges.clear();
+    nAnchorBlock = -1;
+    hashAnchorBlock.SetNull();
+    setTLBlocks.clear();
+
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << KEY_VERSION;
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    ssValue << BLOCK_FILTER_VERSION;
+
+    leveldb::WriteBatch batch;
+    PutValue(batch, ssKey, ssValue);
+    WriteRanges(batch);
+}
+
+/**
+ * Records, whether a processed block contains Trade Layer transactions.
+ *
+ * The block is merged into the adjacent ranges. Blocks, which were already
+ * processed, are only written again, if they changed.
+ */
+void CTLBlockFilter::RecordBlock(int nBlock, const uint256& hashBlock, bool fHasTLTx)
+{
+    assert(pdb);
+
+    bool fProcessed = IsProcessed(nBlock);
+    bool fHadTLTx = (setTLBlocks.count(nBlock) > 0);
+    if (fProcessed && fHadTLTx == fHasTLTx && (nBlock < nAnchorBlock || hashBlock == hashAnchorBlock)) {
+        return;
+    }
+
+    if (!fProcessed) {
+        int nFirst = nBlock;
+        int nLast = nBlock;
+        std::map<int, int>::iterator itNext = mapRanges.upper_bound(nBlock);
+        if (itNext != mapRanges.end() && itNext->first == nBlock + 1) {
+            nLast = itNext->second;
+            itNext = mapRanges.erase(itNext);
+        }
+        if (itNext != mapRanges.begin()) {
+            std::map<int, int>::iterator itPrev = std::prev(itNext);
+            if (itPrev->second == nBlock - 1) {
+                nFirst = itPrev->first;
+                mapRanges.erase(itPrev);
+            }
+        }
+        mapRanges[nFirst] = nLast;
+    }
+    if (nBlock >= nAnchorBlock) {
+        nAnchorBlock = nBlock;
+        hashAnchorBlock = hashBlock;
+    }
+
+    leveldb::WriteBatch batch;
+
+    CDataStream ssBlockKey = BlockKey(nBlock);
+    if (fHasTLTx) {
+        PutValue(batch, ssBlockKey, CDataStream(SER_DISK, CLIENT_VERSION));
+        setTLBlocks.insert(nBlock);
+    } else {
+        batch.Delete(leveldb::Slice(ssBlockKey.data(), ssBlockKey.size()));
+        setTLBlocks.erase(nBlock);
+    }
+
+    WriteRanges(batch);
+}
+
+/**
+ * Removes the blocks at and above the given height from the ranges.
+ *
+ * The previous block of the active chain becomes the anchor, so the remaining
+ * blocks can still be skipped by a following reparse.
+ */
+void CTLBlockFilter::DeleteAboveBlock(int nBlock, const uint256& hashPrevBlock)
+{
+    assert(pdb);
+
+    if (nAnchorBlock < nBlock) return;
+
+    mapRanges.erase(mapRanges.lower_bound(nBlock), mapRanges.end());
+    if (!mapRanges.empty() && mapRanges.rbegin()->second >= nBlock) {
+        mapRanges.rbegin()->second = nBlock - 1;
+    }
+    if (mapRanges.empty()) {
+        nAnchorBlock = -1;
+        hashAnchorBlock.SetNull();
+    } else {
+        nAnchorBlock = nBlock - 1;
+        hashAnchorBlock = hashPrevBlock;
+    }
+
+    leveldb::WriteBatch batch;
+
+    std::set<int>::iterator it = setTLBlocks.lower_bound(nBlock);
+    for (std::set<int>::iterator itDelete = it; itDelete != setTLBlocks.end(); ++itDelete) {
+        CDataStream ssBlockKey = BlockKey(*itDelete);
+        batch.Delete(leveldb::Slice(ssBlockKey.data(), ssBlockKey.size()));
+    }
+    setTLBlocks.erase(it, setTLBlocks.end());
+
+    WriteRanges(batch);
+}
+
+/**
+ * Returns true, if the block was processed.
+ */
+bool CTLBlockFilter::IsProcessed(int nBlock) const
+{
+    std::map<int, int>::const_iterator it = mapRanges.upper_bound(nBlock);
+    if (it == mapRanges.begin()) {
+        return false;
+    }
+    --it;
+
+    return nBlock <= it->second;
+}
+
+/**
+ * Returns true, if the block was processed and has no Trade Layer transactions.
+ */
+bool CTLBlockFilter::CanSkipBlock(int nBlock) const
+{
+    return IsProcessed(nBlock) && setTLBlocks.count(nBlock) == 0;
+}
+
+/**
+ * Retrieves the height and hash of the anchor block.
+ */
+bool CTLBlockFilter::GetAnchorBlock(int& nBlock, uint256& hashBlock) const
+{
+    if (nAnchorBlock < 0) {
+        return false;
+    }
+
+    nBlock = nAnchorBlock;
+    hashBlock = hashAnchorBlock;
+
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef BITCOIN_TRADELAYER_DBBLOCKFILTER_H
+#define BITCOIN_TRADELAYER_DBBLOCKFILTER_H
+
+#include <tradelayer/dbbase.h>
+
+#include <fs.h>
+#include <uint256.h>
+
+#include <map>
+#include <set>
+
+/** LevelDB based storage of the blocks with Trade Layer transactions.
+ *
+ * The ranges of the processed blocks, and the heights of the blocks within
+ * those ranges, which contain Trade Layer transactions, are stored, when the
+ * blocks are processed, so a reparse can skip all other processed blocks
+ * without reading them from disk.
+ *
+ * The height and hash of an anchor block, at or above the highest processed
+ * block, are stored as well. If the anchor is still part of the active chain,
+ * all processed blocks below it are as well.
+ */
+class CTLBlockFilter : public CDBBase
+{
+private:
+    //! Ranges of the processed blocks, with the first height as key and the last height as value
+    std::map<int, int> mapRanges;
+    //! Height of the anchor block, or -1, if there is none
+    int nAnchorBlock;
+    //! Hash of the anchor block
+    uint256 hashAnchorBlock;
+    //! Heights of the processed blocks with Trade Layer transactions
+    std::set<int> setTLBlocks;
+
+    /** Reads the ranges and the heights of the blocks with Trade Layer transactions. */
+    void Load();
+
+    /** Stores the ranges, and the changes of the heights, together. */
+    void WriteRanges(leveldb::WriteBatch& batch);
+
+public:
+    CTLBlockFilter(const fs::path& path, bool fWipe);
+    virtual ~CTLBlockFilter();
+
+    /** Deletes all entries of the database, and removes all ranges. */
+    void Clear() override;
+
+    /** Records, whether a processed block contains Trade Layer transactions. */
+    void RecordBlock(int nBlock, const uint256& hashBlock, bool fHasTLTx);
+
+    /** Removes the blocks at and above the given height, the previous block becomes the anchor. */
+    void DeleteAboveBlock(int nBlock, const uint256& hashPrevBlock);
+
+    /** Returns true, if the block was processed. */
+    bool IsProcessed(int nBlock) const;
+
+    /** Returns true, if the block was processed and has no Trade Layer transactions. */
+    bool CanSkipBlock(int nBlock) const;
+
+    /** Retrieves the height and hash of the anchor block. */
+    bool GetAnchorBlock(int& nBlock, uint256& hashBlock) const;
+
+    /** Returns the number of ranges of processed blocks. */
+    size_t CountRanges() const { return mapRanges.size(); }
+
+    /** Returns the number of processed blocks with Trade Layer transactions. */
+    size_t CountTLBlocks() const { return setTLBlocks.size(); }
+};
+
+namespace mastercore
+{
+    //! LevelDB based storage of the blocks with Trade Layer transactions
+    extern CTLBlockFilter* pDbBlockFilter;
+}
+
+#endif // BITCOIN_TRADELAYER_DBBLOCKFILTER_H
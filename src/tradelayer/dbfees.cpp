@@ -57,8 +57,38 @@ void CTLFeeCache::UpdateDistributionThresholds(uint32_t propertyId)
     distributionThresholds[propertyId] = distributionThreshold;
 }
 
+void CTLFeeCache::Clear()
+{
+    CDBBase::Clear();
+    LOCK(cs_tally);
+    mapCachedAmounts.clear();
+    setChangedProperties.clear();
+    setPendingDistributions.clear();
+}
+
 // Gets the current amount of the fee cache for a property
 int64_t CTLFeeCache::GetCachedAmount(const uint32_t &propertyId)
+{
+    LOCK(cs_tally);
+    std::map<uint32_t, int64_t>::const_iterator it = mapCachedAmounts.find(propertyId);
+    if (it != mapCachedAmounts.end()) {
+        return it->second;
+    }
+    int64_t cachedAmount = ReadCachedAmount(propertyId);
+    mapCachedAmounts.insert(std::make_pair(propertyId, cachedAmount));
+    return cachedAmount;
+}
+
+// Sets the current amount of the fee cache for a property, it's written at the end of the block
+void CTLFeeCache::SetCachedAmount(const uint32_t &propertyId, int64_t amount)
+{
+    LOCK(cs_tally);
+    mapCachedAmounts[propertyId] = amount;
+    setChangedProperties.insert(propertyId);
+}
+
+// Reads the current amount of the fee cache for a property from the database
+int64_t CTLFeeCache::ReadCachedAmount(const uint32_t &propertyId)
 {
     assert(pdb);
     // Get the fee history, set is sorted by block so last entry is most recent
@@ -76,30 +106,9 @@ int64_t CTLFeeCache::GetCachedAmount(const uint32_t &propertyId)
 // Zeros a property in the fee cache
 void CTLFeeCache::ClearCache(const uint32_t &propertyId, int block)
 {
-    if (msc_debug_fees) PrintToLog("ClearCache starting (block %d, property ID %d)...\n", block, propertyId);
-    const std::string key = strprintf("%010d", propertyId);
-    std::set<feeCacheItem> sCacheHistoryItems = GetCacheHistory(propertyId);
-    if (msc_debug_fees) PrintToLog("   Iterating cache history (%d items)...\n",sCacheHistoryItems.size());
-    std::string newValue;
-    if (!sCacheHistoryItems.empty()) {
-        for (std::set<feeCacheItem>::iterator it = sCacheHistoryItems.begin(); it != sCacheHistoryItems.end(); it++) {
-            feeCacheItem tempItem = *it;
-            if (tempItem.first == block) continue;
-            if (!newValue.empty()) newValue += ",";
-            newValue += strprintf("%d:%d", tempItem.first, tempItem.second);
-            if (msc_debug_fees) PrintToLog("      Readding entry: block %d amount %d\n", tempItem.first, tempItem.second);
-        }
-        if (!newValue.empty()) newValue += ",";
-    }
-    if (msc_debug_fees) PrintToLog("   Adding zero valued entry: block %d\n", block);
-    newValue += strprintf("%d:%d", block, 0);
-    leveldb::Status status = pdb->Put(writeoptions, key, newValue);
-    assert(status.ok());
-    ++nWritten;
-
-    PruneCache(propertyId, block);
+    SetCachedAmount(propertyId, 0);
 
-    if (msc_debug_fees) PrintToLog("Cleared cache for property %d block %d [%s]\n", propertyId, block, status.ToString());
+    if (msc_debug_fees) PrintToLog("Cleared cache for property %d block %d\n", propertyId, block);
 }
 
 // Adds a fee to the cache (eg on a completed trade)
@@ -125,6 +134,16 @@ void CTLFeeCache::AddFee(const uint32_t &propertyId, int block, const int64_t &a
     int64_t newCachedAmount = currentCachedAmount + amount;
 
     if (msc_debug_fees) PrintToLog("   New cached amount %d\n", newCachedAmount);
+    SetCachedAmount(propertyId, newCachedAmount);
+
+    // Call for cache evaluation (we only need to do this each time a fee cache is increased)
+    EvalCache(propertyId, block);
+}
+
+// Stores the amount of the fee cache for a property in the entry of the block
+void CTLFeeCache::WriteCachedAmount(const uint32_t &propertyId, int block, int64_t amount)
+{
+    assert(pdb);
     const std::string key = strprintf("%010d", propertyId);
     std::set<feeCacheItem> sCacheHistoryItems = GetCacheHistory(propertyId);
     if (msc_debug_fees) PrintToLog("   Iterating cache history (%d items)...\n",sCacheHistoryItems.size());
@@ -139,26 +158,47 @@ void CTLFeeCache::AddFee(const uint32_t &propertyId, int block, const int64_t &a
         }
         if (!newValue.empty()) newValue += ",";
     }
-    if (msc_debug_fees) PrintToLog("   Adding requested entry: block %d new amount %d\n", block, newCachedAmount);
-    newValue += strprintf("%d:%d", block, newCachedAmount);
+    if (msc_debug_fees) PrintToLog("   Adding requested entry: block %d new amount %d\n", block, amount);
+    newValue += strprintf("%d:%d", block, amount);
     leveldb::Status status = pdb->Put(writeoptions, key, newValue);
     assert(status.ok());
     ++nWritten;
-    if (msc_debug_fees) PrintToLog("AddFee completed for property %d (new=%s [%s])\n", propertyId, newValue, status.ToString());
+    if (msc_debug_fees) PrintToLog("WriteCachedAmount completed for property %d (new=%s [%s])\n", propertyId, newValue, status.ToString());
 
     // Call for pruning (we only prune when we update a record)
     PruneCache(propertyId, block);
+}
 
-    // Call for cache evaluation (we only need to do this each time a fee cache is increased)
-    EvalCache(propertyId, block);
+// Executes the queued distributions and stores the fee caches changed in the block
+void CTLFeeCache::FlushCache(int block)
+{
+    LOCK(cs_tally);
 
-    return;
+    std::set<uint32_t> pendingDistributions;
+    pendingDistributions.swap(setPendingDistributions);
+    for (std::set<uint32_t>::const_iterator it = pendingDistributions.begin(); it != pendingDistributions.end(); ++it) {
+        // the threshold may have changed, since the distribution was queued
+        if (GetCachedAmount(*it) >= distributionThresholds[*it]) {
+            DistributeCache(*it, block);
+        }
+    }
+
+    for (std::set<uint32_t>::const_iterator it = setChangedProperties.begin(); it != setChangedProperties.end(); ++it) {
+        WriteCachedAmount(*it, block, mapCachedAmounts[*it]);
+    }
+    setChangedProperties.clear();
 }
 
 // Rolls back the cache to an earlier state (eg in event of a reorg) - block is *inclusive* (ie entries=block will get deleted)
 void CTLFeeCache::RollBackCache(int block)
 {
     assert(pdb);
+    {
+        LOCK(cs_tally);
+        mapCachedAmounts.clear();
+        setChangedProperties.clear();
+        setPendingDistributions.clear();
+    }
     for (uint8_t ecosystem = 1; ecosystem <= 2; ecosystem++) {
         uint32_t startPropertyId = (ecosystem == 1) ? 1 : TEST_ECO_PROPERTY_1;
         for (uint32_t propertyId = startPropertyId; propertyId < mastercore::pDbSpInfo->peekNextSPID(ecosystem); propertyId++) {
@@ -184,11 +224,12 @@ void CTLFeeCache::RollBackCache(int block)
     }
 }
 
-// Evaluates fee caches for the property against threshold and executes distribution if threshold met
+// Evaluates the fee cache for the property against threshold and queues a distribution if threshold met
 void CTLFeeCache::EvalCache(const uint32_t &propertyId, int block)
 {
+    LOCK(cs_tally);
     if (GetCachedAmount(propertyId) >= distributionThresholds[propertyId]) {
-        DistributeCache(propertyId, block);
+        setPendingDistributions.insert(propertyId);
     }
 }
 
@@ -215,7 +256,7 @@ void CTLFeeCache::DistributeCache(const uint32_t &propertyId, int block)
 
     int64_t sent_so_far = 0;
     std::set<feeHistoryItem> historyItems;
-    for (OwnerAddrType::reverse_iterator it = receiversSet.rbegin(); it != receiversSet.rend(); ++it) {
+    for (OwnerAddrType::const_iterator it = receiversSet.begin(); it != receiversSet.end(); ++it) {
         const std::string& address = it->second;
         int64_t will_really_receive = it->first;
         sent_so_far += will_really_receive;
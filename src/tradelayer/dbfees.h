@@ -6,6 +6,7 @@
 
 #include <fs.h>
 #include <stdint.h>
+#include <map>
 #include <set>
 #include <string>
 #include <utility>
@@ -14,13 +15,35 @@ typedef std::pair<int, int64_t> feeCacheItem;
 typedef std::pair<std::string, int64_t> feeHistoryItem;
 
 /** LevelDB based storage for the MetaDEx fee cache.
+ *
+ * The current amounts of the fee caches are kept in memory. Fees and
+ * distributions only update the memory, the changed fee caches are written,
+ * and the distributions, which are due, are executed once at the end of the
+ * block.
  */
 class CTLFeeCache : public CDBBase
 {
+private:
+    //! Current amounts of the fee caches, which were read or changed
+    std::map<uint32_t, int64_t> mapCachedAmounts;
+    //! Properties with fee caches, which changed in this block
+    std::set<uint32_t> setChangedProperties;
+    //! Properties with fee caches, which reached the distribution threshold in this block
+    std::set<uint32_t> setPendingDistributions;
+
+    /** Reads the current amount of the fee cache for a property from the database */
+    int64_t ReadCachedAmount(const uint32_t &propertyId);
+    /** Sets the current amount of the fee cache for a property, it's written at the end of the block */
+    void SetCachedAmount(const uint32_t &propertyId, int64_t amount);
+    /** Stores the amount of the fee cache for a property in the entry of the block */
+    void WriteCachedAmount(const uint32_t &propertyId, int block, int64_t amount);
+
 public:
     CTLFeeCache(const fs::path& path, bool fWipe);
     virtual ~CTLFeeCache();
 
+    void Clear() override;
+
     /** Show Fee Cache DB statistics */
     void printStats();
     /** Show Fee Cache DB records */
@@ -42,10 +65,12 @@ public:
     void ClearCache(const uint32_t &propertyId, int block);
     /** Adds a fee to the cache (eg on a completed trade) */
     void AddFee(const uint32_t &propertyId, int block, const int64_t &amount);
-    /** Evaluates fee caches for all properties against threshold and executes distribution if threshold met */
+    /** Evaluates the fee cache for a property against threshold and queues a distribution if threshold met */
     void EvalCache(const uint32_t &propertyId, int block);
     /** Performs distribution of fees */
     void DistributeCache(const uint32_t &propertyId, int block);
+    /** Executes the queued distributions and stores the fee caches changed in the block, called at the end of the block */
+    void FlushCache(int block);
 };
 
 /** LevelDB based storage for the MetaDEx fee distributions.
@@ -0,0 +1,85 @@
+#include <tradelayer/dbinputs.h>
+
+#include <tradelayer/log.h>
+
+#include <clientversion.h>
+#include <coins.h>
+#include <fs.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <streams.h>
+
+#include <leveldb/db.h>
+#include <leveldb/status.h>
+
+#include <string>
+#include <utility>
+
+CTLInputIndex::CTLInputIndex(const fs::path& path, bool fWipe)
+{
+    leveldb::Status status = Open(path, fWipe);
+    PrintToConsole("Loading input index database: %s\n", status.ToString());
+}
+
+CTLInputIndex::~CTLInputIndex()
+{
+    if (msc_debug_persistence) PrintToLog("CTLInputIndex closed\n");
+}
+
+/**
+ * Stores the output, which is spent by an input.
+ */
+bool CTLInputIndex::PutCoin(const COutPoint& prevout, const Coin& coin)
+{
+    assert(pdb);
+
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << std::make_pair('o', prevout);
+    leveldb::Slice slKey(&ssKey[0], ssKey.size());
+
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    ssValue << coin;
+    leveldb::Slice slValue(&ssValue[0], ssValue.size());
+
+    leveldb::Status status = pdb->Put(writeoptions, slKey, slValue);
+    ++nWritten;
+
+    if (!status.ok()) {
+        PrintToLog("%s(): ERROR for %s: %s\n", __func__, prevout.ToString(), status.ToString());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Retrieves the output, which is spent by an input.
+ */
+bool CTLInputIndex::GetCoin(const COutPoint& prevout, Coin& coin)
+{
+    assert(pdb);
+
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << std::make_pair('o', prevout);
+    leveldb::Slice slKey(&ssKey[0], ssKey.size());
+
+    std::string strValue;
+    leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+    if (!status.ok()) {
+        if (!status.IsNotFound()) {
+            PrintToLog("%s(): ERROR for %s: %s\n", __func__, prevout.ToString(), status.ToString());
+        }
+        return false;
+    }
+    ++nRead;
+
+    try {
+        CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> coin;
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR for %s: %s\n", __func__, prevout.ToString(), e.what());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef BITCOIN_TRADELAYER_DBINPUTS_H
+#define BITCOIN_TRADELAYER_DBINPUTS_H
+
+#include <tradelayer/dbbase.h>
+
+#include <coins.h>
+#include <fs.h>
+#include <primitives/transaction.h>
+
+/** LevelDB based storage for the inputs of Trade Layer transactions.
+ *
+ * The outputs spent by Trade Layer transactions are stored with their
+ * script and amount, when a transaction is parsed the first time, so the
+ * previous transactions don't need to be read from disk again, when the
+ * transaction is parsed during a reparse or a reorganization.
+ *
+ * Only outputs of confirmed transactions are stored, together with the
+ * height of their block. The entries are not updated, when blocks are
+ * disconnected, so the stored height may be outdated after a reorganization.
+ */
+class CTLInputIndex : public CDBBase
+{
+public:
+    CTLInputIndex(const fs::path& path, bool fWipe);
+    virtual ~CTLInputIndex();
+
+    /** Stores the output, which is spent by an input. */
+    bool PutCoin(const COutPoint& prevout, const Coin& coin);
+
+    /** Retrieves the output, which is spent by an input. */
+    bool GetCoin(const COutPoint& prevout, Coin& coin);
+};
+
+namespace mastercore
+{
+    //! LevelDB based storage for the inputs of Trade Layer transactions
+    extern CTLInputIndex* pDbInputIndex;
+}
+
+#endif // BITCOIN_TRADELAYER_DBINPUTS_H
@@ -15,6 +15,7 @@
 #include <leveldb/iterator.h>
 #include <leveldb/slice.h>
 #include <leveldb/status.h>
+#include <leveldb/write_batch.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -115,34 +116,44 @@ void CMPSTOList::getRecipients(const uint256 txid, std::string filterAddress, Un
     return;
 }
 
+/**
+ * Appends the receipts of an STO record, which were not yet added, to the list of receipts.
+ */
+static void AppendSTOReceipts(const std::string& recipientAddress, const std::string& strValue, std::string& mySTOReceipts)
+{
+    // break into individual receipts
+    std::vector<std::string> vstr;
+    boost::split(vstr, strValue, boost::is_any_of(","), boost::token_compress_on);
+    for (uint32_t i = 0; i < vstr.size(); i++) {
+        // add to array
+        std::vector<std::string> svstr;
+        boost::split(svstr, vstr[i], boost::is_any_of(":"), boost::token_compress_on);
+        if (4 == svstr.size()) {
+            size_t txidMatch = mySTOReceipts.find(svstr[0]);
+            if (txidMatch == std::string::npos) mySTOReceipts += svstr[0] + ":" + svstr[1] + ":" + recipientAddress + ":" + svstr[2] + ",";
+        }
+    }
+}
+
 std::string CMPSTOList::getMySTOReceipts(std::string filterAddress, interfaces::Wallet &iWallet)
 {
     if (!pdb) return "";
     std::string mySTOReceipts = "";
-    leveldb::Slice skey, svalue;
-    leveldb::Iterator* it = NewIterator();
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        std::string recipientAddress = skey.ToString();
-        if (!IsMyAddress(recipientAddress, &iWallet)) continue; // not ours, not interested
-        if ((!filterAddress.empty()) && (filterAddress != recipientAddress)) continue; // not the filtered address
-        // ours, get info
-        svalue = it->value();
-        std::string strValue = svalue.ToString();
-        // break into individual receipts
-        std::vector<std::string> vstr;
-        boost::split(vstr, strValue, boost::is_any_of(","), boost::token_compress_on);
-        for (uint32_t i = 0; i < vstr.size(); i++) {
-            // add to array
-            std::vector<std::string> svstr;
-            boost::split(svstr, vstr[i], boost::is_any_of(":"), boost::token_compress_on);
-            if (4 == svstr.size()) {
-                size_t txidMatch = mySTOReceipts.find(svstr[0]);
-                if (txidMatch == std::string::npos) mySTOReceipts += svstr[0] + ":" + svstr[1] + ":" + recipientAddress + ":" + svstr[2] + ",";
-            }
+    if (!filterAddress.empty()) {
+        // the records are keyed by address, so only one record is relevant
+        std::string strValue;
+        if (IsMyAddress(filterAddress, &iWallet) && pdb->Get(readoptions, filterAddress, &strValue).ok()) {
+            AppendSTOReceipts(filterAddress, strValue, mySTOReceipts);
+        }
+    } else {
+        leveldb::Iterator* it = NewIterator();
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            std::string recipientAddress = it->key().ToString();
+            if (!IsMyAddress(recipientAddress, &iWallet)) continue; // not ours, not interested
+            AppendSTOReceipts(recipientAddress, it->value().ToString(), mySTOReceipts);
         }
+        delete it;
     }
-    delete it;
     // above code will leave a trailing comma - strip it
     if (mySTOReceipts.size() > 0) mySTOReceipts.resize(mySTOReceipts.size() - 1);
     return mySTOReceipts;
@@ -223,39 +234,34 @@ bool CMPSTOList::exists(std::string address)
     return true;
 }
 
-void CMPSTOList::recordSTOReceive(std::string address, const uint256 &txid, int nBlock, unsigned int propertyId, uint64_t amount)
+void CMPSTOList::recordSTOReceives(const uint256& txid, int nBlock, uint32_t propertyId, const mastercore::OwnerAddrType& receivers)
 {
     if (!pdb) return;
 
-    bool addressExists = exists(address);
-    if (addressExists) {
-        // retrieve existing record
-        std::vector<std::string> vstr;
+    const std::string strTxid = txid.ToString();
+    leveldb::WriteBatch batch;
+
+    for (mastercore::OwnerAddrType::const_iterator it = receivers.begin(); it != receivers.end(); ++it) {
+        const std::string& address = it->second;
+        const uint64_t amount = it->first;
+
+        // retrieve existing record, if any
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, address, &strValue);
-        if (status.ok()) {
-            // add details to record
-            // see if we are overwriting (check)
-            size_t txidMatch = strValue.find(txid.ToString());
-            if (txidMatch != std::string::npos) PrintToLog("STODEBUG : Duplicating entry for %s : %s\n", address, txid.ToString());
-
-            const std::string key = address;
-            const std::string newValue = strprintf("%s:%d:%u:%lu,", txid.ToString(), nBlock, propertyId, amount);
-            strValue += newValue;
-            // write updated record
-            leveldb::Status status;
-            if (pdb) {
-                status = pdb->Put(writeoptions, key, strValue);
-                PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
-            }
-        }
-    } else {
-        const std::string key = address;
-        const std::string value = strprintf("%s:%d:%u:%lu,", txid.ToString(), nBlock, propertyId, amount);
-        leveldb::Status status;
-        if (pdb) {
-            status = pdb->Put(writeoptions, key, value);
-            PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
+        if (!status.ok() && !status.IsNotFound()) {
+            PrintToLog("%s(): ERROR for %s: %s\n", __func__, address, status.ToString());
+            continue;
         }
+
+        // see if we are overwriting (check)
+        if (strValue.find(strTxid) != std::string::npos) PrintToLog("STODEBUG : Duplicating entry for %s : %s\n", address, strTxid);
+
+        // add details to record
+        strValue += strprintf("%s:%d:%u:%lu,", strTxid, nBlock, propertyId, amount);
+        batch.Put(address, strValue);
     }
+
+    // write all updated records at once
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    PrintToLog("STODBDEBUG : %s(): %s, receivers: %d\n", __func__, status.ToString(), receivers.size());
 }
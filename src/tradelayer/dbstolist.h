@@ -2,6 +2,7 @@
 #define BITCOIN_TRADELAYER_DBSTOLIST_H
 
 #include <tradelayer/dbbase.h>
+#include <tradelayer/sto.h>
 
 #include <fs.h>
 #include <uint256.h>
@@ -36,7 +37,8 @@ public:
     void printStats();
     void printAll();
     bool exists(std::string address);
-    void recordSTOReceive(std::string, const uint256&, int, unsigned int, uint64_t);
+    /** Appends the receipts of a send to owners transaction to the records of the receivers, written in one batch. */
+    void recordSTOReceives(const uint256& txid, int nBlock, uint32_t propertyId, const mastercore::OwnerAddrType& receivers);
 };
 
 namespace mastercore
@@ -48,7 +48,7 @@ extern std::map<uint32_t, std::vector<uint64_t>> cdextwap_vec;
 /** Map of active channels**/
 extern std::map<std::string,channel> channels_Map;
 
-CMPTradeList::CMPTradeList(const fs::path& path, bool fWipe)
+CMPTradeList::CMPTradeList(const fs::path& path, bool fWipe) : fChannelCacheLoaded(false)
 {
     leveldb::Status status = Open(path, fWipe);
     PrintToConsole("Loading trades database: %s\n", status.ToString());
@@ -90,6 +90,8 @@ int CMPTradeList::deleteAboveBlock(int blockNum)
     std::vector<std::string> vstr;
     int block = 0;
     unsigned int n_found = 0;
+    // channel records may be removed, so the channel cache is rebuilt when needed
+    fChannelCacheLoaded = false;
     leveldb::Iterator* it = NewIterator();
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
         skey = it->key();
@@ -113,6 +115,12 @@ int CMPTradeList::deleteAboveBlock(int blockNum)
     return n_found;
 }
 
+void CMPTradeList::Clear()
+{
+    CDBBase::Clear();
+    fChannelCacheLoaded = false;
+}
+
 void CMPTradeList::printStats()
 {
     PrintToLog("CMPTradeList stats: tWritten= %d , tRead= %d\n", nWritten, nRead);
@@ -579,25 +587,93 @@ void CMPTradeList::recordMatchedTrade(const uint256 txid1, const uint256 txid2,
 
 }
 
+/**
+ * Adds or removes a channel or channel amount record to or from the channel cache.
+ *
+ * Channels are stored as "first:second:expiry:idx:create channel" with the channel
+ * address as key, commits, withdrawals and transfers as
+ * "channel:participant:property:amount:block:idx:type".
+ */
+void CMPTradeList::UpdateChannelCache(const std::string& key, const std::string& value, bool fAdd)
+{
+    std::vector<std::string> vstr;
+    boost::split(vstr, value, boost::is_any_of(":"), token_compress_on);
+
+    try {
+        if (vstr.size() == 5 && vstr[4] == TYPE_CREATE_CHANNEL) {
+            if (!fAdd) {
+                mapChannels.erase(key);
+                return;
+            }
+            channel& chn = mapChannels[key];
+            chn.multisig = key;
+            chn.first = vstr[0];
+            chn.second = vstr[1];
+            chn.expiry_height = boost::lexical_cast<int>(vstr[2]);
+
+        } else if (vstr.size() == 7) {
+            const ChannelAmountKey amountKey(vstr[0], vstr[1], boost::lexical_cast<uint32_t>(vstr[2]));
+            const uint64_t amount = boost::lexical_cast<uint64_t>(vstr[3]);
+            std::pair<uint64_t, uint64_t>& amounts = mapChannelAmounts[amountKey];
+            uint64_t& sum = (vstr[6] == TYPE_COMMIT) ? amounts.first : amounts.second;
+            sum = fAdd ? sum + amount : sum - amount;
+        }
+    } catch (const boost::bad_lexical_cast&) {
+        // not a channel record
+    }
+}
+
+/**
+ * Builds the channel cache from the database, so channel lookups don't need to
+ * iterate over all trades.
+ */
+void CMPTradeList::LoadChannelCache()
+{
+    mapChannels.clear();
+    mapChannelAmounts.clear();
+
+    leveldb::Iterator* it = NewIterator();
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        UpdateChannelCache(it->key().ToString(), it->value().ToString(), true);
+    }
+    delete it;
+
+    fChannelCacheLoaded = true;
+
+    if (msc_debug_tradedb) PrintToLog("%s(): %d channels, %d channel amounts\n", __func__, mapChannels.size(), mapChannelAmounts.size());
+}
+
+/**
+ * Stores a channel related record, and keeps the channel cache in sync, if it
+ * was already loaded. A replaced record is removed from the cache first.
+ */
+void CMPTradeList::PutChannelRecord(const std::string& key, const std::string& value)
+{
+    if (fChannelCacheLoaded) {
+        std::string strOldValue;
+        if (pdb->Get(readoptions, key, &strOldValue).ok()) {
+            UpdateChannelCache(key, strOldValue, false);
+        }
+        UpdateChannelCache(key, value, true);
+    }
+
+    Status status = pdb->Put(writeoptions, key, value);
+    ++nWritten;
+    if (msc_debug_tradedb) PrintToLog("%s(): %s\n", __func__, status.ToString());
+}
+
 void CMPTradeList::recordNewChannel(const std::string& channelAddress, const std::string& frAddr, const std::string& secAddr, int blockNum, int blockIndex)
 {
   if (!pdb) return;
   std::string strValue = strprintf("%s:%s:%d:%d:%s",frAddr, secAddr, blockNum, blockIndex,TYPE_CREATE_CHANNEL);
-  Status status = pdb->Put(writeoptions, channelAddress, strValue);
-  ++nWritten;
-
-  if (msc_debug_tradedb) PrintToLog("%s(): %s\n", __FUNCTION__, status.ToString());
-
+  PutChannelRecord(channelAddress, strValue);
 }
 
 void CMPTradeList::recordNewCommit(const uint256& txid, const std::string& channelAddress, const std::string& sender, uint32_t propertyId, uint64_t amountCommited, int blockNum, int blockIndex)
 {
   if (!pdb) return;
   std::string strValue = strprintf("%s:%s:%d:%d:%d:%d:%s", channelAddress, sender, propertyId, amountCommited, blockNum, blockIndex, TYPE_COMMIT);
-  const string key = to_string(blockNum) + "+" + txid.ToString(); // order by blockNum
-  Status status = pdb->Put(writeoptions, txid.ToString(), strValue);
-  ++nWritten;
-  if (msc_debug_tradedb) PrintToLog("%s(): %s\n", __FUNCTION__, status.ToString());
+  PutChannelRecord(txid.ToString(), strValue);
 }
 
 /**
@@ -605,141 +681,45 @@ void CMPTradeList::recordNewCommit(const uint256& txid, const std::string& chann
  */
 bool CMPTradeList::checkChannelAddress(const std::string& channelAddress)
 {
+   if (!pdb) return false;
+   if (!fChannelCacheLoaded) LoadChannelCache();
 
-   bool status = false;
-   if (!pdb) return status;
-
-   std::vector<std::string> vstr;
-   // string txidStr = txid.ToString();
-
-   leveldb::Iterator* it = NewIterator(); // Allocation proccess
-
-   for(it->SeekToLast(); it->Valid(); it->Prev())
-   {
-       // search key to see if this is a matching trade
-       std::string strKey = it->key().ToString();
-       // PrintToLog("key of this match: %s ****************************\n",strKey);
-       std::string strValue = it->value().ToString();
-
-       // ensure correct amount of tokens in value string
-       boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
-       if (vstr.size() != 5) {
-           //PrintToLog("TRADEDB error - unexpected number of tokens in value (%s)\n", strValue);
-           // PrintToConsole("TRADEDB error - unexpected number of tokens in value %d \n",vstr.size());
-           continue;
-       }
-
-       std::string type = vstr[4];
-
-       if (type != TYPE_CREATE_CHANNEL)
-           continue;
-
-       if(channelAddress != strKey)
-           continue;
-
-       // checking now on channels_Map
-       std::map<std::string,channel>::iterator it = channels_Map.find(channelAddress);
-       std::string chnAddr = it->first;
+   if (mapChannels.find(channelAddress) == mapChannels.end())
+       return false;
 
-       if(channelAddress != chnAddr)
-           continue;
-
-       status = true;
-       break;
-   }
-
-   // clean up
-   delete it; // Desallocation proccess
-   return status;
-
- }
+   // checking now on channels_Map
+   return (channels_Map.find(channelAddress) != channels_Map.end());
+}
 
  /**
   * @retrieve  All commits minus All withdrawal for a given address into specific channel
   */
  uint64_t CMPTradeList::getRemaining(const std::string& channelAddress, const std::string& senderAddress, uint32_t propertyId)
  {
-
    if (!pdb) return 0;
+   if (!fChannelCacheLoaded) LoadChannelCache();
 
-   uint64_t sumCommits = 0;
-   uint64_t sumWithdr = 0;
-
-   std::vector<std::string> vstr;
-
-   leveldb::Iterator* it = NewIterator(); // Allocation proccess
-
-   for(it->SeekToLast(); it->Valid(); it->Prev()) {
-       // search key to see if this is a matching trade
-       std::string strKey = it->key().ToString();
-       // PrintToLog("key of this match: %s ****************************\n",strKey);
-       std::string strValue = it->value().ToString();
-
-       // ensure correct amount of tokens in value string
-       boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
-       if (vstr.size() != 7) {
-           //PrintToLog("TRADEDB error - unexpected number of tokens in value (%s)\n", strValue);
-           // PrintToConsole("TRADEDB error - unexpected number of tokens in value %d \n",vstr.size());
-           continue;
-       }
-
-       //channelAddress, sender, propertyId, amountCommited, vOut, blockIndex
-
-       std::string cAddress = vstr[0];
-
-       if(channelAddress != cAddress)
-           continue;
-
-       std::string sender = vstr[1];
-
-       if(senderAddress != sender)
-           continue;
-
-       uint32_t propId = boost::lexical_cast<uint32_t>(vstr[2]);
-
-       if(propertyId != propId)
-           continue;
-
-       uint64_t amount = boost::lexical_cast<uint64_t>(vstr[3]);
-
-       PrintToLog("%s(): amount: %d\n",__func__, amount);
-
-
-       std::string type = vstr[6];
-
-       PrintToLog("%s(): type : %s\n",__func__, type);
+   std::map<ChannelAmountKey, std::pair<uint64_t, uint64_t> >::const_iterator it = mapChannelAmounts.find(ChannelAmountKey(channelAddress, senderAddress, propertyId));
+   if (it == mapChannelAmounts.end())
+       return 0;
 
-       (type == TYPE_COMMIT) ? sumCommits += amount : sumWithdr += amount;
-
-   }
-
-   // clean up
-   delete it; // Desallocation proccess
-
-   uint64_t total = sumCommits - sumWithdr;
+   uint64_t total = it->second.first - it->second.second;
 
    return total;
-
  }
 
  void CMPTradeList::recordNewWithdrawal(const uint256& txid, const std::string& channelAddress, const std::string& sender, uint32_t propertyId, uint64_t amountToWithdrawal, int blockNum, int blockIndex)
  {
    if (!pdb) return;
    std::string strValue = strprintf("%s:%s:%d:%d:%d:%d:%s", channelAddress, sender, propertyId, amountToWithdrawal, blockNum, blockIndex,TYPE_WITHDRAWAL);
-   const string key = to_string(blockNum) + "+" + txid.ToString(); // order by blockNum
-   Status status = pdb->Put(writeoptions, txid.ToString(), strValue);
-   ++nWritten;
-   if (msc_debug_tradedb) PrintToLog("%s(): %s\n", __FUNCTION__, status.ToString());
+   PutChannelRecord(txid.ToString(), strValue);
  }
 
  void CMPTradeList::recordNewTransfer(const uint256& txid, const std::string& sender, const std::string& receiver, uint32_t propertyId, uint64_t amount, int blockNum, int blockIndex)
  {
    if (!pdb) return;
    std::string strValue = strprintf("%s:%s:%d:%d:%d:%d:%s", sender, receiver, propertyId, amount, blockNum, blockIndex, TYPE_TRANSFER);
-   const string key = to_string(blockNum) + "+" + txid.ToString(); // order by blockNum
-   Status status = pdb->Put(writeoptions, txid.ToString(), strValue);
-   ++nWritten;
-   if (msc_debug_tradedb) PrintToLog("%s(): %s\n", __FUNCTION__, status.ToString());
+   PutChannelRecord(txid.ToString(), strValue);
  }
 
  void CMPTradeList::recordNewInstantTrade(const uint256& txid, const std::string& sender, const std::string& receiver, uint32_t propertyIdForSale, uint64_t amount_forsale, uint32_t propertyIdDesired, uint64_t amount_desired,int blockNum, int blockIndex)
@@ -772,55 +752,18 @@ bool CMPTradeList::checkChannelAddress(const std::string& channelAddress)
   */
 channel CMPTradeList::getChannelAddresses(const std::string& channelAddress)
 {
-     std::vector<std::string> vstr;
      channel ret;
-     std::string strKey;
 
      if (!pdb) return ret;
+     if (!fChannelCacheLoaded) LoadChannelCache();
 
-     leveldb::Iterator* it = NewIterator(); // Allocation proccess
-
-     for(it->SeekToLast(); it->Valid(); it->Prev())
-     {
-         // search key to see if this is a matching trade
-         strKey = it->key().ToString();
-         // PrintToLog("key of this match: %s ****************************\n",strKey);
-         std::string strValue = it->value().ToString();
-
-         // ensure correct amount of tokens in value string
-         boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
-         if (vstr.size() != 5) {
-             PrintToLog("TRADEDB error - unexpected number of tokens in value (%s)\n", strValue);
-             continue;
-         }
-
-         std::string type = vstr[4];
-
-         if (type != TYPE_CREATE_CHANNEL)
-             continue;
-
-         std::string frAddr = vstr[0];
-         std::string secAddr = vstr[1];
-         int expiry = boost::lexical_cast<int>(vstr[2]);
-
-         if (channelAddress != strKey)
-             continue;
-
-         ret.multisig = strKey;
-         ret.first = frAddr;
-         ret.second = secAddr;
-         ret.expiry_height = expiry;
-
-         PrintToLog("%s(): ok!: multisig: %s, fist: %s, second: %s\n",__func__, ret.multisig, ret.first, ret.second);
-
-         break;
+     std::map<std::string, channel>::const_iterator it = mapChannels.find(channelAddress);
+     if (it != mapChannels.end()) {
+         ret = it->second;
+         if (msc_debug_tradedb) PrintToLog("%s(): multisig: %s, first: %s, second: %s\n",__func__, ret.multisig, ret.first, ret.second);
      }
 
-     // clean up
-     delete it; // Desallocation proccess
-
      return ret;
-
 }
 
 bool CMPTradeList::checkKYCRegister(const std::string& address, int registered)
@@ -11,7 +11,10 @@
 
 #include <stdint.h>
 
+#include <map>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 struct channel
@@ -29,6 +32,21 @@ struct channel
  */
 class CMPTradeList : public CDBBase
 {
+private:
+    //! Channel participant amounts, indexed by channel address, participant and property
+    typedef std::tuple<std::string, std::string, uint32_t> ChannelAmountKey;
+
+    //! Whether the channel cache reflects the database
+    bool fChannelCacheLoaded;
+    //! Channels, indexed by channel address
+    std::map<std::string, channel> mapChannels;
+    //! Committed and withdrawn or transferred amounts
+    std::map<ChannelAmountKey, std::pair<uint64_t, uint64_t> > mapChannelAmounts;
+
+    void LoadChannelCache();
+    void UpdateChannelCache(const std::string& key, const std::string& value, bool fAdd);
+    void PutChannelRecord(const std::string& key, const std::string& value);
+
 public:
     CMPTradeList(const fs::path& path, bool fWipe);
     virtual ~CMPTradeList();
@@ -44,6 +62,7 @@ public:
     void getTradesForAddress(const std::string& address, std::vector<uint256>& vecTransactions, uint32_t propertyIdFilter = 0);
     void getTradesForPair(uint32_t propertyIdSideA, uint32_t propertyIdSideB, UniValue& response, uint64_t count);
     int getMPTradeCountTotal();
+    void Clear() override;
     void recordNewChannel(const std::string& channelAddress, const std::string& frAddr, const std::string& secAddr, int blockNum, int blockIndex);
     void recordNewCommit(const uint256& txid, const std::string& channelAddress, const std::string& sender, uint32_t propertyId, uint64_t amountCommited, int blockNum, int blockIndex);
     bool checkChannelAddress(const std::string& channelAddress);
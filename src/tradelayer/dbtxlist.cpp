@@ -66,7 +66,7 @@ void CMPTxList::recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned
     const std::string value = strprintf("%u:%d:%u:%lu", fValid ? 1 : 0, nBlock, type, nValue);
     leveldb::Status status;
 
-    PrintToLog("%s(%s, valid=%s, block= %d, type= %d, value= %lu)\n",
+    if (msc_debug_txdb) PrintToLog("%s(%s, valid=%s, block= %d, type= %d, value= %lu)\n",
             __func__, txid.ToString(), fValid ? "YES" : "NO", nBlock, type, nValue);
 
     status = pdb->Put(writeoptions, key, value);
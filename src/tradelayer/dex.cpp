@@ -6,6 +6,7 @@
 
 #include <tradelayer/dex.h>
 
+#include <tradelayer/blockevents.h>
 #include <tradelayer/convert.h>
 #include <tradelayer/dbspinfo.h>
 #include <tradelayer/dbtxlist.h>
@@ -20,7 +21,6 @@
 #include <uint256.h>
 
 #include <boost/algorithm/string.hpp>
-#include <boost/lexical_cast.hpp>
 
 #include <openssl/sha.h>
 
@@ -37,14 +37,48 @@ extern int64_t factorE;
 
 namespace mastercore
 {
+//! Keys of the open accepts, ordered by buyer, to find the sellers of a buyer without a pass over all accepts
+static std::set<std::pair<std::string, DExAcceptKey> > setAcceptsByBuyer;
+
+/**
+ * Adds an accept order, and indexes it by buyer.
+ *
+ * @return True, if there was no accept order with the same key
+ */
+bool DEx_acceptInsert(const DExAcceptKey& key, const CMPAccept& accept)
+{
+    if (!my_accepts.insert(std::make_pair(key, accept)).second) {
+        return false;
+    }
+    setAcceptsByBuyer.insert(std::make_pair(key.buyer, key));
+
+    return true;
+}
+
+/**
+ * Removes an accept order, and its entry in the index by buyer.
+ */
+void DEx_acceptErase(const DExAcceptKey& key)
+{
+    setAcceptsByBuyer.erase(std::make_pair(key.buyer, key));
+    my_accepts.erase(key);
+}
+
+/**
+ * Removes all accept orders.
+ */
+void DEx_acceptsClear()
+{
+    my_accepts.clear();
+    setAcceptsByBuyer.clear();
+}
+
 /**
  * Checks, if such a sell offer exists.
  */
 bool DEx_offerExists(const std::string& addressSeller, uint32_t propertyId)
 {
-    std::string key = STR_SELLOFFER_ADDR_PROP_COMBO(addressSeller, propertyId);
-
-    return !(my_offers.find(key) == my_offers.end());
+    return !(my_offers.find(DExOfferKey(addressSeller, propertyId)) == my_offers.end());
 }
 
 /**
@@ -52,13 +86,9 @@ bool DEx_offerExists(const std::string& addressSeller, uint32_t propertyId)
  */
 bool DEx_hasOffer(const std::string& addressSeller)
 {
-    for (auto const& offer : my_offers) {
-        if (offer.first.find(addressSeller) == 0) {
-            return true;
-        }
-    }
+    OfferMap::const_iterator it = my_offers.lower_bound(DExOfferKey(addressSeller, 0));
 
-    return false;
+    return (it != my_offers.end() && it->first.first == addressSeller);
 }
 
 /**
@@ -73,29 +103,42 @@ bool DEx_hasOffer(const std::string& addressSeller)
  */
 bool DEx_getTokenForSale(const std::string& addressSeller, uint32_t& retTokenId)
 {
-    for (auto const& offer : my_offers) {
-        if (offer.first.find(addressSeller) == 0) {
+    // the offers of the seller are adjacent, but the first offer by the order
+    // of the former "address-tokenid" keys is chosen, so the choice is unchanged
+    bool fFound = false;
+    std::string firstKey;
+    for (OfferMap::const_iterator it = my_offers.lower_bound(DExOfferKey(addressSeller, 0));
+            it != my_offers.end() && it->first.first == addressSeller; ++it) {
+        const std::string key = strprintf("%d", it->first.second);
+        if (!fFound || key < firstKey) {
+            firstKey = key;
+            retTokenId = it->first.second;
+            fFound = true;
+        }
+    }
 
-            // Format is: "address-tokenid"
-            std::vector<std::string> vstr;
-            boost::split(vstr, offer.first, boost::is_any_of("-"), boost::token_compress_on);
+    return fFound;
+}
 
-            if (vstr.size() != 2) {
-                PrintToLog("ERROR: failed to parse token for sale: %s\n", __func__, offer.first);
-                return false;
-            }
+/**
+ * Retrieves the counterparties of the open accepts of an address, whether the
+ * address is the buyer or the seller of the accept.
+ */
+std::set<std::string> DEx_getAcceptCounterparties(const std::string& address)
+{
+    std::set<std::string> counterparties;
 
-            try {
-                retTokenId = boost::lexical_cast<uint32_t>(vstr[1]);
-                return true;
-            }
-            catch (boost::bad_lexical_cast const& e) {
-                PrintToLog("ERROR: failed to parse token for sale: %s (%s)\n", __func__, offer.first, e.what());
-            }
-        }
+    // the accepts are ordered by seller
+    for (AcceptMap::const_iterator it = my_accepts.lower_bound(DExAcceptKey(address, 0, ""));
+            it != my_accepts.end() && it->first.seller == address; ++it) {
+        counterparties.insert(it->first.buyer);
+    }
+    for (std::set<std::pair<std::string, DExAcceptKey> >::const_iterator it = setAcceptsByBuyer.lower_bound(std::make_pair(address, DExAcceptKey("", 0, "")));
+            it != setAcceptsByBuyer.end() && it->first == address; ++it) {
+        counterparties.insert(it->second.seller);
     }
 
-    return false;
+    return counterparties;
 }
 
 /**
@@ -107,8 +150,7 @@ CMPOffer* DEx_getOffer(const std::string& addressSeller, uint32_t propertyId)
 {
     if (msc_debug_dex) PrintToLog("%s(%s, %d)\n", __func__, addressSeller, propertyId);
 
-    std::string key = STR_SELLOFFER_ADDR_PROP_COMBO(addressSeller, propertyId);
-    OfferMap::iterator it = my_offers.find(key);
+    OfferMap::iterator it = my_offers.find(DExOfferKey(addressSeller, propertyId));
 
     if (it != my_offers.end()) return &(it->second);
 
@@ -120,9 +162,7 @@ CMPOffer* DEx_getOffer(const std::string& addressSeller, uint32_t propertyId)
  */
 bool DEx_acceptExists(const std::string& addressSeller, uint32_t propertyId, const std::string& addressBuyer)
 {
-    std::string key = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(addressSeller, addressBuyer, propertyId);
-
-    return !(my_accepts.find(key) == my_accepts.end());
+    return !(my_accepts.find(DExAcceptKey(addressSeller, propertyId, addressBuyer)) == my_accepts.end());
 }
 
 /**
@@ -134,8 +174,7 @@ CMPAccept* DEx_getAccept(const std::string& addressSeller, uint32_t propertyId,
 {
     if (msc_debug_dex) PrintToLog("%s(%s, %d, %s)\n", __func__, addressSeller, propertyId, addressBuyer);
 
-    std::string key = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(addressSeller, addressBuyer, propertyId);
-    AcceptMap::iterator it = my_accepts.find(key);
+    AcceptMap::iterator it = my_accepts.find(DExAcceptKey(addressSeller, propertyId, addressBuyer));
 
     if (it != my_accepts.end()) return &(it->second);
 
@@ -187,8 +226,7 @@ int DEx_offerCreate(const std::string& addressSeller, uint32_t propertyId, int64
     }
 
 
-    const std::string key = STR_SELLOFFER_ADDR_PROP_COMBO(addressSeller, propertyId);
-    if (msc_debug_dex) PrintToLog("%s(%s|%s), nValue=%d)\n", __func__, addressSeller, key, amountOffered);
+    if (msc_debug_dex) PrintToLog("%s(%s|%d), nValue=%d)\n", __func__, addressSeller, propertyId, amountOffered);
 
     const int64_t balanceReallyAvailable = GetTokenBalance(addressSeller, propertyId, BALANCE);
 
@@ -206,7 +244,7 @@ int DEx_offerCreate(const std::string& addressSeller, uint32_t propertyId, int64
         assert(update_tally_map(addressSeller, propertyId, amountOffered, SELLOFFER_RESERVE));
 
         CMPOffer sellOffer(block, amountOffered, propertyId, amountDesired, minAcceptFee, paymentWindow, txid, 2);
-        my_offers.insert(std::make_pair(key, sellOffer));
+        my_offers.insert(std::make_pair(DExOfferKey(addressSeller, propertyId), sellOffer));
 
         rc = 0;
     }
@@ -236,11 +274,9 @@ int DEx_offerDestroy(const std::string& addressSeller, uint32_t propertyId)
     }
 
     // delete the offer
-    const std::string key = STR_SELLOFFER_ADDR_PROP_COMBO(addressSeller, propertyId);
-    OfferMap::iterator it = my_offers.find(key);
-    my_offers.erase(it);
+    my_offers.erase(DExOfferKey(addressSeller, propertyId));
 
-    if (msc_debug_dex) PrintToLog("%s(%s|%s)\n", __func__, addressSeller, key);
+    if (msc_debug_dex) PrintToLog("%s(%s|%d)\n", __func__, addressSeller, propertyId);
 
     return 0;
 }
@@ -279,10 +315,7 @@ int DEx_offerUpdate(const std::string& addressSeller, uint32_t propertyId, int64
 int DEx_acceptCreate(const std::string& addressBuyer, const std::string& addressSeller, uint32_t propertyId, int64_t amountAccepted, int block, int64_t feePaid, uint64_t* nAmended)
 {
     int rc = DEX_ERROR_ACCEPT -10;
-    const std::string keySellOffer = STR_SELLOFFER_ADDR_PROP_COMBO(addressSeller, propertyId);
-    const std::string keyAcceptOrder = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(addressSeller, addressBuyer, propertyId);
-
-    OfferMap::const_iterator my_it = my_offers.find(keySellOffer);
+    OfferMap::const_iterator my_it = my_offers.find(DExOfferKey(addressSeller, propertyId));
 
     if (my_it == my_offers.end()) {
         PrintToLog("%s: rejected: no matching sell offer for accept order found\n", __func__);
@@ -322,7 +355,9 @@ int DEx_acceptCreate(const std::string& addressBuyer, const std::string& address
         assert(update_tally_map(addressSeller, propertyId, amountReserved, ACCEPT_RESERVE));
 
         CMPAccept acceptOffer(amountReserved, block, offer.getBlockTimeLimit(), offer.getProperty(), offer.getOfferAmountOriginal(), offer.getBTCDesiredOriginal(), offer.getHash());
-        my_accepts.insert(std::make_pair(keyAcceptOrder, acceptOffer));
+        DEx_acceptInsert(DExAcceptKey(addressSeller, propertyId, addressBuyer), acceptOffer);
+        ScheduleBlockEvent(BLOCK_EVENT_ACCEPT_EXPIRY, block + offer.getBlockTimeLimit(),
+                STR_ACCEPT_ADDR_PROP_ADDR_COMBO(addressSeller, addressBuyer, propertyId));
 
         rc = 0;
     }
@@ -382,12 +417,7 @@ int DEx_acceptDestroy(const std::string& addressBuyer, const std::string& addres
 
     // can only erase when is NOT called from an iterator loop
     if (fForceErase) {
-        std::string key = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(addressSeller, addressBuyer, propertyid);
-        AcceptMap::iterator it = my_accepts.find(key);
-
-        if (my_accepts.end() != it) {
-            my_accepts.erase(it);
-        }
+        DEx_acceptErase(DExAcceptKey(addressSeller, propertyid, addressBuyer));
     }
 
     rc = 0;
@@ -425,54 +455,11 @@ int64_t calculateDExPurchase(const int64_t amountOffered, const int64_t amountDe
  */
 int DEx_payment(const uint256& txid, unsigned int vout, const std::string& addressSeller, const std::string& addressBuyer, int64_t amountPaid, int block, uint64_t* nAmended)
 {
-  CMPSPInfo* pDbSpInfo = NULL;
-  uint32_t nextSPID = pDbSpInfo->peekNextSPID(1);
-
-  if (msc_debug_dex) PrintToLog("%s(%s, %s)\n", __func__, addressSeller, addressBuyer);
-  int rc = DEX_ERROR_PAYMENT;
-  uint32_t propertyId;
-
-  CMPAccept* p_accept = NULL;
-
-  // logic here: we look only into main properties if there's some match
-  for (propertyId = 1; propertyId < nextSPID; propertyId++)
-  {
-      CMPSPInfo::Entry sp;
-      if (msc_debug_dex) PrintToLog("propertyId: %d\n",propertyId);
-      if (!pDbSpInfo->getSP(propertyId, sp)) continue;
-
-      // seller market maker?
-      p_accept = DEx_getAccept(addressSeller, propertyId, addressBuyer);
-
-      if (p_accept)
-      {
-          if (msc_debug_dex) PrintToLog("Found seller market maker!\n");
-          break;
-      }
-
-      // buyer market maker?
-      // if (IsFeatureActivated(FEATURE_DEX_BUY, block))
-      // {
-          p_accept = DEx_getAccept(addressBuyer, propertyId, addressSeller);
-
-          if (p_accept)
-          {
-              if (msc_debug_dex) PrintToLog("Found buyer market maker!\n");
-              break;
-          }
-
-      // }
-
-
-  }
-
-  if (!p_accept && msc_debug_dex)
-  {
-     // there must be an active accept order for this payment
-     PrintToLog("first return!\n");
-     return (DEX_ERROR_PAYMENT -1);
-  }
+    if (msc_debug_dex) PrintToLog("%s(%s, %s)\n", __func__, addressSeller, addressBuyer);
+    int rc = DEX_ERROR_PAYMENT;
+    uint32_t propertyId = 0;
 
+    CMPAccept* p_accept = NULL;
 
     /**
      * When the feature is not activated, first check, if there is an open offer
@@ -568,32 +555,39 @@ int DEx_payment(const uint256& txid, unsigned int vout, const std::string& addre
 unsigned int eraseExpiredAccepts(int blockNow)
 {
     unsigned int how_many_erased = 0;
-    AcceptMap::iterator it = my_accepts.begin();
 
-    while (my_accepts.end() != it) {
+    // only accepts, whose payment window ends in this block, are looked at
+    const std::set<std::string> keys = PopDueBlockEvents(BLOCK_EVENT_ACCEPT_EXPIRY, blockNow);
+
+    for (std::set<std::string>::const_iterator itKey = keys.begin(); itKey != keys.end(); ++itKey) {
+        // extract the seller, buyer and property from the event key
+        std::vector<std::string> vstr;
+        boost::split(vstr, *itKey, boost::is_any_of("-+"), boost::token_compress_on);
+        if (vstr.size() != 3) continue;
+        const std::string& addressSeller = vstr[0];
+        const uint32_t propertyId = atoi(vstr[1]);
+        const std::string& addressBuyer = vstr[2];
+
+        AcceptMap::iterator it = my_accepts.find(DExAcceptKey(addressSeller, propertyId, addressBuyer));
+        if (it == my_accepts.end()) continue; // already paid or destroyed
+
         const CMPAccept& acceptOrder = it->second;
 
         int blocksSinceAccept = blockNow - acceptOrder.getAcceptBlock();
         int blocksPaymentWindow = static_cast<int>(acceptOrder.getBlockTimeLimit());
 
+        // a newer accept with the same key has its own event
         if (blocksSinceAccept >= blocksPaymentWindow) {
             PrintToLog("%s: sell offer: %s\n", __func__, acceptOrder.getHash().GetHex());
             PrintToLog("%s: erasing at block: %d, order confirmed at block: %d, payment window: %d\n",
                     __func__, blockNow, acceptOrder.getAcceptBlock(), acceptOrder.getBlockTimeLimit());
 
-            // extract the seller, buyer and property from the key
-            std::vector<std::string> vstr;
-            boost::split(vstr, it->first, boost::is_any_of("-+"), boost::token_compress_on);
-            std::string addressSeller = vstr[0];
-            uint32_t propertyId = atoi(vstr[1]);
-            std::string addressBuyer = vstr[2];
-
             DEx_acceptDestroy(addressBuyer, addressSeller, propertyId);
 
-            my_accepts.erase(it++);
+            DEx_acceptErase(DExAcceptKey(addressSeller, propertyId, addressBuyer));
 
             ++how_many_erased;
-        } else it++;
+        }
     }
 
     return how_many_erased;
@@ -623,8 +617,7 @@ int DEx_BuyOfferCreate(const std::string& addressMaker, uint32_t propertyId, int
         return (DEX_ERROR_SELLOFFER -10); // offer already exists
     }
 
-    const std::string key = STR_SELLOFFER_ADDR_PROP_COMBO(addressMaker, propertyId);
-    if (msc_debug_dex) PrintToLog("%s(%s|%s), nValue=%d)\n", __func__, addressMaker, key, amountOffered);
+    if (msc_debug_dex) PrintToLog("%s(%s|%d), nValue=%d)\n", __func__, addressMaker, propertyId, amountOffered);
 
     // ------------------------------------------------------------------------
     // On this part we need to put in reserve synth Bitcoins(?).
@@ -673,7 +666,7 @@ int DEx_BuyOfferCreate(const std::string& addressMaker, uint32_t propertyId, int
     if (ready)
     {
         CMPOffer sellOffer(block, amountOffered, propertyId, price, minAcceptFee, paymentWindow, txid, 1);
-        my_offers.insert(std::make_pair(key, sellOffer));
+        my_offers.insert(std::make_pair(DExOfferKey(addressMaker, propertyId), sellOffer));
     } else {
         if (msc_debug_dex) PrintToLog("You can't buy tokens, you need more position value\n");
         return -1;
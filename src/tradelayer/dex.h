@@ -14,14 +14,39 @@
 #include <stdint.h>
 #include <fstream>
 #include <map>
+#include <set>
 #include <string>
+#include <utility>
 
-/** Lookup key to find DEx offers. */
-inline std::string STR_SELLOFFER_ADDR_PROP_COMBO(const std::string& address, uint32_t propertyId)
+/** Lookup key to find DEx offers: the seller and the property for sale.
+ *
+ * The offers are ordered by seller, so the offers of a seller are adjacent.
+ */
+typedef std::pair<std::string, uint32_t> DExOfferKey;
+
+/** Lookup key to find DEx accepts.
+ *
+ * The accepts are ordered by seller and property, so the accepts of an offer
+ * are adjacent.
+ */
+struct DExAcceptKey
 {
-    return strprintf("%s-%d", address, propertyId);
-}
-/** Lookup key to find DEx accepts. */
+    std::string seller;
+    uint32_t propertyId;
+    std::string buyer;
+
+    DExAcceptKey(const std::string& sellerIn, uint32_t propertyIdIn, const std::string& buyerIn)
+      : seller(sellerIn), propertyId(propertyIdIn), buyer(buyerIn) {}
+
+    bool operator<(const DExAcceptKey& other) const
+    {
+        if (seller != other.seller) return seller < other.seller;
+        if (propertyId != other.propertyId) return propertyId < other.propertyId;
+        return buyer < other.buyer;
+    }
+};
+
+/** Key of the expiry event of DEx accepts. */
 inline std::string STR_ACCEPT_ADDR_PROP_ADDR_COMBO(const std::string& seller, const std::string& buyer, uint32_t propertyId)
 {
     return strprintf("%s-%d+%s", seller, propertyId, buyer);
@@ -95,7 +120,7 @@ public:
     {
     }
 
-    void saveOffer(std::ofstream& file, SHA256_CTX* shaCtx, const std::string& address) const
+    void saveOffer(std::ostream& file, SHA256_CTX* shaCtx, const std::string& address) const
     {
         std::string lineOut = strprintf("%s,%d,%d,%d,%d,%d,%d,%d,%s",
                 address,
@@ -203,7 +228,7 @@ public:
         return bRet;
     }
 
-    void saveAccept(std::ofstream& file, SHA256_CTX* shaCtx, const std::string& address, const std::string& buyer) const
+    void saveAccept(std::ostream& file, SHA256_CTX* shaCtx, const std::string& address, const std::string& buyer) const
     {
         std::string lineOut = strprintf("%s,%d,%s,%d,%d,%d,%d,%d,%d,%s",
                 address,
@@ -227,8 +252,8 @@ public:
 
 namespace mastercore
 {
-typedef std::map<std::string, CMPOffer> OfferMap;
-typedef std::map<std::string, CMPAccept> AcceptMap;
+typedef std::map<DExOfferKey, CMPOffer> OfferMap;
+typedef std::map<DExAcceptKey, CMPAccept> AcceptMap;
 
 //! In-memory collection of DEx offers
 extern OfferMap my_offers;
@@ -244,6 +269,10 @@ bool DEx_getTokenForSale(const std::string& addressSeller, uint32_t& retTokenId)
 CMPOffer* DEx_getOffer(const std::string& addressSeller, uint32_t propertyId);
 bool DEx_acceptExists(const std::string& addressSeller, uint32_t propertyId, const std::string& addressBuyer);
 CMPAccept* DEx_getAccept(const std::string& addressSeller, uint32_t propertyId, const std::string& addressBuyer);
+std::set<std::string> DEx_getAcceptCounterparties(const std::string& address);
+bool DEx_acceptInsert(const DExAcceptKey& key, const CMPAccept& accept);
+void DEx_acceptErase(const DExAcceptKey& key);
+void DEx_acceptsClear();
 int DEx_offerCreate(const std::string& addressSeller, uint32_t propertyId, int64_t amountOffered, int block, int64_t amountDesired, int64_t minAcceptFee, uint8_t paymentWindow, const uint256& txid, uint64_t* nAmended = nullptr);
 int DEx_offerDestroy(const std::string& addressSeller, uint32_t propertyId);
 int DEx_offerUpdate(const std::string& addressSeller, uint32_t propertyId, int64_t amountOffered, int block, int64_t amountDesired, int64_t minAcceptFee, uint8_t paymentWindow, const uint256& txid, uint64_t* nAmended = nullptr);
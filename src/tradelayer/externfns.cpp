@@ -1,9 +1,12 @@
 #include "tradelayer/externfns.h"
+#include "tradelayer/arith128.h"
 #include "tradelayer/tradelayer_matrices.h"
 #include "tradelayer/log.h"
 #include "tradelayer/parse_string.h"
 #include "tradelayer/mdex.h"
 
+#include "amount.h"
+
 #include <unordered_set>
 #include <boost/lexical_cast.hpp>
 #include <stdint.h>
@@ -165,5 +168,22 @@ void vwap_num_den(std::vector<int64_t> vn, std::vector<int64_t> vd, int64_t &n,
 namespace mastercore
 {
   int64_t DoubleToInt64(double d) { return mastercore::StrToInt64(boost::lexical_cast<std::string>(d), true); }
-  int64_t RationalToInt64(rational_t r) { return mastercore::StrToInt64(xToString(r), true); }
+
+  /**
+   * Returns the value in units of 1e-8, rounded down, or 0, if the value is
+   * negative or out of range, like the conversion to a divisible amount string.
+   */
+  int64_t RationalToInt64(rational_t r)
+  {
+      const boost::multiprecision::checked_int128_t& num = r.numerator();
+      const boost::multiprecision::checked_int128_t& den = r.denominator();
+      if (num < 0 || num > std::numeric_limits<int64_t>::max() || den > std::numeric_limits<int64_t>::max()) {
+          return 0;
+      }
+      int64_t result = 0;
+      if (!MulDivChecked(num.convert_to<int64_t>(), COIN, den.convert_to<int64_t>(), result)) {
+          return 0;
+      }
+      return result;
+  }
 }
@@ -102,10 +102,6 @@ double RewardSecndI;
 double RewardFirstI;
 int64_t SatoshiH;
 
-/*****************************************/
-/** Oracles **/
-std::map<uint32_t,oracledata> oraclePrices;
-
 /*****************************************/
 /** Withdrawals on channels **/
 std::map<std::string,vector<withdrawalAccepted>> withdrawal_Map;
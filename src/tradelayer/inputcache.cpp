@@ -0,0 +1,82 @@
+/**
+ * @file inputcache.cpp
+ *
+ * This file contains the least recently used bookkeeping of the transaction
+ * input cache, which is used to determine the senders of transactions.
+ */
+
+#include <tradelayer/inputcache.h>
+
+#include <coins.h>
+#include <primitives/transaction.h>
+
+#include <list>
+#include <utility>
+
+namespace mastercore
+{
+CInputCacheLRU::CInputCacheLRU(size_t limit) : nLimit(limit), nHits(0), nMisses(0), nEvictions(0)
+{
+}
+
+bool CInputCacheLRU::Fetch(const CCoinsViewCache& view, const COutPoint& outpoint)
+{
+    if (view.AccessCoin(outpoint).IsSpent()) {
+        ++nMisses;
+        return false;
+    }
+
+    ++nHits;
+    PositionMap::iterator it = mapPositions.find(outpoint);
+    if (it != mapPositions.end()) {
+        listRecent.splice(listRecent.begin(), listRecent, it->second);
+    }
+
+    return true;
+}
+
+void CInputCacheLRU::Reserve(CCoinsViewCache& view, size_t count)
+{
+    while (!listRecent.empty() && listRecent.size() + count > nLimit) {
+        view.SpendCoin(listRecent.back());
+        mapPositions.erase(listRecent.back());
+        listRecent.pop_back();
+        ++nEvictions;
+    }
+}
+
+void CInputCacheLRU::Add(CCoinsViewCache& view, const COutPoint& outpoint, Coin&& coin)
+{
+    // coins are added as fresh entries, so spending them removes them from the view
+    view.AddCoin(outpoint, std::move(coin), false);
+
+    PositionMap::iterator it = mapPositions.find(outpoint);
+    if (it != mapPositions.end()) {
+        listRecent.splice(listRecent.begin(), listRecent, it->second);
+    } else {
+        listRecent.push_front(outpoint);
+        mapPositions.emplace(outpoint, listRecent.begin());
+    }
+}
+
+void CInputCacheLRU::Clear(CCoinsViewCache& view)
+{
+    for (std::list<COutPoint>::const_iterator it = listRecent.begin(); it != listRecent.end(); ++it) {
+        view.SpendCoin(*it);
+    }
+    listRecent.clear();
+    mapPositions.clear();
+}
+
+InputCacheStats CInputCacheLRU::GetStats() const
+{
+    InputCacheStats stats;
+    stats.size = listRecent.size();
+    stats.limit = nLimit;
+    stats.hits = nHits;
+    stats.misses = nMisses;
+    stats.evictions = nEvictions;
+
+    return stats;
+}
+}
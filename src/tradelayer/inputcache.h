@@ -0,0 +1,73 @@
+#ifndef BITCOIN_TRADELAYER_INPUTCACHE_H
+#define BITCOIN_TRADELAYER_INPUTCACHE_H
+
+#include <coins.h>
+#include <primitives/transaction.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <unordered_map>
+
+namespace mastercore
+{
+/** Usage statistics of the transaction input cache. */
+struct InputCacheStats
+{
+    size_t size;
+    size_t limit;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+/**
+ * Size-bounded cache of transaction inputs on top of a coins view cache.
+ *
+ * The coins added via this class are kept in least recently used order, and
+ * before the inputs of a transaction are added, the least recently used coins
+ * are removed from the coins view one by one, instead of clearing the whole
+ * view. The coins of the transaction, which is filled, are never removed, so
+ * the limit may be exceeded by the inputs of one transaction.
+ *
+ * Note: the coins view and this object must be guarded by the same lock.
+ */
+class CInputCacheLRU
+{
+private:
+    typedef std::unordered_map<COutPoint, std::list<COutPoint>::iterator, SaltedOutpointHasher> PositionMap;
+
+    //! Tracked coins, the most recently used first
+    std::list<COutPoint> listRecent;
+    //! Positions of the tracked coins in the usage order
+    PositionMap mapPositions;
+
+    size_t nLimit;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+
+public:
+    explicit CInputCacheLRU(size_t limit);
+
+    /**
+     * Checks, if the coins view holds a coin, and marks it as recently used.
+     *
+     * @return True, if the coin is cached
+     */
+    bool Fetch(const CCoinsViewCache& view, const COutPoint& outpoint);
+
+    /** Evicts the least recently used coins, so the given number of coins can be added within the limit. */
+    void Reserve(CCoinsViewCache& view, size_t count);
+
+    /** Adds a coin to the coins view, and marks it as recently used. */
+    void Add(CCoinsViewCache& view, const COutPoint& outpoint, Coin&& coin);
+
+    /** Removes all tracked coins from the coins view. */
+    void Clear(CCoinsViewCache& view);
+
+    InputCacheStats GetStats() const;
+};
+}
+
+#endif // BITCOIN_TRADELAYER_INPUTCACHE_H
@@ -9,8 +9,12 @@
 #include <assert.h>
 #include <stdio.h>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 // Default log files
@@ -19,6 +23,8 @@ const std::string LOG_FILENAME    = "tradelayer.log";
 // Options
 static const long LOG_BUFFERSIZE  =  8000000; //  8 MB
 static const long LOG_SHRINKSIZE  = 50000000; // 50 MB
+static const size_t LOG_QUEUE_CAPACITY = 8192; // messages, must be a power of two
+static const int LOG_WRITER_IDLE_MS = 100;
 
 // Debug flags
 bool msc_debug_parser_data        = 0;
@@ -110,6 +116,104 @@ static FILE* fileout = nullptr;
 static std::mutex* mutexDebugLog = nullptr;
 /** Flag to indicate, whether the Tradelayer log file should be reopened. */
 extern std::atomic<bool> fReopenTradeLayerLog;
+
+namespace {
+/** A preformatted message, waiting to be written by the log writer thread. */
+struct LogRecord
+{
+    std::string str;
+    int64_t nTime;
+    bool fConsole;
+};
+
+/**
+ * Bounded multi-producer, single-consumer ring buffer.
+ *
+ * Each cell carries a sequence number, which tells producers and the consumer,
+ * whether the cell is free or holds a record, so that neither side needs a lock.
+ */
+class LogRingBuffer
+{
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+    std::atomic<size_t> m_enqueue_pos;
+    size_t m_dequeue_pos;
+
+public:
+    /** The capacity must be a power of two. */
+    explicit LogRingBuffer(size_t capacity)
+    : m_mask(capacity - 1), m_cells(new Cell[capacity]), m_enqueue_pos(0), m_dequeue_pos(0)
+    {
+        assert(capacity >= 2 && (capacity & m_mask) == 0);
+        for (size_t i = 0; i < capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /** Adds a record, or returns false, if the buffer is full. */
+    bool TryPush(LogRecord& record)
+    {
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & m_mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.record = std::move(record);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Removes the oldest record. Must only be called by the single consumer. */
+    bool TryPop(LogRecord& record)
+    {
+        Cell& cell = m_cells[m_dequeue_pos & m_mask];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != m_dequeue_pos + 1) {
+            return false;
+        }
+        record = std::move(cell.record);
+        cell.record.str.clear();
+        cell.sequence.store(m_dequeue_pos + m_mask + 1, std::memory_order_release);
+        ++m_dequeue_pos;
+        return true;
+    }
+};
+
+/**
+ * State of the background log writer.
+ *
+ * Allocated once and never destroyed, for the same reason as mutexDebugLog.
+ */
+struct LogWriter
+{
+    LogRingBuffer buffer{LOG_QUEUE_CAPACITY};
+    std::atomic<bool> fRunning{false};
+    std::atomic<bool> fStopRequested{false};
+    std::atomic<bool> fIdle{false};
+    std::mutex mutexWakeup;
+    std::condition_variable condWakeup;
+    std::thread thread;
+};
+
+LogWriter* logWriter = nullptr;
+} // namespace
+
 /**
  * Returns path for debug log file.
  *
@@ -132,31 +236,158 @@ static fs::path GetLogPath()
 }
 
 /**
- * Opens debug log file.
+ * @return The given timestamp in the format: 2009-01-03 18:15:05
+ */
+static std::string GetTimestamp(int64_t nTime)
+{
+    return FormatISO8601DateTime(nTime);
+}
+
+/**
+ * Writes a message to the log file, or to the console.
+ *
+ * Only called by the log writer thread, or by the caller itself, when the log
+ * writer is not running, in which case mutexDebugLog is held.
+ *
+ * @return The total number of characters written
+ */
+static int WriteRecord(const LogRecord& record)
+{
+    static bool fFileStartedNewLine = true;
+    static bool fConsoleStartedNewLine = true;
+
+    int ret = 0; // Number of characters written
+    const std::string& str = record.str;
+    bool fEndsWithNewLine = (!str.empty() && str[str.size()-1] == '\n');
+
+    if (record.fConsole) {
+        if (LogInstance().m_log_timestamps && fConsoleStartedNewLine) {
+            ret = fprintf(stdout, "%s %s", GetTimestamp(record.nTime).c_str(), str.c_str());
+        } else {
+            ret = fwrite(str.data(), 1, str.size(), stdout);
+        }
+        fConsoleStartedNewLine = fEndsWithNewLine;
+        fflush(stdout);
+        return ret;
+    }
+
+    if (fileout == nullptr) {
+        return ret;
+    }
+
+    // Reopen the log file, if requested
+    if (fReopenTradeLayerLog) {
+        fReopenTradeLayerLog = false;
+        fs::path pathDebug = GetLogPath();
+        if (freopen(pathDebug.string().c_str(), "a", fileout) != nullptr) {
+            setbuf(fileout, nullptr); // Unbuffered
+        }
+    }
+
+    // Printing log timestamps can be useful for profiling
+    if (LogInstance().m_log_timestamps && fFileStartedNewLine) {
+        ret += fprintf(fileout, "%s ", GetTimestamp(record.nTime).c_str());
+    }
+    fFileStartedNewLine = fEndsWithNewLine;
+    ret += fwrite(str.data(), 1, str.size(), fileout);
+
+    return ret;
+}
+
+/**
+ * Drains the ring buffer until it is empty.
+ */
+static void DrainLogBuffer()
+{
+    LogRecord record;
+    while (logWriter->buffer.TryPop(record)) {
+        WriteRecord(record);
+    }
+}
+
+/**
+ * Main loop of the log writer thread.
+ *
+ * Records are written in the order in which they were queued. When there is
+ * nothing to write, the thread sleeps until a producer wakes it up.
+ */
+static void LogWriterThread()
+{
+    RenameThread("tradelayer-log");
+
+    while (!logWriter->fStopRequested) {
+        DrainLogBuffer();
+
+        std::unique_lock<std::mutex> lock(logWriter->mutexWakeup);
+        logWriter->fIdle = true;
+        logWriter->condWakeup.wait_for(lock, std::chrono::milliseconds(LOG_WRITER_IDLE_MS));
+        logWriter->fIdle = false;
+    }
+
+    DrainLogBuffer();
+}
+
+/**
+ * Opens debug log file and starts the log writer thread.
  */
 static void DebugLogInit()
 {
     assert(fileout == nullptr);
     assert(mutexDebugLog == nullptr);
+    assert(logWriter == nullptr);
 
-    fs::path pathDebug = GetLogPath();
-    fileout = fopen(pathDebug.string().c_str(), "a");
+    mutexDebugLog = new std::mutex();
 
-    if (fileout) {
-        setbuf(fileout, nullptr); // Unbuffered
-    } else {
-        PrintToConsole("Failed to open debug log file: %s\n", pathDebug.string());
+    if (!LogInstance().m_print_to_console && LogInstance().m_print_to_file) {
+        fs::path pathDebug = GetLogPath();
+        fileout = fopen(pathDebug.string().c_str(), "a");
+
+        if (fileout) {
+            setbuf(fileout, nullptr); // Unbuffered
+        } else {
+            LogRecord record{strprintf("Failed to open debug log file: %s\n", pathDebug.string()), GetTime(), true};
+            WriteRecord(record);
+        }
     }
 
-    mutexDebugLog = new std::mutex();
+    logWriter = new LogWriter();
+    logWriter->thread = std::thread(&LogWriterThread);
+    logWriter->fRunning = true;
 }
 
 /**
- * @return The current timestamp in the format: 2009-01-03 18:15:05
+ * Hands a message over to the log writer thread.
+ *
+ * The caller only pays for queuing the preformatted message. If the buffer is
+ * full, the caller waits until the writer made room, so no message is lost.
+ * If the writer is not running, the message is written immediately.
+ *
+ * @return The number of characters queued or written
  */
-static std::string GetTimestamp()
+static int QueueRecord(const std::string& str, bool fConsole)
 {
-    return FormatISO8601DateTime(GetTime());
+    std::call_once(debugLogInitFlag, &DebugLogInit);
+
+    LogRecord record{str, GetTime(), fConsole};
+
+    if (!logWriter->fRunning) {
+        std::lock_guard<std::mutex> lock(*mutexDebugLog);
+        return WriteRecord(record);
+    }
+
+    while (!logWriter->buffer.TryPush(record)) {
+        if (!logWriter->fRunning) {
+            std::lock_guard<std::mutex> lock(*mutexDebugLog);
+            return WriteRecord(record);
+        }
+        logWriter->condWakeup.notify_one();
+        std::this_thread::yield();
+    }
+    if (logWriter->fIdle) {
+        logWriter->condWakeup.notify_one();
+    }
+
+    return str.size();
 }
 
 /**
@@ -168,44 +399,20 @@ static std::string GetTimestamp()
  * If "-printtoconsole" is enabled, then the message is written to the standard
  * output, usually the console, instead of a log file.
  *
+ * The message is written asynchronously by the log writer thread.
+ *
  * @param str[in]  The message to log
- * @return The total number of characters written
+ * @return The total number of characters queued
  */
 int LogFilePrint(const std::string& str)
 {
-    int ret = 0; // Number of characters written
+    int ret = 0; // Number of characters queued
     if (LogInstance().m_print_to_console) {
         // Print to console
         ret = ConsolePrint(str);
     }
     else if (LogInstance().m_print_to_file) {
-        static bool fStartedNewLine = true;
-        std::call_once(debugLogInitFlag, &DebugLogInit);
-
-        if (fileout == nullptr) {
-            return ret;
-        }
-        std::lock_guard<std::mutex> lock(*mutexDebugLog);
-
-        // Reopen the log file, if requested
-        if (fReopenTradeLayerLog) {
-            fReopenTradeLayerLog = false;
-            fs::path pathDebug = GetLogPath();
-            if (freopen(pathDebug.string().c_str(), "a", fileout) != nullptr) {
-                setbuf(fileout, nullptr); // Unbuffered
-            }
-        }
-
-        // Printing log timestamps can be useful for profiling
-        if (LogInstance().m_log_timestamps && fStartedNewLine) {
-            ret += fprintf(fileout, "%s ", GetTimestamp().c_str());
-        }
-        if (!str.empty() && str[str.size()-1] == '\n') {
-            fStartedNewLine = true;
-        } else {
-            fStartedNewLine = false;
-        }
-        ret += fwrite(str.data(), 1, str.size(), fileout);
+        ret = QueueRecord(str, false);
     }
 
     return ret;
@@ -217,32 +424,109 @@ int LogFilePrint(const std::string& str)
  * The configuration option "-logtimestamps" can be used to indicate, whether
  * the message should be prepended with a timestamp.
  *
+ * The message is written asynchronously by the log writer thread.
+ *
  * @param str[in]  The message to print
- * @return The total number of characters written
+ * @return The total number of characters queued
  */
 int ConsolePrint(const std::string& str)
 {
-    int ret = 0; // Number of characters written
-    static bool fStartedNewLine = true;
+    return QueueRecord(str, true);
+}
 
-    if (LogInstance().m_log_timestamps && fStartedNewLine) {
-        ret = fprintf(stdout, "%s %s", GetTimestamp().c_str(), str.c_str());
-    } else {
-        ret = fwrite(str.data(), 1, str.size(), stdout);
-    }
-    if (!str.empty() && str[str.size()-1] == '\n') {
-        fStartedNewLine = true;
-    } else {
-        fStartedNewLine = false;
+/**
+ * Stops the log writer thread, after all queued messages were written.
+ *
+ * Messages logged afterwards are written synchronously.
+ */
+void StopDebugLog()
+{
+    if (logWriter == nullptr || !logWriter->fRunning) {
+        return;
     }
-    fflush(stdout);
 
-    return ret;
+    logWriter->fStopRequested = true;
+    logWriter->condWakeup.notify_one();
+    logWriter->thread.join();
+
+    std::lock_guard<std::mutex> lock(*mutexDebugLog);
+    logWriter->fRunning = false;
+    // pick up messages, which were queued while the writer was stopping
+    DrainLogBuffer();
 }
 
+/** Maps the categories of the startup option --omnidebug to their debug flags. */
+static const struct {
+    const char* name;
+    bool* flag;
+} debugCategories[] = {
+    {"parser_data", &msc_debug_parser_data},
+    {"parser_readonly", &msc_debug_parser_readonly},
+    {"parser_dex", &msc_debug_parser_dex},
+    {"parser", &msc_debug_parser},
+    {"verbose", &msc_debug_verbose},
+    {"verbose2", &msc_debug_verbose2},
+    {"verbose3", &msc_debug_verbose3},
+    {"vin", &msc_debug_vin},
+    {"script", &msc_debug_script},
+    {"dex", &msc_debug_dex},
+    {"send", &msc_debug_send},
+    {"tokens", &msc_debug_tokens},
+    {"spec", &msc_debug_spec},
+    {"exo", &msc_debug_exo},
+    {"tally", &msc_debug_tally},
+    {"sp", &msc_debug_sp},
+    {"sto", &msc_debug_sto},
+    {"txdb", &msc_debug_txdb},
+    {"tradedb", &msc_debug_tradedb},
+    {"persistence", &msc_debug_persistence},
+    {"ui", &msc_debug_ui},
+    {"pending", &msc_debug_pending},
+    {"metadex1", &msc_debug_metadex1},
+    {"metadex2", &msc_debug_metadex2},
+    {"metadex3", &msc_debug_metadex3},
+    {"packets", &msc_debug_packets},
+    {"packets_readonly", &msc_debug_packets_readonly},
+    {"walletcache", &msc_debug_walletcache},
+    {"consensus_hash", &msc_debug_consensus_hash},
+    {"consensus_hash_every_block", &msc_debug_consensus_hash_every_block},
+    {"alerts", &msc_debug_alerts},
+    {"consensus_hash_every_transaction", &msc_debug_consensus_hash_every_transaction},
+    {"fees", &msc_debug_fees},
+    {"x_trade_bidirectional", &msc_debug_x_trade_bidirectional},
+    {"contractdex_add", &msc_debug_contractdex_add},
+    {"contract_add_market", &msc_debug_contract_add_market},
+    {"add_orderbook_edge", &msc_debug_add_orderbook_edge},
+    {"contract_cancel_inorder", &msc_debug_contract_cancel_inorder},
+    {"close_position", &msc_debug_close_position},
+    {"contractdex_tx", &msc_debug_contractdex_tx},
+    {"contract_cancel_every", &msc_debug_contract_cancel_every},
+    {"contract_cancel_forblock", &msc_debug_contract_cancel_forblock},
+    {"set_oracle", &msc_debug_set_oracle},
+    {"handler_tx", &msc_debug_handler_tx},
+    {"margin_main", &msc_debug_margin_main},
+    {"pos_margin", &msc_debug_pos_margin},
+    {"create_channel", &msc_create_channel},
+    {"commit_channel", &msc_debug_commit_channel},
+    {"withdrawal_from_channel", &msc_debug_withdrawal_from_channel},
+    {"instant_trade", &msc_debug_instant_trade},
+    {"contract_instant_trade", &msc_debug_contract_instant_trade},
+    {"contract_inst_fee", &msc_debug_contract_inst_fee},
+    {"instant_x_trade", &msc_debug_instant_x_trade},
+    {"new_id_registration", &msc_debug_new_id_registration},
+    {"metadex_fees", &msc_debug_metadex_fees},
+    {"contractdex_fees", &msc_debug_contractdex_fees},
+    {"get_pair_market_price", &msc_debug_get_pair_market_price},
+    {"create_pegged", &msc_debug_create_pegged},
+    {"send_pegged", &msc_debug_send_pegged},
+};
+
 /**
  * Determine whether to override compiled debug levels via enumerating startup option --omnidebug.
  *
+ * Each category is a plain flag, which is checked before the arguments of a
+ * log message are formatted, so disabled categories cost only a branch.
+ *
  * Example usage (granular categories)    : --omnidebug=parser --omnidebug=metadex1 --omnidebug=ui
  * Example usage (enable all categories)  : --omnidebug=all
  * Example usage (disable all debugging)  : --omnidebug=none
@@ -257,75 +541,15 @@ void InitDebugLogLevels()
     const std::vector<std::string>& debugLevels = gArgs.GetArgs("-omnidebug");
 
     for (std::vector<std::string>::const_iterator it = debugLevels.begin(); it != debugLevels.end(); ++it) {
-        if (*it == "parser_data") msc_debug_parser_data = true;
-        if (*it == "parser_readonly") msc_debug_parser_readonly = true;
-        if (*it == "parser_dex") msc_debug_parser_dex = true;
-        if (*it == "parser") msc_debug_parser = true;
-        if (*it == "verbose") msc_debug_verbose = true;
-        if (*it == "verbose2") msc_debug_verbose2 = true;
-        if (*it == "verbose3") msc_debug_verbose3 = true;
-        if (*it == "vin") msc_debug_vin = true;
-        if (*it == "script") msc_debug_script = true;
-        if (*it == "dex") msc_debug_dex = true;
-        if (*it == "send") msc_debug_send = true;
-        if (*it == "tokens") msc_debug_tokens = true;
-        if (*it == "spec") msc_debug_spec = true;
-        if (*it == "exo") msc_debug_exo = true;
-        if (*it == "tally") msc_debug_tally = true;
-        if (*it == "sp") msc_debug_sp = true;
-        if (*it == "sto") msc_debug_sto = true;
-        if (*it == "txdb") msc_debug_txdb = true;
-        if (*it == "tradedb") msc_debug_tradedb = true;
-        if (*it == "persistence") msc_debug_persistence = true;
-        if (*it == "ui") msc_debug_ui = true;
-        if (*it == "pending") msc_debug_pending = true;
-        if (*it == "metadex1") msc_debug_metadex1 = true;
-        if (*it == "metadex2") msc_debug_metadex2 = true;
-        if (*it == "metadex3") msc_debug_metadex3 = true;
-        if (*it == "packets") msc_debug_packets = true;
-        if (*it == "packets_readonly") msc_debug_packets_readonly = true;
-        if (*it == "walletcache") msc_debug_walletcache = true;
-        if (*it == "consensus_hash") msc_debug_consensus_hash = true;
-        if (*it == "consensus_hash_every_block") msc_debug_consensus_hash_every_block = true;
-        if (*it == "alerts") msc_debug_alerts = true;
-        if (*it == "consensus_hash_every_transaction") msc_debug_consensus_hash_every_transaction = true;
-        if (*it == "fees") msc_debug_fees = true;
         if (*it == "none" || *it == "all") {
-            bool allDebugState = false;
-            if (*it == "all") allDebugState = true;
-            msc_debug_parser_data = allDebugState;
-            msc_debug_parser_readonly = allDebugState;
-            msc_debug_parser_dex = allDebugState;
-            msc_debug_parser = allDebugState;
-            msc_debug_verbose = allDebugState;
-            msc_debug_verbose2 = allDebugState;
-            msc_debug_verbose3 = allDebugState;
-            msc_debug_vin = allDebugState;
-            msc_debug_script = allDebugState;
-            msc_debug_dex = allDebugState;
-            msc_debug_send = allDebugState;
-            msc_debug_tokens = allDebugState;
-            msc_debug_spec = allDebugState;
-            msc_debug_exo = allDebugState;
-            msc_debug_tally = allDebugState;
-            msc_debug_sp = allDebugState;
-            msc_debug_sto = allDebugState;
-            msc_debug_txdb = allDebugState;
-            msc_debug_tradedb = allDebugState;
-            msc_debug_persistence = allDebugState;
-            msc_debug_ui = allDebugState;
-            msc_debug_pending = allDebugState;
-            msc_debug_metadex1 = allDebugState;
-            msc_debug_metadex2 = allDebugState;
-            msc_debug_metadex3 = allDebugState;
-            msc_debug_packets =  allDebugState;
-            msc_debug_packets_readonly =  allDebugState;
-            msc_debug_walletcache = allDebugState;
-            msc_debug_consensus_hash = allDebugState;
-            msc_debug_consensus_hash_every_block = allDebugState;
-            msc_debug_alerts = allDebugState;
-            msc_debug_consensus_hash_every_transaction = allDebugState;
-            msc_debug_fees = allDebugState;
+            bool allDebugState = (*it == "all");
+            for (const auto& category : debugCategories) {
+                *category.flag = allDebugState;
+            }
+            continue;
+        }
+        for (const auto& category : debugCategories) {
+            if (*it == category.name) *category.flag = true;
         }
     }
 }
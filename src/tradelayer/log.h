@@ -6,12 +6,15 @@
 
 #include <string>
 
-/** Prints to the log file. */
+/** Prints to the log file, via the background log writer. */
 int LogFilePrint(const std::string& str);
 
-/** Prints to the console. */
+/** Prints to the console, via the background log writer. */
 int ConsolePrint(const std::string& str);
 
+/** Writes all queued messages and stops the background log writer. */
+void StopDebugLog();
+
 /** Determine whether to override compiled debug levels. */
 void InitDebugLogLevels();
 
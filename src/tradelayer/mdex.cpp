@@ -1,18 +1,18 @@
 #include <tradelayer/mdex.h>
 
+#include <tradelayer/arith128.h>
 #include <tradelayer/dbfees.h>
 #include <tradelayer/dbtradelist.h>
 #include <tradelayer/dbtxlist.h>
 #include <tradelayer/log.h>
+#include <tradelayer/perfstats.h>
 #include <tradelayer/rules.h>
 #include <tradelayer/sp.h>
-#include <tradelayer/uint256_extensions.h>
 
 #include <tradelayer/tradelayer_matrices.h>
 #include <tradelayer/externfns.h>
 #include <tradelayer/operators_algo_clearing.h>
 
-#include <arith_uint256.h>
 #include <chain.h>
 #include <validation.h>
 #include <tinyformat.h>
@@ -167,6 +167,7 @@ std::string xToString(const uint32_t &value)
 // RETURN:
 static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
 {
+    CPerfTimer perfTimer(PERF_X_TRADE);
     const uint32_t propertyForSale = pnew->getProperty();
     const uint32_t propertyDesired = pnew->getDesProperty();
     MatchReturnType NewReturn = NOTHING;
@@ -240,12 +241,9 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             // purchase from Bob, using Bob's unit price
             // This implies rounding down, since rounding up is impossible, and would
             // require more tokens than Alice has
-            arith_uint256 iCouldBuy = (ConvertTo256(pnew->getAmountRemaining()) * ConvertTo256(pold->getAmountForSale())) / ConvertTo256(pold->getAmountDesired());
-
             int64_t nCouldBuy = 0;
-            if (iCouldBuy < ConvertTo256(pold->getAmountRemaining())) {
-                nCouldBuy = ConvertTo64(iCouldBuy);
-            } else {
+            if (!MulDivChecked(pnew->getAmountRemaining(), pold->getAmountForSale(), pold->getAmountDesired(), nCouldBuy) ||
+                    nCouldBuy >= pold->getAmountRemaining()) {
                 nCouldBuy = pold->getAmountRemaining();
             }
 
@@ -260,16 +258,13 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             // is fractional, always round UP the amount Alice has to pay
             // This will always be better for Bob. Rounding in the other direction
             // will always be impossible, because it would violate Bob's accepted price
-            arith_uint256 iWouldPay = DivideAndRoundUp((ConvertTo256(nCouldBuy) * ConvertTo256(pold->getAmountDesired())), ConvertTo256(pold->getAmountForSale()));
-            int64_t nWouldPay = ConvertTo64(iWouldPay);
+            int64_t nWouldPay = MulDiv(nCouldBuy, pold->getAmountDesired(), pold->getAmountForSale(), ROUND_UP);
 
             // If the resulting adjusted unit price is higher than Alice' price, the
             // orders shall not execute, and no representable fill is made
-            const rational_t xEffectivePrice(nWouldPay, nCouldBuy);
-
-            if (xEffectivePrice > pnew->inversePrice()) {
+            if (CompareFractions(nWouldPay, nCouldBuy, pnew->getAmountForSale(), pnew->getAmountDesired()) > 0) {
                 if (msc_debug_metadex1) PrintToLog(
-                        "-- effective price is too expensive: %s\n", xToString(xEffectivePrice));
+                        "-- effective price is too expensive: %s\n", xToString(rational_t(nWouldPay, nCouldBuy)));
                 ++offerIt;
                 continue;
             }
@@ -285,8 +280,8 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             ///////////////////////////
 
             // postconditions
-            assert(xEffectivePrice >= pold->unitPrice());
-            assert(xEffectivePrice <= pnew->inversePrice());
+            assert(CompareFractions(nWouldPay, nCouldBuy, pold->getAmountDesired(), pold->getAmountForSale()) >= 0);
+            assert(CompareFractions(nWouldPay, nCouldBuy, pnew->getAmountForSale(), pnew->getAmountDesired()) <= 0);
             assert(0 <= seller_amountLeft);
             assert(0 <= buyer_amountLeft);
             assert(seller_amountForSale == seller_amountLeft + buyer_amountGot);
@@ -365,7 +360,7 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
         if (bBuyerSatisfied) break;
     } // check all prices
 
-    PrintToLog("%s()=%d:%s\n", __FUNCTION__, NewReturn, getTradeReturnType(NewReturn));
+    if (msc_debug_metadex1) PrintToLog("%s()=%d:%s\n", __FUNCTION__, NewReturn, getTradeReturnType(NewReturn));
 
     return NewReturn;
 }
@@ -435,9 +430,7 @@ rational_t CMPMetaDEx::inversePrice() const
 int64_t CMPMetaDEx::getAmountToFill() const
 {
     // round up to ensure that the amount we present will actually result in buying all available tokens
-    arith_uint256 iAmountNeededToFill = DivideAndRoundUp((ConvertTo256(amount_remaining) * ConvertTo256(amount_desired)), ConvertTo256(amount_forsale));
-    int64_t nAmountNeededToFill = ConvertTo64(iAmountNeededToFill);
-    return nAmountNeededToFill;
+    return MulDiv(amount_remaining, amount_desired, amount_forsale, ROUND_UP);
 }
 
 int64_t CMPMetaDEx::getBlockTime() const
@@ -449,7 +442,7 @@ int64_t CMPMetaDEx::getBlockTime() const
 void CMPMetaDEx::setAmountRemaining(int64_t amount, const std::string& label)
 {
     amount_remaining = amount;
-    PrintToLog("update remaining amount still up for sale (%ld %s):%s\n", amount, label, ToString());
+    if (msc_debug_metadex1) PrintToLog("update remaining amount still up for sale (%ld %s):%s\n", amount, label, ToString());
 }
 
 std::string CMPMetaDEx::ToString() const
@@ -459,7 +452,7 @@ std::string CMPMetaDEx::ToString() const
         property, FormatMP(property, amount_forsale), desired_property, FormatMP(desired_property, amount_desired));
 }
 
-void CMPMetaDEx::saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const
+void CMPMetaDEx::saveOffer(std::ostream& file, SHA256_CTX* shaCtx) const
 {
     std::string lineOut = strprintf("%s,%d,%d,%d,%d,%d,%d,%d,%s,%d",
         addr,
@@ -899,6 +892,7 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
 
  MatchReturnType x_Trade(CMPContractDex* const pnew)
  {
+   CPerfTimer perfTimer(PERF_X_TRADE);
    const uint32_t propertyForSale = pnew->getProperty();
    uint8_t trdAction = pnew->getTradingAction();
    MatchReturnType NewReturn = NOTHING;
@@ -950,6 +944,7 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
 
  void mastercore::x_TradeBidirectional(typename cd_PricesMap::iterator &it_fwdPrices, typename cd_PricesMap::reverse_iterator &it_bwdPrices, uint8_t trdAction, CMPContractDex* const pnew, const uint64_t sellerPrice, const uint32_t propertyForSale, MatchReturnType &NewReturn)
  {
+   CPerfTimer perfTimer(PERF_X_TRADE_BIDIRECTIONAL);
    cd_Set* const pofferSet = trdAction == BUY ? &(it_fwdPrices->second) : &(it_bwdPrices->second);
 
    /** At good (single) price level and property iterate over offers looking at all parameters to find the match */
@@ -1039,14 +1034,12 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
 
        uint32_t NotionalSize = sp.notional_size;
 
-       arith_uint256 Volume256_t = mastercore::ConvertTo256(NotionalSize)*mastercore::ConvertTo256(nCouldBuy)/COIN;
-       int64_t Volume64_t = mastercore::ConvertTo64(Volume256_t);
+       int64_t Volume64_t = mastercore::MulDiv(NotionalSize, nCouldBuy, COIN);
 
        if(msc_debug_x_trade_bidirectional) PrintToLog("\nNotionalSize = %s\t nCouldBuy = %s\t Volume64_t = %s\n",
  		  FormatDivisibleMP(NotionalSize), FormatDivisibleMP(nCouldBuy), FormatDivisibleMP(Volume64_t));
 
-       arith_uint256 numVWAP256_t = mastercore::ConvertTo256(sellerPrice)*mastercore::ConvertTo256(Volume64_t)/COIN;
-       int64_t numVWAP64_t = mastercore::ConvertTo64(numVWAP256_t);
+       int64_t numVWAP64_t = mastercore::MulDiv(sellerPrice, Volume64_t, COIN);
 
        threading(property_traded, numVWAP64_t, "cdex_price");
        threading(property_traded, Volume64_t, "cdex_volume");
@@ -1897,7 +1890,7 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
  void CMPMetaDEx::setAmountForsale(int64_t amount, const std::string& label)
  {
      amount_forsale = amount;
-     PrintToLog("update remaining amount still up for sale (%ld %s):%s\n", amount, label, ToString());
+     if (msc_debug_contractdex_tx) PrintToLog("update remaining amount still up for sale (%ld %s):%s\n", amount, label, ToString());
  }
 
  void CMPContractDex::setPrice(int64_t price)
@@ -2106,8 +2099,7 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
                      PrintToLog("Address: %d\n",addr);
                  }
                  // arith_uint256 amountMargin = ConvertTo256(amountForSale) * ConvertTo256(marginRe) * ConvertTo256(num) / ConvertTo256(den);
-                 arith_uint256 amountMargin = ConvertTo256(amountForSale) * ConvertTo256(num) / ConvertTo256(den);
-                 int64_t redeemed = ConvertTo64(amountMargin);
+                 int64_t redeemed = MulDiv(amountForSale, num, den);
                  if(msc_debug_contract_cancel_inorder) PrintToLog("redeemed: %d\n",redeemed);
 
                  // move from reserve to balance the collateral
@@ -2258,8 +2250,7 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
  	              int64_t den = conv.denominator().convert_to<int64_t>();
  	              int64_t balance = GetTokenBalance(addr,collateralCurrency,BALANCE);
 
- 	              arith_uint256 amountMargin = (ConvertTo256(amountForSale) * ConvertTo256(marginRe) * ConvertTo256(num) / (ConvertTo256(den) * ConvertTo256(factorE)));
- 	              int64_t redeemed = ConvertTo64(amountMargin);
+ 	              int64_t redeemed = MulMulDiv(amountForSale, marginRe, num, den, factorE);
 
                  if (msc_debug_contract_cancel_every)
                  {
@@ -2381,8 +2372,7 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
  	              int64_t num = conv.numerator().convert_to<int64_t>();
  	              int64_t den = conv.denominator().convert_to<int64_t>();
 
- 	              arith_uint256 amountMargin = (ConvertTo256(amountForSale) * ConvertTo256(marginRe) * ConvertTo256(num) / (ConvertTo256(den) * ConvertTo256(factorE)));
- 	              int64_t redeemed = ConvertTo64(amountMargin);
+ 	              int64_t redeemed = MulMulDiv(amountForSale, marginRe, num, den, factorE);
 
                  if(msc_debug_contract_cancel_forblock)
                  {
@@ -2472,7 +2462,7 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
    return VWAPMapSubVector[numId][denId];
  }
 
- void CMPContractDex::saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const
+ void CMPContractDex::saveOffer(std::ostream& file, SHA256_CTX* shaCtx) const
  {
      std::string lineOut = strprintf("%s,%d,%d,%d,%d,%d,%d,%d,%s,%d,%d,%d",
          getAddr(),
@@ -2504,13 +2494,9 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
         return false;
      }
 
-     arith_uint256 uTakerFee = (ConvertTo256(buyer_amountGot) * ConvertTo256(5)) / ConvertTo256(100);
-     arith_uint256 uMakerFee = (ConvertTo256(buyer_amountGot) * ConvertTo256(4)) / ConvertTo256(100);
-     arith_uint256 uCacheFee = ConvertTo256(buyer_amountGot) / ConvertTo256(100);
-
-     int64_t takerFee = ConvertTo64(uTakerFee);
-     int64_t makerFee = ConvertTo64(uMakerFee);
-     int64_t cacheFee = ConvertTo64(uCacheFee);
+     int64_t takerFee = MulDiv(buyer_amountGot, 5, 100);
+     int64_t makerFee = MulDiv(buyer_amountGot, 4, 100);
+     int64_t cacheFee = MulDiv(buyer_amountGot, 1, 100);
 
      if(msc_debug_metadex_fees) PrintToLog("%s: buyer_amountGot: %d, cacheFee: %d, takerFee: %d, makerFee: %d\n",__func__, buyer_amountGot, cacheFee, takerFee, makerFee);
      //sum check
@@ -2547,12 +2533,9 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
 
      if (sp.prop_type == ALL_PROPERTY_TYPE_ORACLE_CONTRACT)
      {
-         arith_uint256 uTakerFee = (ConvertTo256(nCouldBuy) * ConvertTo256(marginRe) * ConvertTo256(25)) / (ConvertTo256(1000) * ConvertTo256(COIN));  //2.5%
-         arith_uint256 uMakerFee = (ConvertTo256(nCouldBuy) * ConvertTo256(marginRe)) / (ConvertTo256(100) * ConvertTo256(COIN));  // 1%
-
-         cacheFee = ConvertTo64(uMakerFee / ConvertTo256(2));
-         takerFee = ConvertTo64(uTakerFee);
-         makerFee = ConvertTo64(uMakerFee);
+         takerFee = MulMulDiv(nCouldBuy, marginRe, 25, 1000, COIN);  //2.5%
+         makerFee = MulMulDiv(nCouldBuy, marginRe, 1, 100, COIN);  // 1%
+         cacheFee = makerFee / 2;
 
          if (msc_debug_contractdex_fees) PrintToLog("%s: oracles cacheFee: %d, oracles takerFee: %d, oracles makerFee: %d\n",__func__,cacheFee, takerFee, makerFee);
 
@@ -2585,11 +2568,8 @@ const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
 
      } else {      //natives
 
-           arith_uint256 uTakerFee = (ConvertTo256(nCouldBuy) * ConvertTo256(marginRe)) / (ConvertTo256(100) * ConvertTo256(COIN));
-           arith_uint256 uMakerFee = (ConvertTo256(nCouldBuy) * ConvertTo256(marginRe) * ConvertTo256(5)) / (ConvertTo256(1000) * ConvertTo256(COIN));
-
-           takerFee = ConvertTo64(uTakerFee);
-           makerFee = ConvertTo64(uMakerFee);
+           takerFee = MulMulDiv(nCouldBuy, marginRe, 1, 100, COIN);
+           makerFee = MulMulDiv(nCouldBuy, marginRe, 5, 1000, COIN);
 
            if (msc_debug_contractdex_fees) PrintToLog("%s: natives takerFee: %d, natives makerFee: %d\n",__func__,takerFee, makerFee);
 
@@ -123,7 +123,7 @@ public:
     /** Used for display of unit prices with 50 decimal places at RPC layer. */
     std::string displayFullUnitPrice() const;
 
-    void saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const;
+    void saveOffer(std::ostream& file, SHA256_CTX* shaCtx) const;
 };
 
 class CMPContractDex : public CMPMetaDEx
@@ -157,7 +157,7 @@ class CMPContractDex : public CMPMetaDEx
   std::string displayFullContractPrice() const;
   std::string ToString() const;
 
-  void saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const;
+  void saveOffer(std::ostream& file, SHA256_CTX* shaCtx) const;
 
   void setPrice(int64_t price);
 
@@ -1,5 +1,6 @@
 #include <tradelayer/notifications.h>
 
+#include <tradelayer/blockevents.h>
 #include <tradelayer/log.h>
 #include <tradelayer/utilsbitcoin.h>
 #include <tradelayer/version.h>
@@ -49,6 +50,7 @@ void DeleteAlerts(const std::string& sender)
 void ClearAlerts()
 {
     currentTLAlerts.clear();
+    ClearBlockEvents(BLOCK_EVENT_ALERT_EXPIRY);
     uiInterface.TLStateChanged();
 }
 
@@ -71,6 +73,8 @@ void AddAlert(const std::string& sender, uint16_t alertType, uint32_t alertExpir
     }
 
     currentTLAlerts.push_back(newAlert);
+    // alerts, which don't expire by block, are checked at the next block
+    ScheduleBlockEvent(BLOCK_EVENT_ALERT_EXPIRY, (alertType == ALERT_BLOCK_EXPIRY) ? static_cast<int>(alertExpiry) : 0);
     PrintToLog("New alert added: %s, %d, %d, %s\n", sender, alertType, alertExpiry, alertMessage);
 }
 
@@ -166,6 +170,8 @@ bool CheckExpiredAlerts(unsigned int curBlock, uint64_t curTime)
                     it = currentTLAlerts.erase(it);
                     uiInterface.TLStateChanged();
                 } else {
+                    // the block time is unknown in advance, so check again with the next block
+                    ScheduleBlockEvent(BLOCK_EVENT_ALERT_EXPIRY, curBlock + 1);
                     it++;
                 }
             break;
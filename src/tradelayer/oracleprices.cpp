@@ -0,0 +1,186 @@
+/**
+ * @file oracleprices.cpp
+ *
+ * This file contains the recent oracle price updates of the contracts, and
+ * the aggregates, which are derived from them.
+ */
+
+#include <tradelayer/oracleprices.h>
+
+#include <tradelayer/dbspinfo.h>
+#include <tradelayer/log.h>
+#include <tradelayer/sp.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+namespace mastercore
+{
+//! Oracle updates, indexed by contract
+static std::map<uint32_t, COracleSeries> mapOracleSeries;
+//! Contracts with oracle updates, which are not yet stored in the property entry
+static std::set<uint32_t> setUpdatedContracts;
+
+COracleSeries::COracleSeries(size_t capacity) : nCapacity(capacity), nFirst(0), nCount(0), nWeightedHigh(0), nWeightedLow(0)
+{
+    assert(nCapacity > 0);
+}
+
+void COracleSeries::AddInterval(const OracleSample& from, int toBlock, int sign)
+{
+    const int64_t blocks = toBlock - from.block;
+    nWeightedHigh += boost::multiprecision::int128_t(from.high) * blocks * sign;
+    nWeightedLow += boost::multiprecision::int128_t(from.low) * blocks * sign;
+}
+
+void COracleSeries::Add(int block, int64_t high, int64_t low)
+{
+    if (nCount == nCapacity) {
+        if (nCount > 1) AddInterval(At(0), At(1).block, -1);
+        nFirst = (nFirst + 1) % nCapacity;
+        --nCount;
+    }
+    if (nCount > 0) {
+        AddInterval(Last(), block, 1);
+    }
+
+    const size_t pos = (nFirst + nCount) % nCapacity;
+    if (pos < vSamples.size()) {
+        vSamples[pos] = OracleSample(block, high, low);
+    } else {
+        vSamples.push_back(OracleSample(block, high, low));
+    }
+    ++nCount;
+}
+
+void COracleSeries::DeleteAboveBlock(int block)
+{
+    while (nCount > 0 && Last().block >= block) {
+        if (nCount > 1) AddInterval(At(nCount - 2), Last().block, -1);
+        --nCount;
+    }
+    if (nCount == 0) {
+        nFirst = 0;
+        vSamples.clear();
+    }
+}
+
+std::vector<OracleSample> COracleSeries::GetLast(size_t count) const
+{
+    std::vector<OracleSample> samples;
+    for (size_t n = nCount; n > 0 && samples.size() < count; --n) {
+        samples.push_back(At(n - 1));
+    }
+    return samples;
+}
+
+bool COracleSeries::GetSummary(int block, OracleSummary& summary) const
+{
+    if (nCount == 0) return false;
+
+    const OracleSample& first = At(0);
+    const OracleSample& last = Last();
+
+    summary.count = nCount;
+    summary.firstBlock = first.block;
+    summary.last = last;
+
+    // the last price is valid until the given block
+    const int endBlock = std::max(block, last.block);
+    const int64_t blocks = endBlock - first.block;
+    if (blocks > 0) {
+        boost::multiprecision::int128_t weightedHigh = nWeightedHigh + boost::multiprecision::int128_t(last.high) * (endBlock - last.block);
+        boost::multiprecision::int128_t weightedLow = nWeightedLow + boost::multiprecision::int128_t(last.low) * (endBlock - last.block);
+        summary.twapHigh = static_cast<int64_t>(weightedHigh / blocks);
+        summary.twapLow = static_cast<int64_t>(weightedLow / blocks);
+    } else {
+        summary.twapHigh = last.high;
+        summary.twapLow = last.low;
+    }
+
+    summary.minLow = last.low;
+    summary.maxHigh = last.high;
+    for (size_t n = 0; n < nCount; ++n) {
+        const OracleSample& sample = At(n);
+        summary.minLow = std::min(summary.minLow, sample.low);
+        summary.maxHigh = std::max(summary.maxHigh, sample.high);
+    }
+
+    return true;
+}
+
+void AddOracleSample(uint32_t contractId, int block, int64_t high, int64_t low)
+{
+    mapOracleSeries[contractId].Add(block, high, low);
+    setUpdatedContracts.insert(contractId);
+}
+
+const COracleSeries* GetOracleSeries(uint32_t contractId)
+{
+    std::map<uint32_t, COracleSeries>::const_iterator it = mapOracleSeries.find(contractId);
+    if (it == mapOracleSeries.end() || it->second.Empty()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+const std::map<uint32_t, COracleSeries>& GetAllOracleSeries()
+{
+    return mapOracleSeries;
+}
+
+bool RestoreOracleSample(uint32_t contractId, int block, int64_t high, int64_t low)
+{
+    COracleSeries& series = mapOracleSeries[contractId];
+    if (!series.Empty() && block < series.Last().block) {
+        return false;
+    }
+    series.Add(block, high, low);
+    return true;
+}
+
+void FlushOracleUpdates()
+{
+    for (std::set<uint32_t>::const_iterator it = setUpdatedContracts.begin(); it != setUpdatedContracts.end(); ++it) {
+        const uint32_t contractId = *it;
+        const COracleSeries* series = GetOracleSeries(contractId);
+        CMPSPInfo::Entry sp;
+        if (!series || !pDbSpInfo->getSP(contractId, sp)) {
+            continue;
+        }
+
+        const OracleSample& last = series->Last();
+        sp.oracle_high = last.high;
+        sp.oracle_low = last.low;
+        sp.oracle_last_update = last.block;
+
+        if (!pDbSpInfo->updateSP(contractId, sp)) {
+            PrintToLog("%s(): ERROR: failed to store the oracle prices of contract %d\n", __func__, contractId);
+        }
+    }
+    setUpdatedContracts.clear();
+}
+
+void DeleteOracleSamplesAboveBlock(int block)
+{
+    for (std::map<uint32_t, COracleSeries>::iterator it = mapOracleSeries.begin(); it != mapOracleSeries.end(); ) {
+        it->second.DeleteAboveBlock(block);
+        if (it->second.Empty()) {
+            mapOracleSeries.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+    setUpdatedContracts.clear();
+}
+
+void ClearOracleSamples()
+{
+    mapOracleSeries.clear();
+    setUpdatedContracts.clear();
+}
+}
@@ -0,0 +1,97 @@
+#ifndef BITCOIN_TRADELAYER_ORACLEPRICES_H
+#define BITCOIN_TRADELAYER_ORACLEPRICES_H
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+namespace mastercore
+{
+/** The number of oracle updates kept per contract. */
+const size_t MAX_ORACLE_SAMPLES = 1000;
+
+/** An oracle price update. */
+struct OracleSample
+{
+    int block;
+    int64_t high;
+    int64_t low;
+
+    OracleSample() : block(0), high(0), low(0) {}
+    OracleSample(int blockIn, int64_t highIn, int64_t lowIn) : block(blockIn), high(highIn), low(lowIn) {}
+};
+
+/** Aggregates over the kept oracle updates of a contract. */
+struct OracleSummary
+{
+    size_t count;
+    int firstBlock;
+    OracleSample last;
+    int64_t twapHigh;   // high prices, weighted by the number of blocks they were valid
+    int64_t twapLow;    // low prices, weighted by the number of blocks they were valid
+    int64_t minLow;
+    int64_t maxHigh;
+};
+
+/**
+ * Bounded series of oracle updates of one contract.
+ *
+ * The samples are stored in a ring buffer, which overwrites the oldest sample
+ * when full. The block weighted sums of the prices are updated with every
+ * change, so the time weighted average price doesn't require a pass over the
+ * samples.
+ */
+class COracleSeries
+{
+private:
+    std::vector<OracleSample> vSamples;
+    size_t nCapacity;
+    size_t nFirst;
+    size_t nCount;
+
+    //! Sums of price times the number of blocks until the next sample, for all but the last sample
+    boost::multiprecision::int128_t nWeightedHigh;
+    boost::multiprecision::int128_t nWeightedLow;
+
+    void AddInterval(const OracleSample& from, int toBlock, int sign);
+
+public:
+    explicit COracleSeries(size_t capacity = MAX_ORACLE_SAMPLES);
+
+    /** Appends an update; samples must be added in block order. */
+    void Add(int block, int64_t high, int64_t low);
+    /** Removes all samples at or above the given block. */
+    void DeleteAboveBlock(int block);
+
+    size_t Size() const { return nCount; }
+    bool Empty() const { return nCount == 0; }
+    /** Returns the n-th oldest sample. */
+    const OracleSample& At(size_t n) const { return vSamples[(nFirst + n) % nCapacity]; }
+    const OracleSample& Last() const { return At(nCount - 1); }
+
+    /** Returns up to count samples, the most recent first. */
+    std::vector<OracleSample> GetLast(size_t count) const;
+    /** Computes the aggregates from the first sample up to the given block. */
+    bool GetSummary(int block, OracleSummary& summary) const;
+};
+
+/** Records an oracle update of a contract; the property entry is updated at the end of the block. */
+void AddOracleSample(uint32_t contractId, int block, int64_t high, int64_t low);
+/** Returns the oracle updates of a contract, or nullptr, if there are none. */
+const COracleSeries* GetOracleSeries(uint32_t contractId);
+/** Returns the oracle updates of all contracts. */
+const std::map<uint32_t, COracleSeries>& GetAllOracleSeries();
+/** Restores an oracle update from the state files; updates of a contract must be restored in block order. */
+bool RestoreOracleSample(uint32_t contractId, int block, int64_t high, int64_t low);
+/** Stores the latest oracle prices of the contracts updated in this block in their property entries. */
+void FlushOracleUpdates();
+/** Removes the oracle updates at or above the given block, used for rollbacks. */
+void DeleteOracleSamplesAboveBlock(int block);
+/** Removes all oracle updates. */
+void ClearOracleSamples();
+}
+
+#endif // BITCOIN_TRADELAYER_ORACLEPRICES_H
@@ -0,0 +1,137 @@
+/**
+ * @file perfstats.cpp
+ *
+ * This file contains latency histograms for the phases of block and transaction processing.
+ */
+
+#include <tradelayer/perfstats.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace mastercore
+{
+//! Latency histograms, indexed by stage
+static CPerfHistogram perfHistograms[PERF_STAGE_COUNT];
+
+CPerfHistogram::CPerfHistogram()
+{
+    Reset();
+}
+
+int CPerfHistogram::BucketIndex(uint64_t micros)
+{
+    int index = 0;
+    while (micros > 0 && index < PERF_HISTOGRAM_BUCKETS - 1) {
+        micros >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+uint64_t CPerfHistogram::BucketUpperBound(int index)
+{
+    assert(index >= 0 && index < PERF_HISTOGRAM_BUCKETS);
+    return (uint64_t) 1 << index;
+}
+
+void CPerfHistogram::Add(uint64_t micros)
+{
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalMicros.fetch_add(micros, std::memory_order_relaxed);
+    buckets[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t prevMax = maxMicros.load(std::memory_order_relaxed);
+    while (micros > prevMax && !maxMicros.compare_exchange_weak(prevMax, micros, std::memory_order_relaxed)) {
+    }
+}
+
+void CPerfHistogram::Reset()
+{
+    count = 0;
+    totalMicros = 0;
+    maxMicros = 0;
+    for (int i = 0; i < PERF_HISTOGRAM_BUCKETS; ++i) {
+        buckets[i] = 0;
+    }
+}
+
+PerfStageStats CPerfHistogram::GetStats() const
+{
+    PerfStageStats stats;
+    stats.count = count.load(std::memory_order_relaxed);
+    stats.totalMicros = totalMicros.load(std::memory_order_relaxed);
+    stats.maxMicros = maxMicros.load(std::memory_order_relaxed);
+    for (int i = 0; i < PERF_HISTOGRAM_BUCKETS; ++i) {
+        stats.buckets.push_back(buckets[i].load(std::memory_order_relaxed));
+    }
+    return stats;
+}
+
+uint64_t PerfStageStats::Percentile(double percentile) const
+{
+    uint64_t samples = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        samples += buckets[i];
+    }
+    if (samples == 0) return 0;
+
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * samples);
+    if (rank >= samples) rank = samples - 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            if (i + 1 == buckets.size()) return maxMicros;
+            return CPerfHistogram::BucketUpperBound(i);
+        }
+    }
+    return maxMicros;
+}
+
+std::string GetPerfStageName(PerfStage stage)
+{
+    switch (stage) {
+        case PERF_BLOCK_BEGIN: return "handler_block_begin";
+        case PERF_HANDLER_TX: return "handler_tx";
+        case PERF_BLOCK_END: return "handler_block_end";
+        case PERF_MAKE_WITHDRAWALS: return "makeWithdrawals";
+        case PERF_UPDATE_SUM_UPNLS: return "update_sum_upnls";
+        case PERF_MARGIN_MAIN: return "marginMain";
+        case PERF_PERSIST_STATE: return "PersistInMemoryState";
+        case PERF_CONSENSUS_HASH: return "GetConsensusHash";
+        case PERF_X_TRADE: return "x_Trade";
+        case PERF_X_TRADE_BIDIRECTIONAL: return "x_TradeBidirectional";
+        case PERF_PARSE_TRANSACTION: return "parseTransaction";
+        default: return "unknown";
+    }
+}
+
+void RecordPerfSample(PerfStage stage, uint64_t micros)
+{
+    assert(stage < PERF_STAGE_COUNT);
+    perfHistograms[stage].Add(micros);
+}
+
+std::vector<PerfStageStats> GetPerfStats()
+{
+    std::vector<PerfStageStats> vStats;
+    for (int i = 0; i < PERF_STAGE_COUNT; ++i) {
+        PerfStageStats stats = perfHistograms[i].GetStats();
+        stats.name = GetPerfStageName(static_cast<PerfStage>(i));
+        vStats.push_back(stats);
+    }
+    return vStats;
+}
+
+void ResetPerfStats()
+{
+    for (int i = 0; i < PERF_STAGE_COUNT; ++i) {
+        perfHistograms[i].Reset();
+    }
+}
+
+} // namespace mastercore
@@ -0,0 +1,110 @@
+#ifndef BITCOIN_TRADELAYER_PERFSTATS_H
+#define BITCOIN_TRADELAYER_PERFSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace mastercore
+{
+/** Phases of block and transaction processing, which are timed. */
+enum PerfStage
+{
+    PERF_BLOCK_BEGIN = 0,
+    PERF_HANDLER_TX,
+    PERF_BLOCK_END,
+    PERF_MAKE_WITHDRAWALS,
+    PERF_UPDATE_SUM_UPNLS,
+    PERF_MARGIN_MAIN,
+    PERF_PERSIST_STATE,
+    PERF_CONSENSUS_HASH,
+    PERF_X_TRADE,
+    PERF_X_TRADE_BIDIRECTIONAL,
+    PERF_PARSE_TRANSACTION,
+    PERF_STAGE_COUNT
+};
+
+/** Number of histogram buckets, each covering twice the range of the previous one. */
+const int PERF_HISTOGRAM_BUCKETS = 28;
+
+/** A snapshot of the latency histogram of one stage. */
+struct PerfStageStats
+{
+    std::string name;
+    uint64_t count;
+    uint64_t totalMicros;
+    uint64_t maxMicros;
+    std::vector<uint64_t> buckets;
+
+    /** Returns the upper bound of the bucket, which contains the given percentile. */
+    uint64_t Percentile(double percentile) const;
+};
+
+/**
+ * Fixed-bucket latency histogram.
+ *
+ * Bucket 0 counts samples below one microsecond, bucket n counts samples in
+ * [2^(n-1), 2^n) microseconds, and the last bucket counts everything above.
+ * Updates are lock-free, so it can be fed from any thread.
+ */
+class CPerfHistogram
+{
+private:
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> totalMicros;
+    std::atomic<uint64_t> maxMicros;
+    std::atomic<uint64_t> buckets[PERF_HISTOGRAM_BUCKETS];
+
+public:
+    CPerfHistogram();
+
+    /** Adds a sample. */
+    void Add(uint64_t micros);
+    /** Removes all samples. */
+    void Reset();
+    /** Returns a copy of the current state. */
+    PerfStageStats GetStats() const;
+
+    /** Returns the index of the bucket, which covers the given duration. */
+    static int BucketIndex(uint64_t micros);
+    /** Returns the exclusive upper bound of a bucket in microseconds. */
+    static uint64_t BucketUpperBound(int index);
+};
+
+/** Returns the name of a stage, as shown by the RPC interface. */
+std::string GetPerfStageName(PerfStage stage);
+/** Adds a sample to the histogram of a stage. */
+void RecordPerfSample(PerfStage stage, uint64_t micros);
+/** Returns snapshots of the histograms of all stages. */
+std::vector<PerfStageStats> GetPerfStats();
+/** Removes all samples of all stages. */
+void ResetPerfStats();
+
+/**
+ * Measures the lifetime of the object and records it for a stage.
+ *
+ * Usage: CPerfTimer timer(PERF_BLOCK_END); at the beginning of a scope.
+ */
+class CPerfTimer
+{
+private:
+    const PerfStage stage;
+    const std::chrono::steady_clock::time_point start;
+
+public:
+    explicit CPerfTimer(PerfStage stageIn)
+    : stage(stageIn), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~CPerfTimer()
+    {
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+        RecordPerfSample(stage, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+};
+}
+
+#endif // BITCOIN_TRADELAYER_PERFSTATS_H
@@ -6,13 +6,17 @@
 
 #include <tradelayer/persistence.h>
 
+#include <tradelayer/blockevents.h>
 #include <tradelayer/dex.h>
 #include <tradelayer/log.h>
 #include <tradelayer/mdex.h>
+#include <tradelayer/oracleprices.h>
+#include <tradelayer/perfstats.h>
 #include <tradelayer/rules.h>
 #include <tradelayer/sp.h>
 #include <tradelayer/tally.h>
 #include <tradelayer/utilsbitcoin.h>
+#include <tradelayer/walletcache.h>
 
 #include <chain.h>
 #include <fs.h>
@@ -29,9 +33,17 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <iterator>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -57,6 +69,7 @@ enum FILETYPES {
   FILETYPE_CACHEFEES,
   FILETYPE_WITHDRAWALS,
   FILETYPE_ACTIVE_CHANNELS,
+  FILETYPE_ORACLES,
   NUM_FILETYPES
 };
 
@@ -66,7 +79,61 @@ static char const * const statePrefix[NUM_FILETYPES] = {
     "accepts",
     "globals",
     "mdexorders",
+    "marketprices",
     "cdexorders",
+    "cachefees",
+    "withdrawals",
+    "channels",
+    "oracles",
+};
+
+/** Copy of the in-memory state as of a block, which is written by the background writer. */
+struct StateSnapshot
+{
+    fs::path directory;
+    uint256 blockHash;
+    uint256 prevBlockHash;
+    int blockHeight;
+    int baseInterval;
+
+    std::unordered_map<std::string, CMPTally> tally;
+    OfferMap offers;
+    AcceptMap accepts;
+    uint32_t nextSPID;
+    uint32_t nextTestSPID;
+    md_PropertiesMap metadex;
+    cd_PropertiesMap contractdex;
+    std::map<uint32_t, int64_t> cachefees;
+    std::map<std::string, std::vector<withdrawalAccepted> > withdrawals;
+    std::map<std::string, channel> channels;
+    uint64_t marketPrices[NPTYPES];
+    std::map<uint32_t, COracleSeries> oracles;
+};
+
+/** Maximum number of snapshots waiting for the background writer, before new ones have to wait. */
+static const size_t MAX_PENDING_SNAPSHOTS = 2;
+
+/** Maximum number of blocks between full state files, when only the changed lines are written in between. */
+static const int MAX_STATE_BASE_INTERVAL = 1000;
+
+/** Maximum number of delta files, which are applied on top of a full state file. */
+static const int MAX_DELTA_CHAIN = MAX_STATE_BASE_INTERVAL;
+
+/** First line of a delta file, followed by the hash of the block it is based on. */
+static const std::string DELTA_HEADER = "#delta ";
+
+/** The state files written for every block. */
+static const int persistedFileTypes[] = {
+    FILETYPE_BALANCES,
+    FILETYPE_OFFERS,
+    FILETYPE_ACCEPTS,
+    FILETYPE_GLOBALS,
+    FILETYPE_MDEXORDERS,
+    FILETYPE_CDEXORDERS,
+    FILETYPE_CACHEFEES,
+    FILETYPE_WITHDRAWALS,
+    FILETYPE_ACTIVE_CHANNELS,
+    FILETYPE_ORACLES,
 };
 
 static bool is_state_prefix(std::string const &str)
@@ -80,10 +147,10 @@ static bool is_state_prefix(std::string const &str)
     return false;
 }
 
-static int write_msc_balances(std::ofstream& file, SHA256_CTX* shaCtx)
+static int write_msc_balances(std::ostream& file, SHA256_CTX* shaCtx, StateSnapshot& state)
 {
     std::unordered_map<std::string, CMPTally>::iterator iter;
-    for (iter = mp_tally_map.begin(); iter != mp_tally_map.end(); ++iter) {
+    for (iter = state.tally.begin(); iter != state.tally.end(); ++iter) {
         bool emptyWallet = true;
 
         std::string lineOut = (*iter).first;
@@ -125,25 +192,22 @@ static int write_msc_balances(std::ofstream& file, SHA256_CTX* shaCtx)
     return 0;
 }
 
-static int write_mp_offers(std::ofstream& file, SHA256_CTX* shaCtx)
+static int write_mp_offers(std::ostream& file, SHA256_CTX* shaCtx, const StateSnapshot& state)
 {
     OfferMap::const_iterator iter;
-    for (iter = my_offers.begin(); iter != my_offers.end(); ++iter) {
-        // decompose the key for address
-        std::vector<std::string> vstr;
-        boost::split(vstr, iter->first, boost::is_any_of("-"), boost::token_compress_on);
+    for (iter = state.offers.begin(); iter != state.offers.end(); ++iter) {
         const CMPOffer& offer = iter->second;
-        offer.saveOffer(file, shaCtx, vstr[0]);
+        offer.saveOffer(file, shaCtx, iter->first.first);
     }
 
     return 0;
 }
 
-static int write_market_pricescd(ofstream &file, SHA256_CTX *shaCtx)
+static int write_market_pricescd(std::ostream& file, SHA256_CTX *shaCtx, const StateSnapshot& state)
 {
   std::string lineOut;
 
-  for (int i = 0; i < NPTYPES; i++) lineOut.append(strprintf("%d", marketP[i]));
+  for (int i = 0; i < NPTYPES; i++) lineOut.append(strprintf("%d", state.marketPrices[i]));
   // add the line to the hash
   SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
   // write the line
@@ -152,27 +216,22 @@ static int write_market_pricescd(ofstream &file, SHA256_CTX *shaCtx)
   return 0;
 }
 
-static int write_mp_accepts(std::ofstream& file, SHA256_CTX* shaCtx)
+static int write_mp_accepts(std::ostream& file, SHA256_CTX* shaCtx, const StateSnapshot& state)
 {
     AcceptMap::const_iterator iter;
-    for (iter = my_accepts.begin(); iter != my_accepts.end(); ++iter) {
-        // decompose the key for address
-        std::vector<std::string> vstr;
-        boost::split(vstr, iter->first, boost::is_any_of("-+"), boost::token_compress_on);
+    for (iter = state.accepts.begin(); iter != state.accepts.end(); ++iter) {
         const CMPAccept& accept = iter->second;
-        accept.saveAccept(file, shaCtx, vstr[0], vstr[1]);
+        accept.saveAccept(file, shaCtx, iter->first.seller, iter->first.buyer);
     }
 
     return 0;
 }
 
-static int write_globals_state(std::ofstream& file, SHA256_CTX* shaCtx)
+static int write_globals_state(std::ostream& file, SHA256_CTX* shaCtx, const StateSnapshot& state)
 {
-    uint32_t nextSPID = pDbSpInfo->peekNextSPID(TL_PROPERTY_MSC);
-    uint32_t nextTestSPID = pDbSpInfo->peekNextSPID(TL_PROPERTY_TMSC);
     std::string lineOut = strprintf("%d,%d",
-            nextSPID,
-            nextTestSPID);
+            state.nextSPID,
+            state.nextTestSPID);
 
     // add the line to the hash
     SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
@@ -183,13 +242,13 @@ static int write_globals_state(std::ofstream& file, SHA256_CTX* shaCtx)
     return 0;
 }
 
-static int write_mp_metadex(std::ofstream &file, SHA256_CTX* shaCtx)
+static int write_mp_metadex(std::ostream& file, SHA256_CTX* shaCtx, const StateSnapshot& state)
 {
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        md_PricesMap& prices = my_it->second;
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
-            md_Set& indexes = (it->second);
-            for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it) {
+    for (md_PropertiesMap::const_iterator my_it = state.metadex.begin(); my_it != state.metadex.end(); ++my_it) {
+        const md_PricesMap& prices = my_it->second;
+        for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
+            const md_Set& indexes = (it->second);
+            for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
                 const CMPMetaDEx& meta = *it;
                 meta.saveOffer(file, shaCtx);
             }
@@ -199,15 +258,15 @@ static int write_mp_metadex(std::ofstream &file, SHA256_CTX* shaCtx)
     return 0;
 }
 
-static int write_mp_contractdex(ofstream &file, SHA256_CTX *shaCtx)
+static int write_mp_contractdex(std::ostream& file, SHA256_CTX *shaCtx, const StateSnapshot& state)
 {
-  for (cd_PropertiesMap::iterator my_it = contractdex.begin(); my_it != contractdex.end(); ++my_it)
+  for (cd_PropertiesMap::const_iterator my_it = state.contractdex.begin(); my_it != state.contractdex.end(); ++my_it)
   {
-    cd_PricesMap &prices = my_it->second;
-    for (cd_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it)
+    const cd_PricesMap &prices = my_it->second;
+    for (cd_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it)
     {
-      cd_Set &indexes = (it->second);
-      for (cd_Set::iterator it = indexes.begin(); it != indexes.end(); ++it)
+      const cd_Set &indexes = (it->second);
+      for (cd_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it)
       {
         CMPContractDex contract = *it;
         contract.saveOffer(file, shaCtx);
@@ -217,11 +276,11 @@ static int write_mp_contractdex(ofstream &file, SHA256_CTX *shaCtx)
   return 0;
 }
 
-static int write_mp_cachefees(std::ofstream& file, SHA256_CTX* shaCtx)
+static int write_mp_cachefees(std::ostream& file, SHA256_CTX* shaCtx, const StateSnapshot& state)
 {
     std::string lineOut;
 
-    for (std::map<uint32_t, int64_t>::iterator itt = cachefees.begin(); itt != cachefees.end(); ++itt) {
+    for (std::map<uint32_t, int64_t>::const_iterator itt = state.cachefees.begin(); itt != state.cachefees.end(); ++itt) {
         // decompose the key for address
         uint32_t propertyId = itt->first;
         int64_t cache = itt->second;
@@ -239,11 +298,11 @@ static int write_mp_cachefees(std::ofstream& file, SHA256_CTX* shaCtx)
 }
 
 /** Saving pending withdrawals **/
-static int write_mp_withdrawals(std::ofstream& file, SHA256_CTX* shaCtx)
+static int write_mp_withdrawals(std::ostream& file, SHA256_CTX* shaCtx, const StateSnapshot& state)
 {
     std::string lineOut;
 
-    for (std::map<std::string,vector<withdrawalAccepted>>::iterator it = withdrawal_Map.begin(); it != withdrawal_Map.end(); ++it)
+    for (std::map<std::string,vector<withdrawalAccepted>>::const_iterator it = state.withdrawals.begin(); it != state.withdrawals.end(); ++it)
     {
         // decompose the key for address
         std::string chnAddr = it->first;
@@ -268,11 +327,11 @@ static int write_mp_withdrawals(std::ofstream& file, SHA256_CTX* shaCtx)
 }
 
 /**Saving map of active channels**/
-static int write_mp_active_channels(std::ofstream& file, SHA256_CTX* shaCtx)
+static int write_mp_active_channels(std::ostream& file, SHA256_CTX* shaCtx, const StateSnapshot& state)
 {
     std::string lineOut;
 
-    for (std::map<std::string,channel>::iterator it = channels_Map.begin(); it != channels_Map.end(); ++it)
+    for (std::map<std::string,channel>::const_iterator it = state.channels.begin(); it != state.channels.end(); ++it)
     {
         // decompose the key for address
         std::string chnAddr = it->first;
@@ -291,6 +350,31 @@ static int write_mp_active_channels(std::ofstream& file, SHA256_CTX* shaCtx)
     return 0;
 }
 
+/**
+ * Saves the kept oracle updates, one line per update, oldest first.
+ *
+ * The block is zero padded, so the updates of a contract stay in block order,
+ * when the lines of a delta chain are sorted.
+ */
+static int write_mp_oracles(std::ostream& file, SHA256_CTX* shaCtx, const StateSnapshot& state)
+{
+    for (std::map<uint32_t, COracleSeries>::const_iterator it = state.oracles.begin(); it != state.oracles.end(); ++it) {
+        const COracleSeries& series = it->second;
+        for (size_t n = 0; n < series.Size(); ++n) {
+            const OracleSample& sample = series.At(n);
+            std::string lineOut = strprintf("%d,%010d,%d,%d", it->first, sample.block, sample.high, sample.low);
+
+            // add the line to the hash
+            SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
+
+            // write the line
+            file << lineOut << endl;
+        }
+    }
+
+    return 0;
+}
+
 static int input_msc_balances_string(const std::string& s)
 {
     // "address=propertybalancedata"
@@ -361,10 +445,9 @@ static int input_mp_offers_string(const std::string& s)
     // TODO: should this be here? There are usually no sanity checks..
     if (TL_PROPERTY_BTC != prop_desired) return -1;
 
-    const std::string combo = STR_SELLOFFER_ADDR_PROP_COMBO(sellerAddr, prop);
     CMPOffer newOffer(offerBlock, amountOriginal, prop, btcDesired, minFee, blocktimelimit, txid, option);
 
-    if (!my_offers.insert(std::make_pair(combo, newOffer)).second) return -1;
+    if (!my_offers.insert(std::make_pair(DExOfferKey(sellerAddr, prop), newOffer)).second) return -1;
 
     return 0;
 }
@@ -396,9 +479,9 @@ static int input_mp_accepts_string(const std::string& s)
     btcDesired = boost::lexical_cast<int64_t>(vstr[i++]);
     txidStr = vstr[i++];
 
-    const std::string combo = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(sellerAddr, buyerAddr, prop);
     CMPAccept newAccept(amountOriginal, amountRemaining, nBlock, blocktimelimit, prop, offerOriginal, btcDesired, uint256S(txidStr));
-    if (my_accepts.insert(std::make_pair(combo, newAccept)).second) {
+    if (DEx_acceptInsert(DExAcceptKey(sellerAddr, prop, buyerAddr), newAccept)) {
+        ScheduleBlockEvent(BLOCK_EVENT_ACCEPT_EXPIRY, nBlock + blocktimelimit, STR_ACCEPT_ADDR_PROP_ADDR_COMBO(sellerAddr, buyerAddr, prop));
         return 0;
     } else {
         return -1;
@@ -492,6 +575,24 @@ static int input_market_prices_string(const std::string& s)
    return 0;
 }
 
+static int input_oracles_string(const std::string& s)
+{
+    // "contractid,block,high,low"
+    std::vector<std::string> vstr;
+    boost::split(vstr, s, boost::is_any_of(","), boost::token_compress_on);
+
+    if (4 != vstr.size()) return -1;
+
+    uint32_t contractId = boost::lexical_cast<uint32_t>(vstr[0]);
+    int block = boost::lexical_cast<int>(vstr[1]);
+    int64_t high = boost::lexical_cast<int64_t>(vstr[2]);
+    int64_t low = boost::lexical_cast<int64_t>(vstr[3]);
+
+    if (!RestoreOracleSample(contractId, block, high, low)) return -1;
+
+    return 0;
+}
+
 static int input_cachefees_string(const std::string& s)
 {
    std::vector<std::string> vstr;
@@ -525,13 +626,14 @@ static int input_withdrawals_string(const std::string& s)
 
     if (it != withdrawal_Map.end())
     {
-        whAc = it->second;
-        whAc.push_back(w);
+        it->second.push_back(w);
     } else {
         whAc.push_back(w);
         if(!withdrawal_Map.insert(std::make_pair(chnAddr,whAc)).second) return -1;
     }
 
+    ScheduleBlockEvent(BLOCK_EVENT_WITHDRAWAL, w.deadline_block, chnAddr);
+
     return 0;
 
 }
@@ -558,13 +660,15 @@ static int input_activechannels_string(const std::string& s)
 }
 
 
-static int write_state_file(const CBlockIndex* pBlockIndex, int what)
+/**
+ * Formats the state of one file type.
+ *
+ * @param content[out]  The lines of the state file
+ * @param hash[out]     The hash of the lines in the given order
+ */
+static int format_state(StateSnapshot& state, int what, std::string& content, uint256& hash)
 {
-    fs::path path = pathStateFiles / strprintf("%s-%s.dat", statePrefix[what], pBlockIndex->GetBlockHash().ToString());
-    const std::string strFile = path.string();
-
-    std::ofstream file;
-    file.open(strFile.c_str());
+    std::ostringstream file;
 
     SHA256_CTX shaCtx;
     SHA256_Init(&shaCtx);
@@ -573,64 +677,218 @@ static int write_state_file(const CBlockIndex* pBlockIndex, int what)
 
     switch (what) {
         case FILETYPE_BALANCES:
-            result = write_msc_balances(file, &shaCtx);
+            result = write_msc_balances(file, &shaCtx, state);
             break;
 
         case FILETYPE_OFFERS:
-            result = write_mp_offers(file, &shaCtx);
+            result = write_mp_offers(file, &shaCtx, state);
             break;
 
         case FILETYPE_ACCEPTS:
-            result = write_mp_accepts(file, &shaCtx);
+            result = write_mp_accepts(file, &shaCtx, state);
             break;
 
         case FILETYPE_GLOBALS:
-            result = write_globals_state(file, &shaCtx);
+            result = write_globals_state(file, &shaCtx, state);
             break;
 
         case FILETYPE_MDEXORDERS:
-            result = write_mp_metadex(file, &shaCtx);
+            result = write_mp_metadex(file, &shaCtx, state);
             break;
 
         case FILETYPE_CDEXORDERS:
-            result = write_mp_contractdex(file, &shaCtx);
+            result = write_mp_contractdex(file, &shaCtx, state);
             break;
 
         case FILETYPE_CACHEFEES:
-            result = write_mp_cachefees(file, &shaCtx);
+            result = write_mp_cachefees(file, &shaCtx, state);
             break;
 
         case FILETYPE_WITHDRAWALS:
-            result = write_mp_withdrawals(file, &shaCtx);
+            result = write_mp_withdrawals(file, &shaCtx, state);
             break;
 
         case FILETYPE_ACTIVE_CHANNELS:
-            result = write_mp_active_channels(file, &shaCtx);
+            result = write_mp_active_channels(file, &shaCtx, state);
             break;
 
         case FILETYPE_MARKETPRICES:
-           result = write_market_pricescd(file, &shaCtx);
+           result = write_market_pricescd(file, &shaCtx, state);
            break;
+
+        case FILETYPE_ORACLES:
+            result = write_mp_oracles(file, &shaCtx, state);
+            break;
+    }
+
+    // generate the double hash of all the contents written
+    uint256 hash1;
+    SHA256_Final((unsigned char*) &hash1, &shaCtx);
+    SHA256((unsigned char*) &hash1, sizeof (hash1), (unsigned char*) &hash);
+
+    content = file.str();
+    return result;
+}
+
+/**
+ * Returns the double hash of the lines in sorted order, used for delta files,
+ * because the order of the lines is lost, when deltas are applied.
+ */
+static uint256 hash_sorted_lines(const std::multiset<std::string>& lines)
+{
+    SHA256_CTX shaCtx;
+    SHA256_Init(&shaCtx);
+    for (std::multiset<std::string>::const_iterator it = lines.begin(); it != lines.end(); ++it) {
+        SHA256_Update(&shaCtx, it->c_str(), it->length());
     }
 
-    // generate and wite the double hash of all the contents written
     uint256 hash1;
     SHA256_Final((unsigned char*) &hash1, &shaCtx);
     uint256 hash2;
     SHA256((unsigned char*) &hash1, sizeof (hash1), (unsigned char*) &hash2);
-    file << "!" << hash2.ToString() << std::endl;
 
+    return hash2;
+}
+
+/** Splits the content of a state file into its non-empty lines. */
+static std::multiset<std::string> split_lines(const std::string& content)
+{
+    std::multiset<std::string> lines;
+    std::istringstream stream(content);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (!line.empty()) lines.insert(line);
+    }
+
+    return lines;
+}
+
+/** Writes the full state of one file type. */
+static void write_state_file(const fs::path& path, const std::string& content, const uint256& hash)
+{
+    std::ofstream file;
+    file.open(path.string().c_str());
+    file << content;
+    file << "!" << hash.ToString() << std::endl;
     file.flush();
     file.close();
-    return result;
 }
 
-static void prune_state_files(const CBlockIndex* topIndex)
+/**
+ * Writes the changes of one file type since the state of the previous block.
+ *
+ * Removed lines are prefixed with "-", and added lines with "+".
+ */
+static void write_delta_file(const fs::path& path, const uint256& prevBlockHash,
+        const std::multiset<std::string>& prevLines, const std::multiset<std::string>& lines)
+{
+    std::vector<std::string> removed;
+    std::vector<std::string> added;
+    std::set_difference(prevLines.begin(), prevLines.end(), lines.begin(), lines.end(), std::back_inserter(removed));
+    std::set_difference(lines.begin(), lines.end(), prevLines.begin(), prevLines.end(), std::back_inserter(added));
+
+    std::ofstream file;
+    file.open(path.string().c_str());
+    file << DELTA_HEADER << prevBlockHash.ToString() << std::endl;
+    for (std::vector<std::string>::const_iterator it = removed.begin(); it != removed.end(); ++it) {
+        file << "-" << *it << std::endl;
+    }
+    for (std::vector<std::string>::const_iterator it = added.begin(); it != added.end(); ++it) {
+        file << "+" << *it << std::endl;
+    }
+    file << "!" << hash_sorted_lines(lines).ToString() << std::endl;
+    file.flush();
+    file.close();
+}
+
+/**
+ * Returns the block, a delta file is based on, or null, if it is a full state file.
+ */
+static uint256 read_delta_base(const fs::path& path)
+{
+    uint256 prevBlockHash;
+
+    std::ifstream file;
+    file.open(path.string().c_str());
+    std::string line;
+    if (file.is_open() && std::getline(file, line) && boost::starts_with(line, DELTA_HEADER)) {
+        prevBlockHash.SetHex(line.substr(DELTA_HEADER.size()));
+    }
+
+    return prevBlockHash;
+}
+
+/**
+ * Removes the state files of a block.
+ */
+static void remove_state_files(const fs::path& directory, const uint256& blockHash)
+{
+    std::string strBlockHash = blockHash.ToString();
+    for (int i = 0; i < NUM_FILETYPES; ++i) {
+        fs::path path = directory / strprintf("%s-%s.dat", statePrefix[i], strBlockHash);
+        fs::remove(path);
+    }
+}
+
+/** A block with state files, and the block its delta files are based on, if any. */
+struct PersistedBlock
+{
+    int height;
+    uint256 prevBlockHash;
+};
+
+/**
+ * Removes the state files, which are no longer needed.
+ *
+ * The heights of the blocks with state files are tracked by the writer, so
+ * the block index, and therefore cs_main, isn't needed. The files, which
+ * delta files of kept blocks are based on, are kept as well.
+ */
+static void prune_state_files(const fs::path& directory, int topHeight, std::map<uint256, PersistedBlock>& persistedBlocks)
+{
+    std::set<uint256> keep;
+    std::map<uint256, PersistedBlock>::const_iterator iter;
+    for (iter = persistedBlocks.begin(); iter != persistedBlocks.end(); ++iter) {
+        const int height = iter->second.height;
+        if (((topHeight - height) > MAX_STATE_HISTORY) && (height % STORE_EVERY_N_BLOCK != 0)) {
+            continue;
+        }
+
+        uint256 blockHash = iter->first;
+        while (!blockHash.IsNull() && keep.insert(blockHash).second) {
+            std::map<uint256, PersistedBlock>::const_iterator base = persistedBlocks.find(blockHash);
+            if (base == persistedBlocks.end()) break;
+            blockHash = base->second.prevBlockHash;
+        }
+    }
+
+    std::map<uint256, PersistedBlock>::iterator it = persistedBlocks.begin();
+    while (it != persistedBlocks.end()) {
+        // if this block is too old..
+        if (keep.count(it->first) == 0) {
+            if (msc_debug_persistence) {
+                PrintToLog("State from Block:%s is no longer need, removing files (age-from-tip: %d)\n", it->first.ToString(), topHeight - it->second.height);
+            }
+
+            // destroy the associated files!
+            remove_state_files(directory, it->first);
+            persistedBlocks.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * Collects the blocks, which have state files, and removes the files of
+ * unknown blocks.
+ */
+static std::map<uint256, PersistedBlock> find_state_files(const fs::path& directory)
 {
     // build a set of blockHashes for which we have any state files
     std::set<uint256> statefulBlockHashes;
 
-    fs::directory_iterator dIter(pathStateFiles);
+    fs::directory_iterator dIter(directory);
     fs::directory_iterator endIter;
     for (; dIter != endIter; ++dIter) {
         std::string fName = dIter->path().empty() ? "<invalid>" : (*--dIter->path().end()).string();
@@ -653,32 +911,167 @@ static void prune_state_files(const CBlockIndex* topIndex)
         }
     }
 
-    // for each blockHash in the set, determine the distance from the given block
+    // look up the CBlockIndex for height info
+    std::map<uint256, PersistedBlock> persistedBlocks;
     std::set<uint256>::const_iterator iter;
     for (iter = statefulBlockHashes.begin(); iter != statefulBlockHashes.end(); ++iter) {
-        // look up the CBlockIndex for height info
         CBlockIndex const *curIndex = GetBlockIndex(*iter);
 
-        // if we have nothing int the index, or this block is too old..
-        if (nullptr == curIndex || (((topIndex->nHeight - curIndex->nHeight) > MAX_STATE_HISTORY)
-                && (curIndex->nHeight % STORE_EVERY_N_BLOCK != 0))) {
+        // if we have nothing int the index..
+        if (nullptr == curIndex) {
             if (msc_debug_persistence) {
-                if (curIndex) {
-                    PrintToLog("State from Block:%s is no longer need, removing files (age-from-tip: %d)\n", (*iter).ToString(), topIndex->nHeight - curIndex->nHeight);
-                } else {
-                    PrintToLog("State from Block:%s is no longer need, removing files (not in index)\n", (*iter).ToString());
+                PrintToLog("State from Block:%s is no longer need, removing files (not in index)\n", (*iter).ToString());
+            }
+            remove_state_files(directory, *iter);
+            continue;
+        }
+
+        PersistedBlock& block = persistedBlocks[*iter];
+        block.height = curIndex->nHeight;
+        block.prevBlockHash = read_delta_base(directory / strprintf("%s-%s.dat", statePrefix[FILETYPE_BALANCES], iter->ToString()));
+    }
+
+    return persistedBlocks;
+}
+
+/**
+ * Writes snapshots of the state on a background thread, so the block
+ * processing doesn't wait for formatting, hashing and writing the state
+ * files.
+ */
+class CStateWriter
+{
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::shared_ptr<StateSnapshot> > queue;
+    std::thread thread;
+    bool fBusy;
+    bool fStop;
+
+    //! Blocks with state files, only accessed by the writer thread once started
+    std::map<uint256, PersistedBlock> persistedBlocks;
+
+    //! The block, which was written last, and its lines per file type, used to create deltas
+    uint256 lastBlockHash;
+    std::multiset<std::string> lastLines[NUM_FILETYPES];
+
+    void Run()
+    {
+        RenameThread("tradelayer-persist");
+
+        while (true) {
+            std::shared_ptr<StateSnapshot> state;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this] { return fStop || !queue.empty(); });
+                if (queue.empty()) {
+                    break;
                 }
+                state = queue.front();
+                queue.pop_front();
+                fBusy = true;
             }
+            cond.notify_all();
 
-            // destroy the associated files!
-            std::string strBlockHash = iter->ToString();
-            for (int i = 0; i < NUM_FILETYPES; ++i) {
-                fs::path path = pathStateFiles / strprintf("%s-%s.dat", statePrefix[i], strBlockHash);
-                fs::remove(path);
+            Write(*state);
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                fBusy = false;
             }
+            cond.notify_all();
         }
     }
-}
+
+    /**
+     * Writes the state files of a block.
+     *
+     * Full state files are written every baseInterval blocks, for blocks kept
+     * in the long term, and whenever the previous block wasn't written. For
+     * the other blocks only the changed lines are written.
+     */
+    void Write(StateSnapshot& state)
+    {
+        const bool fDeltas = state.baseInterval > 1;
+        const bool fBase = !fDeltas
+                || state.blockHeight % state.baseInterval == 0
+                || state.blockHeight % STORE_EVERY_N_BLOCK == 0
+                || state.prevBlockHash != lastBlockHash
+                || persistedBlocks.count(lastBlockHash) == 0;
+
+        for (const int what : persistedFileTypes) {
+            fs::path path = state.directory / strprintf("%s-%s.dat", statePrefix[what], state.blockHash.ToString());
+            std::string content;
+            uint256 hash;
+            format_state(state, what, content, hash);
+
+            if (fBase) {
+                write_state_file(path, content, hash);
+            }
+            if (fDeltas) {
+                std::multiset<std::string> lines = split_lines(content);
+                if (!fBase) {
+                    write_delta_file(path, lastBlockHash, lastLines[what], lines);
+                }
+                lastLines[what].swap(lines);
+            }
+        }
+
+        lastBlockHash = state.blockHash;
+        PersistedBlock& block = persistedBlocks[state.blockHash];
+        block.height = state.blockHeight;
+        block.prevBlockHash = fBase ? uint256() : state.prevBlockHash;
+
+        // clean-up the directory
+        prune_state_files(state.directory, state.blockHeight, persistedBlocks);
+    }
+
+public:
+    CStateWriter() : fBusy(false), fStop(false) {}
+
+    ~CStateWriter()
+    {
+        Stop();
+    }
+
+    /** Hands a snapshot to the writer, and starts the writer, if it isn't running. */
+    void Push(const std::shared_ptr<StateSnapshot>& state)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!thread.joinable()) {
+            persistedBlocks = find_state_files(state->directory);
+            fStop = false;
+            thread = std::thread(&CStateWriter::Run, this);
+        }
+        cond.wait(lock, [this] { return queue.size() < MAX_PENDING_SNAPSHOTS; });
+        queue.push_back(state);
+        lock.unlock();
+        cond.notify_all();
+    }
+
+    /** Waits until all snapshots are written. */
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return queue.empty() && !fBusy; });
+    }
+
+    /** Writes the remaining snapshots and stops the writer. */
+    void Stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            fStop = true;
+        }
+        cond.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+};
+
+static CStateWriter stateWriter;
 
 /**
  * Indicates whether persistence is enabled and the state is stored.
@@ -695,25 +1088,205 @@ bool IsPersistenceEnabled(int blockHeight) {
 
 /**
  * Stores the in-memory state in files.
+ *
+ * Only the copy of the state is made here, the files are written by the
+ * background writer.
  */
 int PersistInMemoryState(const CBlockIndex* pBlockIndex)
 {
-    // write the new state as of the given block
-    write_state_file(pBlockIndex, FILETYPE_BALANCES);
-    write_state_file(pBlockIndex, FILETYPE_OFFERS);
-    write_state_file(pBlockIndex, FILETYPE_ACCEPTS);
-    write_state_file(pBlockIndex, FILETYPE_GLOBALS);
-    write_state_file(pBlockIndex, FILETYPE_MDEXORDERS);
-    write_state_file(pBlockIndex, FILETYPE_CDEXORDERS);
-    write_state_file(pBlockIndex, FILETYPE_CACHEFEES);
-    write_state_file(pBlockIndex, FILETYPE_WITHDRAWALS);
-    write_state_file(pBlockIndex, FILETYPE_ACTIVE_CHANNELS);
+    CPerfTimer perfTimer(PERF_PERSIST_STATE);
+
+    const int64_t nIntervalArg = gArgs.GetArg("-tlstatebaseinterval", 0);
+    const int nBaseInterval = (int) std::max<int64_t>(0, std::min<int64_t>(nIntervalArg, MAX_STATE_BASE_INTERVAL));
+
+    // capture the new state as of the given block
+    std::shared_ptr<StateSnapshot> state = std::make_shared<StateSnapshot>();
+    state->directory = pathStateFiles;
+    state->blockHash = pBlockIndex->GetBlockHash();
+    state->prevBlockHash = pBlockIndex->pprev ? pBlockIndex->pprev->GetBlockHash() : uint256();
+    state->blockHeight = pBlockIndex->nHeight;
+    state->baseInterval = nBaseInterval;
+    state->tally = mp_tally_map;
+    state->offers = my_offers;
+    state->accepts = my_accepts;
+    state->nextSPID = pDbSpInfo->peekNextSPID(TL_PROPERTY_MSC);
+    state->nextTestSPID = pDbSpInfo->peekNextSPID(TL_PROPERTY_TMSC);
+    state->metadex = metadex;
+    state->contractdex = contractdex;
+    state->cachefees = cachefees;
+    state->withdrawals = withdrawal_Map;
+    state->channels = channels_Map;
+    std::copy(marketP, marketP + NPTYPES, state->marketPrices);
+    state->oracles = GetAllOracleSeries();
+
+    stateWriter.Push(state);
 
+    pDbSpInfo->setWatermark(pBlockIndex->GetBlockHash());
 
-    // clean-up the directory
-    prune_state_files(pBlockIndex);
+    return 0;
+}
 
-    pDbSpInfo->setWatermark(pBlockIndex->GetBlockHash());
+/**
+ * Waits until the background writer has written all state files.
+ */
+void FlushStatePersistence()
+{
+    stateWriter.Flush();
+}
+
+/**
+ * Writes the outstanding state files and stops the background writer.
+ */
+void StopStatePersistence()
+{
+    stateWriter.Stop();
+}
+
+/**
+ * Reads the lines of a single state file, without resolving deltas.
+ *
+ * @param prevBlockHash[out]  The block a delta file is based on, or null, if it is a full state file
+ * @param fileHash[out]       The hash stored in the file
+ * @param hash[out]           The hash of the lines of a full state file
+ * @return 0 on success, or -1, if the file couldn't be read
+ */
+static int read_state_file(const fs::path& path, bool verifyHash, std::vector<std::string>& vLines,
+        uint256& prevBlockHash, std::string& fileHash, uint256& hash)
+{
+    const std::string filename = path.string();
+
+    std::ifstream file;
+    file.open(filename.c_str());
+    if (!file.is_open()) {
+        if (msc_debug_persistence) LogPrintf("%s(%s): file not found, line %d, file: %s\n", __FUNCTION__, filename, __LINE__, __FILE__);
+        return -1;
+    }
+
+    SHA256_CTX shaCtx;
+    SHA256_Init(&shaCtx);
+
+    bool fDelta = false;
+    prevBlockHash.SetNull();
+    vLines.clear();
+    while (file.good()) {
+        std::string line;
+        std::getline(file, line);
+        if (line.empty()) continue;
+
+        if (vLines.empty() && !fDelta && boost::starts_with(line, DELTA_HEADER)) {
+            fDelta = true;
+            prevBlockHash.SetHex(line.substr(DELTA_HEADER.size()));
+            continue;
+        }
+        if (line[0] == '#') continue;
+
+        // remove \r if the file came from Windows
+        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+
+        // record and skip hashes in the file
+        if (line[0] == '!') {
+            fileHash = line.substr(1);
+            continue;
+        }
+
+        // update hash?
+        if (verifyHash && !fDelta) {
+            SHA256_Update(&shaCtx, line.c_str(), line.length());
+        }
+
+        vLines.push_back(line);
+    }
+
+    file.close();
+
+    if (!fDelta) {
+        // generate the double hash of all the contents written
+        uint256 hash1;
+        SHA256_Final((unsigned char*) &hash1, &shaCtx);
+        SHA256((unsigned char*) &hash1, sizeof (hash1), (unsigned char*) &hash);
+    }
+
+    return 0;
+}
+
+/**
+ * Reads the lines of a state file.
+ *
+ * Delta files are resolved by following the chain of files they are based on
+ * down to the full state file, and by applying the removed and added lines of
+ * each delta file on top of it, starting with the oldest one. The lines of a
+ * resolved delta file are returned in sorted order.
+ *
+ * @return 0 on success, or -1, if the file or a file it is based on couldn't be read or validated
+ */
+static int read_state_lines(const fs::path& path, bool verifyHash, std::vector<std::string>& vLines)
+{
+    // collect the delta files, the newest first, and find the full state file
+    std::vector<fs::path> vDeltaPaths;
+    fs::path basePath = path;
+    uint256 prevBlockHash = read_delta_base(basePath);
+    while (!prevBlockHash.IsNull()) {
+        if (vDeltaPaths.size() >= (size_t) MAX_DELTA_CHAIN) {
+            PrintToLog("File %s is based on too many delta files!\n", path.string());
+            return -1;
+        }
+        vDeltaPaths.push_back(basePath);
+
+        // the file of the same type of the previous block
+        const std::string strName = basePath.filename().string();
+        basePath = basePath.parent_path() / strprintf("%s-%s.dat", strName.substr(0, strName.find('-')), prevBlockHash.ToString());
+        prevBlockHash = read_delta_base(basePath);
+    }
+
+    std::vector<std::string> vFileLines;
+    std::string fileHash;
+    uint256 hash;
+    if (read_state_file(basePath, verifyHash, vFileLines, prevBlockHash, fileHash, hash) < 0 || !prevBlockHash.IsNull()) {
+        if (!vDeltaPaths.empty()) PrintToLog("File %s loaded, but the state it is based on couldn't be loaded!\n", path.string());
+        return -1;
+    }
+    if (verifyHash && false == boost::iequals(hash.ToString(), fileHash)) {
+        PrintToLog("File %s loaded, but failed hash validation!\n", basePath.string());
+        return -1;
+    }
+    if (vDeltaPaths.empty()) {
+        vLines.swap(vFileLines);
+        return 0;
+    }
+
+    std::multiset<std::string> state(vFileLines.begin(), vFileLines.end());
+    for (std::vector<fs::path>::const_reverse_iterator itPath = vDeltaPaths.rbegin(); itPath != vDeltaPaths.rend(); ++itPath) {
+        const std::string filename = itPath->string();
+        fileHash.clear();
+        if (read_state_file(*itPath, verifyHash, vFileLines, prevBlockHash, fileHash, hash) < 0 || prevBlockHash.IsNull()) {
+            PrintToLog("File %s couldn't be loaded as delta file!\n", filename);
+            return -1;
+        }
+
+        for (std::vector<std::string>::const_iterator it = vFileLines.begin(); it != vFileLines.end(); ++it) {
+            const std::string& line = *it;
+            if (line[0] == '+') {
+                state.insert(line.substr(1));
+            } else if (line[0] == '-') {
+                std::multiset<std::string>::iterator pos = state.find(line.substr(1));
+                if (pos == state.end()) {
+                    PrintToLog("File %s loaded, but removes a line, which doesn't exist!\n", filename);
+                    return -1;
+                }
+                state.erase(pos);
+            } else {
+                PrintToLog("File %s loaded, but contains an invalid delta line!\n", filename);
+                return -1;
+            }
+        }
+
+        if (verifyHash && false == boost::iequals(hash_sorted_lines(state).ToString(), fileHash)) {
+            PrintToLog("File %s loaded, but failed hash validation!\n", filename);
+            return -1;
+        }
+    }
+
+    vLines.assign(state.begin(), state.end());
 
     return 0;
 }
@@ -726,12 +1299,11 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
     int lines = 0;
     int (*inputLineFunc)(const std::string&) = nullptr;
 
-    SHA256_CTX shaCtx;
-    SHA256_Init(&shaCtx);
-
     switch (what) {
         case FILETYPE_BALANCES:
             mp_tally_map.clear();
+            mapPropertyHolders.clear();
+            WalletCacheInvalidate();
             inputLineFunc = input_msc_balances_string;
             break;
 
@@ -741,7 +1313,8 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
             break;
 
         case FILETYPE_ACCEPTS:
-            my_accepts.clear();
+            DEx_acceptsClear();
+            ClearBlockEvents(BLOCK_EVENT_ACCEPT_EXPIRY);
             inputLineFunc = input_mp_accepts_string;
             break;
 
@@ -779,6 +1352,11 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
             inputLineFunc = input_activechannels_string;
             break;
 
+        case FILETYPE_ORACLES:
+            ClearOracleSamples();
+            inputLineFunc = input_oracles_string;
+            break;
+
         default:
             return -1;
     }
@@ -788,57 +1366,19 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
         PrintToLog("%s(%s), line %d, file: %s\n", __FUNCTION__, filename, __LINE__, __FILE__);
     }
 
-    std::ifstream file;
-    file.open(filename.c_str());
-    if (!file.is_open()) {
-        if (msc_debug_persistence) LogPrintf("%s(%s): file not found, line %d, file: %s\n", __FUNCTION__, filename, __LINE__, __FILE__);
+    std::vector<std::string> vLines;
+    int res = read_state_lines(fs::path(filename), verifyHash, vLines);
+    if (res < 0) {
         return -1;
     }
 
-    int res = 0;
-
-    std::string fileHash;
-    while (file.good()) {
-        std::string line;
-        std::getline(file, line);
-        if (line.empty() || line[0] == '#') continue;
-
-        // remove \r if the file came from Windows
-        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
-
-        // record and skip hashes in the file
-        if (line[0] == '!') {
-            fileHash = line.substr(1);
-            continue;
-        }
-
-        // update hash?
-        if (verifyHash) {
-            SHA256_Update(&shaCtx, line.c_str(), line.length());
-        }
-
-        if (inputLineFunc) {
-            if (inputLineFunc(line) < 0) {
+    if (inputLineFunc) {
+        for (std::vector<std::string>::const_iterator it = vLines.begin(); it != vLines.end(); ++it) {
+            if (inputLineFunc(*it) < 0) {
                 res = -1;
                 break;
             }
-        }
-
-        ++lines;
-    }
-
-    file.close();
-
-    if (verifyHash && res == 0) {
-        // generate and wite the double hash of all the contents written
-        uint256 hash1;
-        SHA256_Final((unsigned char*) &hash1, &shaCtx);
-        uint256 hash2;
-        SHA256((unsigned char*) &hash1, sizeof (hash1), (unsigned char*) &hash2);
-
-        if (false == boost::iequals(hash2.ToString(), fileHash)) {
-            PrintToLog("File %s loaded, but failed hash validation!\n", filename);
-            res = -1;
+            ++lines;
         }
     }
 
@@ -854,6 +1394,10 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
 int LoadMostRelevantInMemoryState()
 {
     PrintToLog("Trying to load most relevant state into memory..\n");
+
+    // the state files of the latest blocks may still be in the making
+    FlushStatePersistence();
+
     int res = -1;
     // check the SP database and roll it back to its latest valid state
     // according to the active chain
@@ -8,9 +8,15 @@ class CBlockIndex;
 /** Indicates whether persistence is enabled and the state is stored. */
 bool IsPersistenceEnabled(int blockHeight);
 
-/** Stores the in-memory state in files. */
+/** Stores the in-memory state in files; the files are written in the background. */
 int PersistInMemoryState(const CBlockIndex* pBlockIndex);
 
+/** Waits until all state files are written. */
+void FlushStatePersistence();
+
+/** Writes the outstanding state files and stops the background writer. */
+void StopStatePersistence();
+
 /** Loads and retrieves state from a file. */
 int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash = false);
 
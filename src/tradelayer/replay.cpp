@@ -0,0 +1,156 @@
+/**
+ * @file replay.cpp
+ *
+ * This file contains the recording and offline replay of blocks through the
+ * Trade Layer block handlers.
+ */
+
+#include <tradelayer/replay.h>
+
+#include <tradelayer/dbtxlist.h>
+#include <tradelayer/tradelayer.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <streams.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <undo.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <stdint.h>
+#include <exception>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mastercore
+{
+CBlockReplayer::~CBlockReplayer()
+{
+    LOCK(cs_main);
+    chainActive.SetTip(nullptr);
+
+    for (std::deque<CBlockIndex>::iterator it = vIndex.begin(); it != vIndex.end(); ++it) {
+        BlockMap::iterator bit = mapBlockIndex.find(it->GetBlockHash());
+        if (bit != mapBlockIndex.end() && bit->second == &(*it)) {
+            mapBlockIndex.erase(bit);
+        }
+    }
+}
+
+void CBlockReplayer::ReplayBlock(const CReplayBlock& block)
+{
+    // stands in for all transactions, which were not recorded
+    static const CTransaction emptyTx;
+
+    CBlockIndex* pprev = nullptr;
+    if (!vIndex.empty() && vIndex.back().nHeight + 1 == block.nHeight) {
+        pprev = &vIndex.back();
+    }
+
+    vIndex.emplace_back();
+    CBlockIndex& index = vIndex.back();
+    index.nHeight = block.nHeight;
+    index.nTime = block.nTime;
+    index.pprev = pprev;
+    {
+        LOCK(cs_main);
+        index.phashBlock = &(mapBlockIndex.emplace(block.hash, &index).first->first);
+        chainActive.SetTip(&index);
+    }
+
+    // a copy, because the handlers get the spent coins of the whole block
+    std::shared_ptr<std::map<COutPoint, Coin> > removedCoins = std::make_shared<std::map<COutPoint, Coin> >(block.spentCoins);
+
+    int64_t nStart = GetTimeMicros();
+    unsigned int nNumMetaTxs = 0;
+
+    mastercore_handler_block_begin(block.nHeight, &index);
+
+    std::vector<std::pair<uint32_t, CTransactionRef> >::const_iterator it = block.vtx.begin();
+    for (uint32_t nTxIdx = 0; nTxIdx < block.nTxCount; ++nTxIdx) {
+        const CTransaction* tx = &emptyTx;
+        if (it != block.vtx.end() && it->first == nTxIdx) {
+            tx = it->second.get();
+            ++stats.nTransactions;
+            ++it;
+        }
+        if (mastercore_handler_tx(*tx, block.nHeight, nTxIdx, &index, removedCoins)) ++nNumMetaTxs;
+    }
+
+    mastercore_handler_block_end(block.nHeight, &index, nNumMetaTxs);
+
+    stats.nHandlerMicros += GetTimeMicros() - nStart;
+    stats.nMetaTransactions += nNumMetaTxs;
+    ++stats.nBlocks;
+}
+
+bool CBlockReplayer::ReplayFile(CAutoFile& file, const CReplayHeader& header, std::string& strError)
+{
+    int64_t nStart = GetTimeMicros();
+
+    for (int nBlock = header.nStartBlock; nBlock <= header.nEndBlock; ++nBlock) {
+        CReplayBlock block;
+        try {
+            file >> block;
+        } catch (const std::exception& e) {
+            strError = strprintf("failed to read block %d: %s", nBlock, e.what());
+            return false;
+        }
+        if (block.nHeight != nBlock) {
+            strError = strprintf("expected block %d, but found block %d", nBlock, block.nHeight);
+            return false;
+        }
+        ReplayBlock(block);
+    }
+
+    stats.nTotalMicros += GetTimeMicros() - nStart;
+
+    return true;
+}
+
+bool CaptureReplayBlock(const CBlockIndex* pBlockIndex, bool fAllTransactions, CReplayBlock& block, std::string& strError)
+{
+    CBlock blockData;
+    CBlockUndo blockUndo;
+    {
+        LOCK(cs_main);
+        if (!ReadBlockFromDisk(blockData, pBlockIndex, Params().GetConsensus())) {
+            strError = strprintf("failed to read block %d from disk", pBlockIndex->nHeight);
+            return false;
+        }
+        // the genesis block has no undo data, but also doesn't spend anything
+        if (pBlockIndex->pprev && !UndoReadFromDisk(blockUndo, pBlockIndex)) {
+            strError = strprintf("failed to read undo data of block %d from disk", pBlockIndex->nHeight);
+            return false;
+        }
+    }
+
+    block.nHeight = pBlockIndex->nHeight;
+    block.hash = pBlockIndex->GetBlockHash();
+    block.nTime = pBlockIndex->GetBlockTime();
+    block.nTxCount = blockData.vtx.size();
+
+    for (size_t i = 0; i < blockData.vtx.size(); ++i) {
+        const CTransactionRef& tx = blockData.vtx[i];
+        if (!fAllTransactions && !pDbTransactionList->exists(tx->GetHash())) continue;
+
+        block.vtx.push_back(std::make_pair(static_cast<uint32_t>(i), tx));
+        if (tx->IsCoinBase()) continue;
+
+        // the undo data has no entry for the coinbase transaction
+        const CTxUndo& txUndo = blockUndo.vtxundo.at(i - 1);
+        for (size_t n = 0; n < tx->vin.size(); ++n) {
+            block.spentCoins.emplace(tx->vin[n].prevout, txUndo.vprevout.at(n));
+        }
+    }
+
+    return true;
+}
+}
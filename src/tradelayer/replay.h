@@ -0,0 +1,128 @@
+#ifndef BITCOIN_TRADELAYER_REPLAY_H
+#define BITCOIN_TRADELAYER_REPLAY_H
+
+#include <chain.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CAutoFile;
+
+namespace mastercore
+{
+/** Version of the replay file format. */
+static const uint32_t REPLAY_FILE_VERSION = 1;
+
+/** Describes a recorded range of blocks; written once at the beginning of a replay file. */
+struct CReplayHeader
+{
+    uint32_t nVersion;
+    std::string strNetwork;
+    int32_t nStartBlock;
+    int32_t nEndBlock;
+    //! Consensus hash after the last block, or null, if unknown
+    uint256 consensusHash;
+
+    CReplayHeader() : nVersion(REPLAY_FILE_VERSION), nStartBlock(0), nEndBlock(-1) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nVersion);
+        READWRITE(strNetwork);
+        READWRITE(nStartBlock);
+        READWRITE(nEndBlock);
+        READWRITE(consensusHash);
+    }
+
+    /** Returns the number of blocks, which follow the header. */
+    int GetBlockCount() const { return nEndBlock - nStartBlock + 1; }
+};
+
+/**
+ * A block, as seen by the Trade Layer block handlers.
+ *
+ * Only transactions, which were processed by the Trade Layer, are kept along
+ * with their position in the block. All other positions are filled with empty
+ * transactions on replay, so the handlers are called as often as for the
+ * original block.
+ */
+struct CReplayBlock
+{
+    int32_t nHeight;
+    uint256 hash;
+    int64_t nTime;
+    uint32_t nTxCount;
+    std::vector<std::pair<uint32_t, CTransactionRef> > vtx;
+    //! The outputs spent by the transactions, as provided by the UTXO set when the block was connected
+    std::map<COutPoint, Coin> spentCoins;
+
+    CReplayBlock() : nHeight(0), nTime(0), nTxCount(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nHeight);
+        READWRITE(hash);
+        READWRITE(nTime);
+        READWRITE(nTxCount);
+        READWRITE(vtx);
+        READWRITE(spentCoins);
+    }
+};
+
+/** Throughput figures of a replay. */
+struct CReplayStats
+{
+    int nBlocks;
+    int nTransactions;
+    int nMetaTransactions;
+    //! Time spent in the block handlers
+    int64_t nHandlerMicros;
+    //! Time spent in total, including reading the file
+    int64_t nTotalMicros;
+
+    CReplayStats() : nBlocks(0), nTransactions(0), nMetaTransactions(0), nHandlerMicros(0), nTotalMicros(0) {}
+};
+
+/**
+ * Feeds recorded blocks through mastercore_handler_block_begin(), _tx() and
+ * _block_end(), without a block chain.
+ *
+ * For every block a fake block index is linked to the previous one and set
+ * as tip of chainActive, so the handlers see the same height as on a node
+ * connecting the block. The indexes are removed again on destruction.
+ */
+class CBlockReplayer
+{
+private:
+    std::deque<CBlockIndex> vIndex;
+    CReplayStats stats;
+
+public:
+    ~CBlockReplayer();
+
+    /** Replays a single block. */
+    void ReplayBlock(const CReplayBlock& block);
+
+    /** Replays all blocks of a file, whose header was already read. */
+    bool ReplayFile(CAutoFile& file, const CReplayHeader& header, std::string& strError);
+
+    const CReplayStats& GetStats() const { return stats; }
+};
+
+/** Builds the replay record of a connected block from the block and undo files. */
+bool CaptureReplayBlock(const CBlockIndex* pBlockIndex, bool fAllTransactions, CReplayBlock& block, std::string& strError);
+}
+
+#endif // BITCOIN_TRADELAYER_REPLAY_H
@@ -19,8 +19,11 @@
 #include <tradelayer/log.h>
 #include <tradelayer/mdex.h>
 #include <tradelayer/notifications.h>
+#include <tradelayer/oracleprices.h>
 #include <tradelayer/tradelayer.h>
 #include <tradelayer/parsing.h>
+#include <tradelayer/perfstats.h>
+#include <tradelayer/replay.h>
 #include <tradelayer/rpcrequirements.h>
 #include <tradelayer/rpctxobject.h>
 #include <tradelayer/rpcvalues.h>
@@ -37,6 +40,8 @@
 #include <amount.h>
 #include <base58.h>
 #include <chainparams.h>
+#include <clientversion.h>
+#include <fs.h>
 #include <init.h>
 #include <index/txindex.h>
 #include <interfaces/wallet.h>
@@ -46,6 +51,7 @@
 #include <primitives/transaction.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <txmempool.h>
 #include <uint256.h>
@@ -411,7 +417,7 @@ static UniValue tl_getfeeshare(const JSONRPCRequest& request)
         receiversSet = STO_GetReceivers("FEEDISTRIBUTION", TL_PROPERTY_TMSC, COIN);
     }
 
-    for (OwnerAddrType::reverse_iterator it = receiversSet.rbegin(); it != receiversSet.rend(); ++it) {
+    for (OwnerAddrType::const_iterator it = receiversSet.begin(); it != receiversSet.end(); ++it) {
         addObj = false;
         if (address.empty()) {
             if (IsMyAddress(it->second, pWallet.get())) {
@@ -1663,8 +1669,7 @@ static UniValue tl_getactivedexsells(const JSONRPCRequest& request)
 
     for (OfferMap::iterator it = my_offers.begin(); it != my_offers.end(); ++it) {
         const CMPOffer& selloffer = it->second;
-        const std::string& sellCombo = it->first;
-        std::string seller = sellCombo.substr(0, sellCombo.size() - 2);
+        const std::string& seller = it->first.first;
 
         // filtering
         if (!addressFilter.empty() && seller != addressFilter) continue;
@@ -1703,15 +1708,15 @@ static UniValue tl_getactivedexsells(const JSONRPCRequest& request)
         // display info about accepts related to sell
         responseObj.pushKV("amountaccepted", FormatDivisibleMP(amountAccepted));
         UniValue acceptsMatched(UniValue::VARR);
-        for (AcceptMap::const_iterator ait = my_accepts.begin(); ait != my_accepts.end(); ++ait) {
+        // the accepts of the offer are adjacent
+        for (AcceptMap::const_iterator ait = my_accepts.lower_bound(DExAcceptKey(seller, propertyId, ""));
+                ait != my_accepts.end() && ait->first.seller == seller && ait->first.propertyId == propertyId; ++ait) {
             UniValue matchedAccept(UniValue::VOBJ);
             const CMPAccept& accept = ait->second;
-            const std::string& acceptCombo = ait->first;
 
             // does this accept match the sell?
             if (accept.getHash() == selloffer.getHash()) {
-                // split acceptCombo out to get the buyer address
-                std::string buyer = acceptCombo.substr((acceptCombo.find("+") + 1), (acceptCombo.size()-(acceptCombo.find("+") + 1)));
+                const std::string& buyer = ait->first.buyer;
                 int blockOfAccept = accept.getAcceptBlock();
                 int blocksLeftToPay = (blockOfAccept + selloffer.getBlockTimeLimit()) - curBlock;
                 int64_t amountAccepted = accept.getAcceptAmountRemaining();
@@ -2430,6 +2435,297 @@ static UniValue tl_getbalanceshash(const JSONRPCRequest& request)
     return response;
 }
 
+static UniValue tl_getperfstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw runtime_error(
+            RPCHelpMan{"tl_getperfstats",
+               "\nReturns latency histograms for the phases of block and transaction processing.\n",
+               {
+                   {"reset", RPCArg::Type::BOOL, /* default */ "false", "clear all samples after reporting them\n"},
+               },
+               RPCResult{
+                   "[                                (array of JSON objects)\n"
+                   "  {\n"
+                   "    \"stage\" : \"name\",             (string) the name of the timed phase\n"
+                   "    \"count\" : n,                  (number) the number of samples\n"
+                   "    \"total_us\" : n,               (number) the total time spent in microseconds\n"
+                   "    \"avg_us\" : n,                 (number) the average time in microseconds\n"
+                   "    \"max_us\" : n,                 (number) the longest time in microseconds\n"
+                   "    \"p50_us\" : n,                 (number) the median, as upper bound of its bucket\n"
+                   "    \"p90_us\" : n,                 (number) the 90th percentile, as upper bound of its bucket\n"
+                   "    \"p99_us\" : n,                 (number) the 99th percentile, as upper bound of its bucket\n"
+                   "    \"histogram\" : [               (array of JSON objects) the non-empty buckets\n"
+                   "      {\n"
+                   "        \"upper_us\" : n,           (number) the exclusive upper bound of the bucket, or the maximum for the last bucket\n"
+                   "        \"count\" : n               (number) the number of samples in the bucket\n"
+                   "      },\n"
+                   "      ...\n"
+                   "    ]\n"
+                   "  },\n"
+                   "  ...\n"
+                   "]\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("tl_getperfstats", "")
+                   + HelpExampleCli("tl_getperfstats", "true")
+                   + HelpExampleRpc("tl_getperfstats", "")
+               }
+            }.ToString());
+
+    bool fReset = false;
+    if (request.params.size() > 0) {
+        fReset = request.params[0].get_bool();
+    }
+
+    std::vector<PerfStageStats> vStats = GetPerfStats();
+    if (fReset) {
+        ResetPerfStats();
+    }
+
+    UniValue response(UniValue::VARR);
+    for (std::vector<PerfStageStats>::const_iterator it = vStats.begin(); it != vStats.end(); ++it) {
+        const PerfStageStats& stats = *it;
+        UniValue histogram(UniValue::VARR);
+        for (size_t i = 0; i < stats.buckets.size(); ++i) {
+            if (stats.buckets[i] == 0) continue;
+            UniValue bucket(UniValue::VOBJ);
+            uint64_t upperBound = (i + 1 == stats.buckets.size()) ? stats.maxMicros : CPerfHistogram::BucketUpperBound(i);
+            bucket.pushKV("upper_us", upperBound);
+            bucket.pushKV("count", stats.buckets[i]);
+            histogram.push_back(bucket);
+        }
+
+        UniValue stageObj(UniValue::VOBJ);
+        stageObj.pushKV("stage", stats.name);
+        stageObj.pushKV("count", stats.count);
+        stageObj.pushKV("total_us", stats.totalMicros);
+        stageObj.pushKV("avg_us", stats.count ? stats.totalMicros / stats.count : 0);
+        stageObj.pushKV("max_us", stats.maxMicros);
+        stageObj.pushKV("p50_us", stats.Percentile(50));
+        stageObj.pushKV("p90_us", stats.Percentile(90));
+        stageObj.pushKV("p99_us", stats.Percentile(99));
+        stageObj.pushKV("histogram", histogram);
+        response.push_back(stageObj);
+    }
+
+    return response;
+}
+
+static UniValue tl_getinputcachestats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            RPCHelpMan{"tl_getinputcachestats",
+               "\nReturns usage statistics of the cache of transaction inputs, which are used to determine the senders of transactions.\n",
+               {},
+               RPCResult{
+                   "{\n"
+                   "  \"size\" : n,                     (number) the number of cached inputs\n"
+                   "  \"limit\" : n,                    (number) the maximum number of cached inputs\n"
+                   "  \"hits\" : n,                     (number) the number of inputs found in the cache\n"
+                   "  \"misses\" : n,                   (number) the number of inputs, which had to be looked up\n"
+                   "  \"evictions\" : n                 (number) the number of inputs removed from the cache to stay within the limit\n"
+                   "}\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("tl_getinputcachestats", "")
+                   + HelpExampleRpc("tl_getinputcachestats", "")
+               }
+            }.ToString());
+
+    InputCacheStats stats = GetInputCacheStats();
+
+    UniValue response(UniValue::VOBJ);
+    response.pushKV("size", (uint64_t) stats.size);
+    response.pushKV("limit", (uint64_t) stats.limit);
+    response.pushKV("hits", stats.hits);
+    response.pushKV("misses", stats.misses);
+    response.pushKV("evictions", stats.evictions);
+
+    return response;
+}
+
+static UniValue tl_getoracleprices(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw runtime_error(
+            RPCHelpMan{"tl_getoracleprices",
+               "\nReturns the recent oracle prices of a contract, and averages derived from them.\n"
+               "\nThe averages cover the kept updates, from the first one up to the current block.\n",
+               {
+                   {"contractid", RPCArg::Type::NUM, RPCArg::Optional::NO, "the identifier of the oracle contract\n"},
+                   {"count", RPCArg::Type::NUM, /* default */ "10", "the number of recent updates to list\n"},
+               },
+               RPCResult{
+                   "{\n"
+                   "  \"contractid\" : n,              (number) the identifier of the contract\n"
+                   "  \"block\" : n,                   (number) the current block\n"
+                   "  \"updates\" : n,                 (number) the number of kept updates\n"
+                   "  \"firstblock\" : n,              (number) the block of the oldest kept update\n"
+                   "  \"lastblock\" : n,               (number) the block of the latest update\n"
+                   "  \"high\" : \"n.nnnnnnnn\",         (string) the latest high price\n"
+                   "  \"low\" : \"n.nnnnnnnn\",          (string) the latest low price\n"
+                   "  \"twaphigh\" : \"n.nnnnnnnn\",     (string) the high price, weighted by the number of blocks it was valid\n"
+                   "  \"twaplow\" : \"n.nnnnnnnn\",      (string) the low price, weighted by the number of blocks it was valid\n"
+                   "  \"maxhigh\" : \"n.nnnnnnnn\",      (string) the highest high price of the kept updates\n"
+                   "  \"minlow\" : \"n.nnnnnnnn\",       (string) the lowest low price of the kept updates\n"
+                   "  \"history\" : [                  (array of JSON objects) the recent updates, the latest first\n"
+                   "    {\n"
+                   "      \"block\" : n,               (number) the block of the update\n"
+                   "      \"high\" : \"n.nnnnnnnn\",     (string) the high price\n"
+                   "      \"low\" : \"n.nnnnnnnn\"       (string) the low price\n"
+                   "    },\n"
+                   "    ...\n"
+                   "  ]\n"
+                   "}\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("tl_getoracleprices", "5")
+                   + HelpExampleCli("tl_getoracleprices", "5 100")
+                   + HelpExampleRpc("tl_getoracleprices", "5, 100")
+               }
+            }.ToString());
+
+    uint32_t contractId = ParsePropertyId(request.params[0]);
+    int64_t count = 10;
+    if (request.params.size() > 1) {
+        count = request.params[1].get_int64();
+        if (count < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Count must not be negative");
+        }
+    }
+
+    RequireOracleContract(contractId);
+
+    int block = GetHeight();
+
+    LOCK(cs_tally);
+
+    const COracleSeries* series = GetOracleSeries(contractId);
+    OracleSummary summary;
+    if (!series || !series->GetSummary(block, summary)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "No oracle prices available for this contract");
+    }
+
+    UniValue history(UniValue::VARR);
+    std::vector<OracleSample> vSamples = series->GetLast(count);
+    for (std::vector<OracleSample>::const_iterator it = vSamples.begin(); it != vSamples.end(); ++it) {
+        UniValue sampleObj(UniValue::VOBJ);
+        sampleObj.pushKV("block", it->block);
+        sampleObj.pushKV("high", FormatDivisibleMP(it->high));
+        sampleObj.pushKV("low", FormatDivisibleMP(it->low));
+        history.push_back(sampleObj);
+    }
+
+    UniValue response(UniValue::VOBJ);
+    response.pushKV("contractid", (uint64_t)contractId);
+    response.pushKV("block", block);
+    response.pushKV("updates", (uint64_t)summary.count);
+    response.pushKV("firstblock", summary.firstBlock);
+    response.pushKV("lastblock", summary.last.block);
+    response.pushKV("high", FormatDivisibleMP(summary.last.high));
+    response.pushKV("low", FormatDivisibleMP(summary.last.low));
+    response.pushKV("twaphigh", FormatDivisibleMP(summary.twapHigh));
+    response.pushKV("twaplow", FormatDivisibleMP(summary.twapLow));
+    response.pushKV("maxhigh", FormatDivisibleMP(summary.maxHigh));
+    response.pushKV("minlow", FormatDivisibleMP(summary.minLow));
+    response.pushKV("history", history);
+
+    return response;
+}
+
+static UniValue tl_capturereplay(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 3 || request.params.size() > 4)
+        throw runtime_error(
+            RPCHelpMan{"tl_capturereplay",
+               "\nRecords a range of blocks for an offline replay with test_tradelayer_replay.\n"
+               "\nOnly the Trade Layer transactions of the blocks and the outputs they spend are stored. "
+               "The consensus hash of the current state is stored as well, if the last block is the tip, "
+               "but it can only be verified by a replay, which starts before the first Trade Layer transaction.\n",
+               {
+                   {"filename", RPCArg::Type::STR, RPCArg::Optional::NO, "the file to write, either absolute or relative to the working directory, it must not exist yet\n"},
+                   {"startblock", RPCArg::Type::NUM, RPCArg::Optional::NO, "the first block to record\n"},
+                   {"endblock", RPCArg::Type::NUM, RPCArg::Optional::NO, "the last block to record\n"},
+                   {"alltransactions", RPCArg::Type::BOOL, /* default */ "false", "record all transactions, so the parsing of unrelated ones is replayed as well\n"},
+               },
+               RPCResult{
+                   "{\n"
+                   "  \"filename\" : \"name\",         (string) the absolute path of the written file\n"
+                   "  \"startblock\" : n,            (number) the first recorded block\n"
+                   "  \"endblock\" : n,              (number) the last recorded block\n"
+                   "  \"transactions\" : n,          (number) the number of recorded transactions\n"
+                   "  \"consensushash\" : \"hash\"     (string) the consensus hash after the last block, if it was stored\n"
+                   "}\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("tl_capturereplay", "\"replay.dat\" 101 200")
+                   + HelpExampleRpc("tl_capturereplay", "\"replay.dat\", 101, 200")
+               }
+            }.ToString());
+
+    fs::path path = fs::absolute(request.params[0].get_str());
+    int startBlock = request.params[1].get_int();
+    int endBlock = request.params[2].get_int();
+    bool fAllTransactions = false;
+    if (request.params.size() > 3) {
+        fAllTransactions = request.params[3].get_bool();
+    }
+
+    CReplayHeader header;
+    header.strNetwork = Params().NetworkIDString();
+    header.nStartBlock = startBlock;
+    header.nEndBlock = endBlock;
+    {
+        LOCK2(cs_main, cs_tally);
+        if (startBlock < 0 || endBlock < startBlock || endBlock > GetHeight()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block range");
+        }
+        if (endBlock == GetHeight()) {
+            header.consensusHash = GetConsensusHash();
+        }
+    }
+
+    // prevent existing files from being overwritten
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists. If you are sure this is what you want, move it out of the way first");
+    }
+
+    CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot open replay file");
+    }
+    file << header;
+
+    int64_t transactions = 0;
+    for (int block = startBlock; block <= endBlock; ++block) {
+        const CBlockIndex* pBlockIndex = nullptr;
+        {
+            LOCK(cs_main);
+            pBlockIndex = chainActive[block];
+        }
+        CReplayBlock replayBlock;
+        std::string strError = "block not in active chain";
+        if (!pBlockIndex || !CaptureReplayBlock(pBlockIndex, fAllTransactions, replayBlock, strError)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, strError);
+        }
+        transactions += replayBlock.vtx.size();
+        file << replayBlock;
+    }
+
+    UniValue response(UniValue::VOBJ);
+    response.pushKV("filename", path.string());
+    response.pushKV("startblock", startBlock);
+    response.pushKV("endblock", endBlock);
+    response.pushKV("transactions", transactions);
+    if (!header.consensusHash.IsNull()) {
+        response.pushKV("consensushash", header.consensusHash.GetHex());
+    }
+
+    return response;
+}
+
 static const CRPCCommand commands[] =
 { //  category                             name                            actor (function)               argNames
   //  ------------------------------------ ------------------------------- ------------------------------ ----------
@@ -2460,6 +2756,10 @@ static const CRPCCommand commands[] =
     { "trade layer (data retrieval)", "tl_getfeedistribution",        &tl_getfeedistribution,         {"distributionid"} },
     { "trade layer (data retrieval)", "tl_getfeedistributions",       &tl_getfeedistributions,        {"propertyid"} },
     { "trade layer (data retrieval)", "tl_getbalanceshash",           &tl_getbalanceshash,            {"propertyid"} },
+    { "trade layer (data retrieval)", "tl_getperfstats",              &tl_getperfstats,               {"reset"} },
+    { "trade layer (data retrieval)", "tl_getinputcachestats",        &tl_getinputcachestats,         {} },
+    { "trade layer (data retrieval)", "tl_getoracleprices",           &tl_getoracleprices,            {"contractid", "count"} },
+    { "trade layer (data retrieval)", "tl_capturereplay",             &tl_capturereplay,              {"filename", "startblock", "endblock", "alltransactions"} },
 #ifdef ENABLE_WALLET
     { "trade layer (data retrieval)", "tl_listtransactions",          &tl_listtransactions,           {"address", "count", "skip", "startblock", "endblock"} },
     { "trade layer (data retrieval)", "tl_getfeeshare",               &tl_getfeeshare,                {"address", "ecosystem"} },
@@ -25,7 +25,7 @@
 extern CCriticalSection cs_main;
 
 using mastercore::cs_tx_cache;
-using mastercore::view;
+using mastercore::CTempInputView;
 
 
 static UniValue tl_decodetransaction(const JSONRPCRequest& request)
@@ -99,12 +99,11 @@ static UniValue tl_decodetransaction(const JSONRPCRequest& request)
     int populateResult = -3331;
     {
         LOCK2(cs_main, cs_tx_cache);
-        // temporarily switch global coins view cache for transaction inputs
-        std::swap(view, viewTemp);
+        // temporarily switch global coins view cache for transaction inputs,
+        // the original, unpolluted coins view cache is restored at the end of the scope
+        CTempInputView tempView(viewTemp);
         // then get the results
         populateResult = populateRPCTransactionObject(tx, uint256(), txObj, "", false, "", blockHeight, pWallet.get());
-        // and restore the original, unpolluted coins view cache
-        std::swap(viewTemp, view);
     }
 
     if (populateResult != 0) PopulateFailure(populateResult);
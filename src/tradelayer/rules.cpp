@@ -18,14 +18,17 @@
 #include <chainparams.h>
 #include <validation.h>
 #include <script/standard.h>
+#include <sync.h>
 #include <uint256.h>
 #include <ui_interface.h>
 
 #include <openssl/sha.h>
 
 #include <stdint.h>
+#include <algorithm>
 #include <limits>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace mastercore
@@ -357,10 +360,72 @@ static CTestNetConsensusParams testNetConsensusParams;
 //! Consensus parameters for regtest mode
 static CRegTestConsensusParams regTestConsensusParams;
 
+//! Permissions of a transaction type and version, compiled from the transaction restrictions
+struct TxTypePermission
+{
+    //! Whether the type can be used with any property identifier
+    bool fEnabled;
+    //! Whether the type can be used with a property identifier of 0 (= BTC)
+    bool fWildcard;
+    //! First block, in which the type is enabled
+    int nActivationBlock;
+    //! First block, in which the type is enabled with a property identifier of 0
+    int nWildcardActivationBlock;
+
+    TxTypePermission() : fEnabled(false), fWildcard(false),
+        nActivationBlock(std::numeric_limits<int>::max()), nWildcardActivationBlock(std::numeric_limits<int>::max()) {}
+};
+
+//! Guards the transaction type permissions
+static CCriticalSection cs_tx_permissions;
+//! Transaction type permissions, indexed by type and version
+static std::unordered_map<uint32_t, TxTypePermission> mapTxPermissions;
+//! Consensus parameters, the permissions were compiled from, or nullptr, if they need to be rebuilt
+static const CConsensusParams* pTxPermissionsParams = nullptr;
+
+static uint32_t TxPermissionKey(uint16_t txType, uint16_t version)
+{
+    return (static_cast<uint32_t>(txType) << 16) | version;
+}
+
 /**
- * Returns consensus parameters for the given network.
+ * Compiles the transaction restrictions into a table of permissions.
  */
-CConsensusParams& ConsensusParams(const std::string& network)
+static void BuildTxPermissions(const CConsensusParams& params) EXCLUSIVE_LOCKS_REQUIRED(cs_tx_permissions)
+{
+    mapTxPermissions.clear();
+
+    const std::vector<TransactionRestriction> vTxRestrictions = params.GetRestrictions();
+    for (std::vector<TransactionRestriction>::const_iterator it = vTxRestrictions.begin(); it != vTxRestrictions.end(); ++it)
+    {
+        const TransactionRestriction& entry = *it;
+        TxTypePermission& permission = mapTxPermissions[TxPermissionKey(entry.txType, entry.txVersion)];
+        permission.fEnabled = true;
+        permission.nActivationBlock = std::min(permission.nActivationBlock, entry.activationBlock);
+        if (entry.allowWildcard) {
+            permission.fWildcard = true;
+            permission.nWildcardActivationBlock = std::min(permission.nWildcardActivationBlock, entry.activationBlock);
+        }
+    }
+
+    pTxPermissionsParams = &params;
+}
+
+/**
+ * Marks the transaction type permissions as outdated, so they are rebuilt
+ * before the next use.
+ */
+static void InvalidateTxPermissions()
+{
+    LOCK(cs_tx_permissions);
+    pTxPermissionsParams = nullptr;
+}
+
+/**
+ * Returns consensus parameters for the given network, without invalidating
+ * the transaction type permissions.
+ */
+static CConsensusParams& GetConsensusParams(const std::string& network)
 {
     if (network == "main") {
         return mainConsensusParams;
@@ -375,6 +440,18 @@ CConsensusParams& ConsensusParams(const std::string& network)
     return mainConsensusParams;
 }
 
+/**
+ * Returns consensus parameters for the given network.
+ *
+ * The parameters may be changed, so the transaction type permissions are rebuilt.
+ */
+CConsensusParams& ConsensusParams(const std::string& network)
+{
+    InvalidateTxPermissions();
+
+    return GetConsensusParams(network);
+}
+
 /**
  * Returns currently active consensus parameter.
  */
@@ -382,7 +459,7 @@ const CConsensusParams& ConsensusParams()
 {
     const std::string& network = Params().NetworkIDString();
 
-    return ConsensusParams(network);
+    return GetConsensusParams(network);
 }
 
 /**
@@ -392,7 +469,9 @@ CConsensusParams& MutableConsensusParams()
 {
     const std::string& network = Params().NetworkIDString();
 
-    return ConsensusParams(network);
+    InvalidateTxPermissions();
+
+    return GetConsensusParams(network);
 }
 
 /**
@@ -403,6 +482,8 @@ void ResetConsensusParams()
     mainConsensusParams = CMainConsensusParams();
     testNetConsensusParams = CTestNetConsensusParams();
     regTestConsensusParams = CRegTestConsensusParams();
+
+    InvalidateTxPermissions();
 }
 
 /**
@@ -690,28 +771,32 @@ bool IsFeatureActivated(uint16_t featureId, int transactionBlock)
  */
 bool IsTransactionTypeAllowed(int txBlock, uint32_t txProperty, uint16_t txType, uint16_t version)
 {
-    const std::vector<TransactionRestriction>& vTxRestrictions = ConsensusParams().GetRestrictions();
-
-    for (std::vector<TransactionRestriction>::const_iterator it = vTxRestrictions.begin(); it != vTxRestrictions.end(); ++it)
+    const CConsensusParams& params = ConsensusParams();
+    TxTypePermission permission;
     {
-        const TransactionRestriction& entry = *it;
-        if (entry.txType != txType || entry.txVersion != version) {
-            continue;
-        }
-        // a property identifier of 0 (= BTC) may be used as wildcard
-        if (TL_PROPERTY_BTC == txProperty && !entry.allowWildcard) {
-            continue;
-        }
-        // transactions are not restricted in the test ecosystem
-        if (isTestEcosystemProperty(txProperty)) {
-            return true;
+        LOCK(cs_tx_permissions);
+        if (pTxPermissionsParams != &params) {
+            BuildTxPermissions(params);
         }
-        if (txBlock >= entry.activationBlock) {
-            return true;
+
+        std::unordered_map<uint32_t, TxTypePermission>::const_iterator it = mapTxPermissions.find(TxPermissionKey(txType, version));
+        if (it == mapTxPermissions.end()) {
+            return false;
         }
+        permission = it->second;
     }
 
-    return false;
+    // a property identifier of 0 (= BTC) may be used as wildcard
+    const bool fWildcard = (TL_PROPERTY_BTC == txProperty);
+    if (fWildcard ? !permission.fWildcard : !permission.fEnabled) {
+        return false;
+    }
+    // transactions are not restricted in the test ecosystem
+    if (isTestEcosystemProperty(txProperty)) {
+        return true;
+    }
+
+    return txBlock >= (fWildcard ? permission.nWildcardActivationBlock : permission.nActivationBlock);
 }
 
 /**
@@ -75,6 +75,42 @@ bool GetScriptPushes(const CScript& script, std::vector<std::string>& vstrRet, b
     return true;
 }
 
+/**
+ * Extracts the pushed data as spans of the script bytes from a script.
+ *
+ * The spans point into the script, so no data is copied, but they are only
+ * valid as long as the script is alive and unchanged.
+ *
+ * @param script[in]      The script
+ * @param vRet[out]       The extracted pushed data
+ * @param fSkipFirst[in]  Whether the first push operation should be skipped (default: false)
+ * @return True if the extraction was successful (result can be empty)
+ */
+bool GetScriptPushes(const CScript& script, std::vector<Span<const unsigned char> >& vRet, bool fSkipFirst)
+{
+    int count = 0;
+    CScript::const_iterator pc = script.begin();
+
+    while (pc < script.end()) {
+        const CScript::const_iterator pcOp = pc;
+        opcodetype opcode;
+        if (!script.GetOp(pc, opcode))
+            return false;
+        if (0x00 <= opcode && opcode <= OP_PUSHDATA4) {
+            // the pushed data follows the opcode and its size
+            unsigned int nHeaderSize = 1;
+            if (opcode == OP_PUSHDATA1) nHeaderSize = 2;
+            else if (opcode == OP_PUSHDATA2) nHeaderSize = 3;
+            else if (opcode == OP_PUSHDATA4) nHeaderSize = 5;
+            const unsigned char* pBegin = script.data() + (pcOp - script.begin()) + nHeaderSize;
+            const unsigned char* pEnd = script.data() + (pc - script.begin());
+            if (count++ || !fSkipFirst) vRet.push_back(Span<const unsigned char>(pBegin, pEnd));
+        }
+    }
+
+    return true;
+}
+
 /**
  * Returns public keys or hashes from scriptPubKey, for standard transaction types.
  *
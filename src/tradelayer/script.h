@@ -7,6 +7,7 @@
 class CScript;
 
 #include <script/standard.h>
+#include <span.h>
 
 /** Determines the minimum output amount to be spent by an output. */
 int64_t TLGetDustThreshold(const CScript& scriptPubKey);
@@ -17,6 +18,9 @@ bool GetOutputType(const CScript& scriptPubKey, txnouttype& whichTypeRet);
 /** Extracts the pushed data as hex-encoded string from a script. */
 bool GetScriptPushes(const CScript& script, std::vector<std::string>& vstrRet, bool fSkipFirst = false);
 
+/** Extracts the pushed data as spans of the script bytes from a script. */
+bool GetScriptPushes(const CScript& script, std::vector<Span<const unsigned char> >& vRet, bool fSkipFirst = false);
+
 /** Returns public keys or hashes from scriptPubKey, for standard transaction types. */
 bool SafeSolver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet);
 
@@ -1,85 +1,111 @@
 #include <tradelayer/sto.h>
 
+#include <tradelayer/arith128.h>
 #include <tradelayer/log.h>
 #include <tradelayer/tradelayer.h>
 #include <tradelayer/tally.h>
-#include <tradelayer/uint256_extensions.h>
 
-#include <arith_uint256.h>
 #include <sync.h>
 
+#include <algorithm>
 #include <assert.h>
 #include <stdint.h>
-#include <map>
-#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace mastercore
 {
 
 /**
- * Compares two owner/receiver entries, based on amount.
+ * Compares two owner/receiver entries, the larger amount first, and then
+ * by address.
  */
-bool SendToOwners_compare::operator()(const std::pair<int64_t, std::string>& p1, const std::pair<int64_t, std::string>& p2) const
+static bool SendToOwners_compare(const std::pair<int64_t, std::string>& p1, const std::pair<int64_t, std::string>& p2)
 {
-    if (p1.first == p2.first) return p1.second > p2.second; // reverse check
-    else return p1.first < p2.first;
+    if (p1.first == p2.first) return p1.second < p2.second;
+    else return p1.first > p2.first;
+}
+
+/**
+ * Compares two owner entries, which refer to their address, in the same
+ * order.
+ */
+static bool SendToOwners_compareRef(const std::pair<int64_t, const std::string*>& p1, const std::pair<int64_t, const std::string*>& p2)
+{
+    if (p1.first == p2.first) return *p1.second < *p2.second;
+    else return p1.first > p2.first;
 }
 
 /**
  * Determines the receivers and amounts to distribute.
  *
+ * Only the addresses, which were credited with tokens of the property, are
+ * visited, and the shares are computed with 128 bit integers. Holders, which
+ * no longer hold any tokens, are removed from the list of holders.
+ *
  * The sender is excluded from the result set.
  */
 OwnerAddrType STO_GetReceivers(const std::string& sender, uint32_t property, int64_t amount)
 {
     int64_t totalTokens = 0;
     int64_t senderTokens = 0;
-    OwnerAddrType ownerAddrSet;
+    OwnerAddrType receiversSet;
 
-    {
-        LOCK(cs_tally);
-        std::unordered_map<std::string, CMPTally>::iterator it;
+    LOCK(cs_tally);
 
-        for (it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const std::string& address = it->first;
-            const CMPTally& tally = it->second;
+    // Holders with balance, referring to the keys of the tally map, which are stable while cs_tally is held
+    std::vector<std::pair<int64_t, const std::string*> > owners;
 
+    std::unordered_map<uint32_t, std::unordered_set<std::string> >::iterator holders = mapPropertyHolders.find(property);
+    if (holders != mapPropertyHolders.end()) {
+        owners.reserve(holders->second.size());
+
+        std::unordered_set<std::string>::iterator it = holders->second.begin();
+        while (it != holders->second.end()) {
+            std::unordered_map<std::string, CMPTally>::const_iterator my_it = mp_tally_map.find(*it);
             int64_t tokens = 0;
-            tokens += tally.getMoney(property, BALANCE);
-            tokens += tally.getMoney(property, SELLOFFER_RESERVE);
-            tokens += tally.getMoney(property, ACCEPT_RESERVE);
-            tokens += tally.getMoney(property, METADEX_RESERVE);
+            if (my_it != mp_tally_map.end()) {
+                const CMPTally& tally = my_it->second;
+                tokens += tally.getMoney(property, BALANCE);
+                tokens += tally.getMoney(property, SELLOFFER_RESERVE);
+                tokens += tally.getMoney(property, ACCEPT_RESERVE);
+                tokens += tally.getMoney(property, METADEX_RESERVE);
+            }
 
-            // Do not include the sender
-            if (address == sender) {
-                senderTokens = tokens;
+            // The address is added again, once it's credited with tokens
+            if (tokens == 0) {
+                it = holders->second.erase(it);
                 continue;
             }
 
-            totalTokens += tokens;
+            // Do not include the sender
+            if (my_it->first == sender) {
+                senderTokens = tokens;
+            } else {
+                totalTokens += tokens;
 
-            // Only holders with balance are relevant
-            if (0 < tokens) {
-                ownerAddrSet.insert(std::make_pair(tokens, address));
+                // Only holders with balance are relevant
+                if (0 < tokens) {
+                    owners.push_back(std::make_pair(tokens, &my_it->first));
+                }
             }
+            ++it;
         }
     }
 
+    std::sort(owners.begin(), owners.end(), SendToOwners_compareRef);
+
     // Split up what was taken and distribute between all holders
     int64_t sent_so_far = 0;
-    OwnerAddrType receiversSet;
 
-    for (OwnerAddrType::reverse_iterator it = ownerAddrSet.rbegin(); it != ownerAddrSet.rend(); ++it) {
-        const std::string& address = it->second;
-
-        arith_uint256 owns = ConvertTo256(it->first);
-        arith_uint256 temp = owns * ConvertTo256(amount);
-        arith_uint256 piece = DivideAndRoundUp(temp, ConvertTo256(totalTokens));
+    for (std::vector<std::pair<int64_t, const std::string*> >::const_iterator it = owners.begin(); it != owners.end(); ++it) {
+        const std::string& address = *it->second;
 
         int64_t will_really_receive = 0;
-        int64_t should_receive = ConvertTo64(piece);
+        int64_t should_receive = MulDiv(it->first, amount, totalTokens, ROUND_UP);
 
         // Ensure that no more than available is distributed
         if ((amount - sent_so_far) < should_receive) {
@@ -91,18 +117,21 @@ OwnerAddrType STO_GetReceivers(const std::string& sender, uint32_t property, int
         sent_so_far += will_really_receive;
 
         if (msc_debug_sto) {
-            PrintToLog("%14d = %s, temp= %38s, should_get= %19d, will_really_get= %14d, sent_so_far= %14d\n",
-                it->first, address, temp.ToString(), should_receive, will_really_receive, sent_so_far);
+            PrintToLog("%14d = %s, should_get= %19d, will_really_get= %14d, sent_so_far= %14d\n",
+                it->first, address, should_receive, will_really_receive, sent_so_far);
         }
 
         // Stop, once the whole amount is allocated
         if (will_really_receive > 0) {
-            receiversSet.insert(std::make_pair(will_really_receive, address));
+            receiversSet.push_back(std::make_pair(will_really_receive, address));
         } else {
             break;
         }
     }
 
+    // Holders with fewer tokens may receive the same amount, if rounded up
+    std::sort(receiversSet.begin(), receiversSet.end(), SendToOwners_compare);
+
     uint64_t numberOfOwners = receiversSet.size();
     PrintToLog("\t    Total Tokens: %s\n", FormatMP(property, totalTokens + senderTokens));
     PrintToLog("\tExcluding Sender: %s\n", FormatMP(property, totalTokens));
@@ -0,0 +1,170 @@
+#include <tradelayer/arith128.h>
+#include <tradelayer/externfns.h>
+#include <tradelayer/mdex.h>
+#include <tradelayer/parse_string.h>
+#include <tradelayer/uint256_extensions.h>
+
+#include <amount.h>
+#include <arith_uint256.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdint.h>
+#include <limits>
+#include <vector>
+
+using namespace mastercore;
+
+namespace
+{
+//! Numbers near the boundaries of the calculations
+const std::vector<int64_t> vEdgeValues = {
+    0, 1, 2, 3, 7, 99, 100, 1000,
+    COIN - 1, COIN, COIN + 1,
+    std::numeric_limits<int32_t>::max(),
+    std::numeric_limits<uint32_t>::max(),
+    int64_t(1) << 40,
+    int64_t(1) << 62,
+    std::numeric_limits<int64_t>::max() / COIN,
+    std::numeric_limits<int64_t>::max() - 1,
+    std::numeric_limits<int64_t>::max(),
+};
+
+//! The previous arith_uint256 calculations, or false, if the result is out of range of int64_t
+bool ReferenceMulDiv(int64_t a, int64_t b, int64_t c, int64_t& result, bool fRoundUp)
+{
+    arith_uint256 quotient = fRoundUp ?
+            DivideAndRoundUp(ConvertTo256(a) * ConvertTo256(b), ConvertTo256(c)) :
+            (ConvertTo256(a) * ConvertTo256(b)) / ConvertTo256(c);
+    if (quotient > uint256_const::max_int64) return false;
+    result = ConvertTo64(quotient);
+    return true;
+}
+
+void CheckMulDiv(int64_t a, int64_t b, int64_t c)
+{
+    int64_t expected = 0;
+    int64_t result = 0;
+
+    bool fExpected = ReferenceMulDiv(a, b, c, expected, false);
+    BOOST_CHECK_EQUAL(fExpected, MulDivChecked(a, b, c, result, ROUND_DOWN));
+    if (fExpected) BOOST_CHECK_EQUAL(expected, result);
+
+    fExpected = ReferenceMulDiv(a, b, c, expected, true);
+    BOOST_CHECK_EQUAL(fExpected, MulDivChecked(a, b, c, result, ROUND_UP));
+    if (fExpected) BOOST_CHECK_EQUAL(expected, result);
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_arith128_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(muldiv_small_values)
+{
+    for (int64_t a = 0; a <= 40; ++a) {
+        for (int64_t b = 0; b <= 40; ++b) {
+            for (int64_t c = 1; c <= 40; ++c) {
+                CheckMulDiv(a, b, c);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(muldiv_edge_values)
+{
+    for (int64_t a : vEdgeValues) {
+        for (int64_t b : vEdgeValues) {
+            for (int64_t c : vEdgeValues) {
+                if (c > 0) CheckMulDiv(a, b, c);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(muldiv_rounding)
+{
+    BOOST_CHECK_EQUAL(MulDiv(7, 1, 2, ROUND_DOWN), 3);
+    BOOST_CHECK_EQUAL(MulDiv(7, 1, 2, ROUND_UP), 4);
+    BOOST_CHECK_EQUAL(MulDiv(7, 1, 2, ROUND_HALF_UP), 4);
+    BOOST_CHECK_EQUAL(MulDiv(5, 1, 3, ROUND_HALF_UP), 2);
+    BOOST_CHECK_EQUAL(MulDiv(4, 1, 3, ROUND_HALF_UP), 1);
+    BOOST_CHECK_EQUAL(MulDiv(6, 1, 3, ROUND_UP), 2);
+    BOOST_CHECK_EQUAL(MulDiv(0, 5, 3, ROUND_UP), 0);
+
+    const int64_t max = std::numeric_limits<int64_t>::max();
+    BOOST_CHECK_EQUAL(MulDiv(max, max, max, ROUND_UP), max);
+    BOOST_CHECK_EQUAL(MulDiv(max, max - 1, max, ROUND_DOWN), max - 1);
+
+    int64_t result = 0;
+    BOOST_CHECK(!MulDivChecked(max, 2, 1, result));
+    BOOST_CHECK(!MulDivChecked(max, max, max - 1, result, ROUND_DOWN));
+}
+
+BOOST_AUTO_TEST_CASE(muldiv_division_by_zero)
+{
+    int64_t result = 0;
+    BOOST_CHECK_THROW(MulDivChecked(1, 1, 0, result), uint_error);
+    BOOST_CHECK_THROW(MulMulDiv(1, 1, 1, 1, 0), uint_error);
+}
+
+BOOST_AUTO_TEST_CASE(mulmuldiv_edge_values)
+{
+    const std::vector<uint64_t> vDivisors = {1, 2, 7, 100, 1000, COIN, 1000 * COIN, std::numeric_limits<uint64_t>::max()};
+
+    for (int64_t a : vEdgeValues) {
+        for (int64_t b : vEdgeValues) {
+            for (int64_t c : {int64_t(0), int64_t(1), int64_t(5), int64_t(25), COIN, std::numeric_limits<int64_t>::max()}) {
+                for (uint64_t d : vDivisors) {
+                    for (uint64_t e : vDivisors) {
+                        arith_uint256 expected = ConvertTo256(a) * ConvertTo256(b) * ConvertTo256(c) / (ConvertTo256(d) * ConvertTo256(e));
+                        if (expected > uint256_const::max_int64) continue;
+                        BOOST_CHECK_EQUAL(ConvertTo64(expected), MulMulDiv(a, b, c, d, e));
+                    }
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compare_fractions)
+{
+    for (int64_t a : vEdgeValues) {
+        for (int64_t b : vEdgeValues) {
+            for (int64_t c : vEdgeValues) {
+                for (int64_t d : vEdgeValues) {
+                    if (b == 0 || d == 0) continue;
+                    const rational_t x(a, b);
+                    const rational_t y(c, d);
+                    const int expected = (x < y) ? -1 : ((x > y) ? 1 : 0);
+                    BOOST_CHECK_EQUAL(expected, CompareFractions(a, b, c, d));
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rational_to_int64)
+{
+    std::vector<rational_t> values;
+    for (int64_t num = -3; num <= 60; ++num) {
+        for (int64_t den = 1; den <= 60; ++den) {
+            values.push_back(rational_t(num, den));
+        }
+    }
+    for (int64_t num : vEdgeValues) {
+        for (int64_t den : vEdgeValues) {
+            if (den != 0) values.push_back(rational_t(num, den));
+        }
+    }
+    const boost::multiprecision::checked_int128_t large = boost::multiprecision::checked_int128_t(std::numeric_limits<int64_t>::max()) * 3;
+    values.push_back(rational_t(large, 7));
+    values.push_back(rational_t(7, large));
+    values.push_back(rational_t(-large, 7));
+
+    for (const rational_t& value : values) {
+        // the previous conversion through the decimal string
+        BOOST_CHECK_EQUAL(StrToInt64(xToString(value), true), RationalToInt64(value));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
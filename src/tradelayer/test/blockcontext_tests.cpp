@@ -0,0 +1,73 @@
+#include <tradelayer/blockcontext.h>
+#include <tradelayer/rules.h>
+#include <tradelayer/tradelayer.h>
+
+#include <chain.h>
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_blockcontext_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(block_context_fields)
+{
+    uint256 hash = uint256S("0a");
+    CBlockIndex index;
+    index.nHeight = 150;
+    index.nTime = 1550000000;
+    index.phashBlock = &hash;
+
+    CBlockContext emptyContext;
+    BOOST_CHECK(!emptyContext.IsFor(&index));
+    BOOST_CHECK(!emptyContext.IsFor(nullptr));
+
+    CBlockContext context(&index);
+    BOOST_CHECK(context.IsFor(&index));
+    BOOST_CHECK_EQUAL(context.nHeight, 150);
+    BOOST_CHECK_EQUAL(context.nTime, 1550000000);
+    BOOST_CHECK(context.hash == hash);
+
+    CBlockIndex otherIndex;
+    BOOST_CHECK(!context.IsFor(&otherIndex));
+}
+
+BOOST_AUTO_TEST_CASE(block_context_restrictions)
+{
+    uint256 hash = uint256S("0b");
+    CBlockIndex index;
+    index.nHeight = 0;
+    index.phashBlock = &hash;
+
+    CBlockContext context(&index);
+    for (int i = 0; i < 2; ++i) {
+        BOOST_CHECK_EQUAL(context.IsTransactionTypeAllowed(TL_PROPERTY_MSC, MSC_TYPE_OFFER_ACCEPT_A_BET, MP_TX_PKT_V0),
+                IsTransactionTypeAllowed(0, TL_PROPERTY_MSC, MSC_TYPE_OFFER_ACCEPT_A_BET, MP_TX_PKT_V0));
+        BOOST_CHECK_EQUAL(context.IsTransactionTypeAllowed(TL_PROPERTY_TMSC, MSC_TYPE_OFFER_ACCEPT_A_BET, MP_TX_PKT_V0),
+                IsTransactionTypeAllowed(0, TL_PROPERTY_TMSC, MSC_TYPE_OFFER_ACCEPT_A_BET, MP_TX_PKT_V0));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_context_feature_deactivated_within_block)
+{
+    const int oldActivationBlock = ConsensusParams().MSC_BET_BLOCK;
+    MutableConsensusParams().MSC_BET_BLOCK = 100;
+
+    uint256 hash = uint256S("0c");
+    CBlockIndex index;
+    index.nHeight = 150;
+    index.phashBlock = &hash;
+
+    CBlockContext context(&index);
+    BOOST_CHECK(context.IsTransactionTypeAllowed(TL_PROPERTY_MSC, MSC_TYPE_OFFER_ACCEPT_A_BET, MP_TX_PKT_V0));
+
+    // an earlier transaction of the block deactivates the feature
+    BOOST_CHECK(DeactivateFeature(FEATURE_BETTING, 150));
+    BOOST_CHECK(!context.IsTransactionTypeAllowed(TL_PROPERTY_MSC, MSC_TYPE_OFFER_ACCEPT_A_BET, MP_TX_PKT_V0));
+
+    MutableConsensusParams().MSC_BET_BLOCK = oldActivationBlock;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,75 @@
+#include <tradelayer/blockevents.h>
+#include <tradelayer/notifications.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+#include <string>
+
+using namespace mastercore;
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_blockevents_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(block_events_due)
+{
+    ClearBlockEvents(BLOCK_EVENT_WITHDRAWAL);
+
+    ScheduleBlockEvent(BLOCK_EVENT_WITHDRAWAL, 110, "channelB");
+    ScheduleBlockEvent(BLOCK_EVENT_WITHDRAWAL, 110, "channelA");
+    ScheduleBlockEvent(BLOCK_EVENT_WITHDRAWAL, 110, "channelA");
+    ScheduleBlockEvent(BLOCK_EVENT_WITHDRAWAL, 120, "channelC");
+
+    BOOST_CHECK(PopDueBlockEvents(BLOCK_EVENT_WITHDRAWAL, 109).empty());
+
+    std::set<std::string> due = PopDueBlockEvents(BLOCK_EVENT_WITHDRAWAL, 110);
+    BOOST_CHECK_EQUAL(due.size(), 2U);
+    BOOST_CHECK_EQUAL(*due.begin(), "channelA");
+    BOOST_CHECK_EQUAL(*due.rbegin(), "channelB");
+
+    // events are only returned once
+    BOOST_CHECK(PopDueBlockEvents(BLOCK_EVENT_WITHDRAWAL, 110).empty());
+
+    // overdue events are returned as well
+    due = PopDueBlockEvents(BLOCK_EVENT_WITHDRAWAL, 200);
+    BOOST_CHECK_EQUAL(due.size(), 1U);
+    BOOST_CHECK_EQUAL(*due.begin(), "channelC");
+}
+
+BOOST_AUTO_TEST_CASE(block_events_types)
+{
+    ClearBlockEvents(BLOCK_EVENT_ACTIVATION);
+    ClearBlockEvents(BLOCK_EVENT_ACCEPT_EXPIRY);
+
+    ScheduleBlockEvent(BLOCK_EVENT_ACTIVATION, 50);
+    ScheduleBlockEvent(BLOCK_EVENT_ACCEPT_EXPIRY, 50, "accept");
+
+    BOOST_CHECK_EQUAL(PopDueBlockEvents(BLOCK_EVENT_ACTIVATION, 50).size(), 1U);
+    BOOST_CHECK_EQUAL(PopDueBlockEvents(BLOCK_EVENT_ACCEPT_EXPIRY, 50).size(), 1U);
+
+    ScheduleBlockEvent(BLOCK_EVENT_ACCEPT_EXPIRY, 60, "accept");
+    ClearBlockEvents(BLOCK_EVENT_ACCEPT_EXPIRY);
+    BOOST_CHECK(PopDueBlockEvents(BLOCK_EVENT_ACCEPT_EXPIRY, 60).empty());
+}
+
+BOOST_AUTO_TEST_CASE(block_events_alerts)
+{
+    ClearAlerts();
+
+    AddAlert("tradelayer", ALERT_BLOCK_EXPIRY, 300, "expires at block 300");
+    BOOST_CHECK(PopDueBlockEvents(BLOCK_EVENT_ALERT_EXPIRY, 299).empty());
+    BOOST_CHECK(!PopDueBlockEvents(BLOCK_EVENT_ALERT_EXPIRY, 300).empty());
+
+    // alerts by block time are checked again with every block, until they expire
+    AddAlert("tradelayer", ALERT_BLOCKTIME_EXPIRY, 1500000000, "expires by time");
+    BOOST_CHECK(!PopDueBlockEvents(BLOCK_EVENT_ALERT_EXPIRY, 301).empty());
+    CheckExpiredAlerts(301, 1400000000);
+    BOOST_CHECK(!PopDueBlockEvents(BLOCK_EVENT_ALERT_EXPIRY, 302).empty());
+    CheckExpiredAlerts(302, 1600000000);
+    BOOST_CHECK(PopDueBlockEvents(BLOCK_EVENT_ALERT_EXPIRY, 303).empty());
+
+    ClearAlerts();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,171 @@
+#include <tradelayer/dbblockfilter.h>
+
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_blockfilter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(block_filter_skips_processed_blocks)
+{
+    CTLBlockFilter blockFilter(GetDataDir() / "tl_blockfilter_test", true);
+    BOOST_CHECK(!blockFilter.CanSkipBlock(100));
+
+    blockFilter.RecordBlock(100, uint256S("a0"), false);
+    blockFilter.RecordBlock(101, uint256S("a1"), true);
+    blockFilter.RecordBlock(102, uint256S("a2"), false);
+
+    BOOST_CHECK(blockFilter.CanSkipBlock(100));
+    BOOST_CHECK(!blockFilter.CanSkipBlock(101));
+    BOOST_CHECK(blockFilter.CanSkipBlock(102));
+    BOOST_CHECK(!blockFilter.CanSkipBlock(99));
+    BOOST_CHECK(!blockFilter.CanSkipBlock(103));
+    BOOST_CHECK_EQUAL(blockFilter.CountRanges(), 1U);
+    BOOST_CHECK_EQUAL(blockFilter.CountTLBlocks(), 1U);
+
+    int nBlock = 0;
+    uint256 hashBlock;
+    BOOST_CHECK(blockFilter.GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(nBlock, 102);
+    BOOST_CHECK(hashBlock == uint256S("a2"));
+
+    // a block, which is processed again, is updated
+    blockFilter.RecordBlock(100, uint256S("a0"), true);
+    BOOST_CHECK(!blockFilter.CanSkipBlock(100));
+    BOOST_CHECK_EQUAL(blockFilter.CountTLBlocks(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(block_filter_merges_ranges)
+{
+    CTLBlockFilter blockFilter(GetDataDir() / "tl_blockfilter_test", true);
+
+    // e.g. a reparse from the beginning, after blocks above the waterline were processed
+    blockFilter.RecordBlock(50, uint256S("b0"), false);
+    blockFilter.RecordBlock(51, uint256S("b1"), false);
+    blockFilter.RecordBlock(10, uint256S("c0"), false);
+    BOOST_CHECK_EQUAL(blockFilter.CountRanges(), 2U);
+    BOOST_CHECK(!blockFilter.CanSkipBlock(30));
+
+    for (int n = 11; n < 50; ++n) {
+        blockFilter.RecordBlock(n, uint256(), n == 30);
+    }
+    BOOST_CHECK_EQUAL(blockFilter.CountRanges(), 1U);
+    BOOST_CHECK(blockFilter.CanSkipBlock(29));
+    BOOST_CHECK(!blockFilter.CanSkipBlock(30));
+
+    // the highest block remains the anchor
+    int nBlock = 0;
+    uint256 hashBlock;
+    BOOST_CHECK(blockFilter.GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(nBlock, 51);
+    BOOST_CHECK(hashBlock == uint256S("b1"));
+}
+
+BOOST_AUTO_TEST_CASE(block_filter_rollback)
+{
+    CTLBlockFilter blockFilter(GetDataDir() / "tl_blockfilter_test", true);
+    for (int n = 100; n <= 110; ++n) {
+        blockFilter.RecordBlock(n, uint256(), n % 2 == 0);
+    }
+    BOOST_CHECK_EQUAL(blockFilter.CountTLBlocks(), 6U);
+
+    blockFilter.DeleteAboveBlock(105, uint256S("d4"));
+    BOOST_CHECK(blockFilter.CanSkipBlock(103));
+    BOOST_CHECK(!blockFilter.CanSkipBlock(105));
+    BOOST_CHECK(!blockFilter.IsProcessed(107));
+    BOOST_CHECK_EQUAL(blockFilter.CountTLBlocks(), 3U);
+
+    // the previous block becomes the anchor
+    int nBlock = 0;
+    uint256 hashBlock;
+    BOOST_CHECK(blockFilter.GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(nBlock, 104);
+    BOOST_CHECK(hashBlock == uint256S("d4"));
+
+    blockFilter.RecordBlock(105, uint256S("d5"), false);
+    BOOST_CHECK(blockFilter.GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(nBlock, 105);
+    BOOST_CHECK(hashBlock == uint256S("d5"));
+    BOOST_CHECK_EQUAL(blockFilter.CountRanges(), 1U);
+
+    blockFilter.DeleteAboveBlock(50, uint256S("e0"));
+    BOOST_CHECK(!blockFilter.GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(blockFilter.CountTLBlocks(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(block_filter_rollback_then_rescan)
+{
+    std::unique_ptr<CTLBlockFilter> blockFilter(new CTLBlockFilter(GetDataDir() / "tl_blockfilter_test", true));
+    blockFilter->RecordBlock(10, uint256S("a0"), false);
+    for (int n = 20; n <= 30; ++n) {
+        blockFilter->RecordBlock(n, uint256(), n == 25);
+    }
+
+    // a rollback below the highest range, e.g. a reorganization or the rewind at startup
+    blockFilter->DeleteAboveBlock(28, uint256S("b7"));
+
+    // the anchor is kept, when the database is reopened for the rescan
+    blockFilter.reset();
+    blockFilter.reset(new CTLBlockFilter(GetDataDir() / "tl_blockfilter_test", false));
+    int nBlock = 0;
+    uint256 hashBlock;
+    BOOST_CHECK(blockFilter->GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(nBlock, 27);
+    BOOST_CHECK(hashBlock == uint256S("b7"));
+
+    // the rescan skips the remaining blocks, and records the others again
+    BOOST_CHECK(blockFilter->CanSkipBlock(10));
+    BOOST_CHECK(blockFilter->CanSkipBlock(24));
+    BOOST_CHECK(!blockFilter->CanSkipBlock(25));
+    BOOST_CHECK(!blockFilter->CanSkipBlock(28));
+    for (int n = 20; n <= 29; ++n) {
+        blockFilter->RecordBlock(n, n == 27 ? uint256S("b7") : uint256(), n == 25);
+    }
+    BOOST_CHECK_EQUAL(blockFilter->CountRanges(), 2U);
+    BOOST_CHECK_EQUAL(blockFilter->CountTLBlocks(), 1U);
+    BOOST_CHECK(blockFilter->GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(nBlock, 29);
+
+    // a rollback into the gap between the ranges keeps the lower range
+    blockFilter->DeleteAboveBlock(15, uint256S("c4"));
+    BOOST_CHECK(blockFilter->CanSkipBlock(10));
+    BOOST_CHECK(!blockFilter->IsProcessed(20));
+    BOOST_CHECK(blockFilter->GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(nBlock, 14);
+    BOOST_CHECK(hashBlock == uint256S("c4"));
+}
+
+BOOST_AUTO_TEST_CASE(block_filter_persistence)
+{
+    std::unique_ptr<CTLBlockFilter> blockFilter(new CTLBlockFilter(GetDataDir() / "tl_blockfilter_test", true));
+    blockFilter->RecordBlock(200, uint256S("e0"), true);
+    blockFilter->RecordBlock(201, uint256S("e1"), false);
+    blockFilter->RecordBlock(300, uint256S("f0"), true);
+
+    // reopened without wiping
+    blockFilter.reset();
+    blockFilter.reset(new CTLBlockFilter(GetDataDir() / "tl_blockfilter_test", false));
+    BOOST_CHECK_EQUAL(blockFilter->CountRanges(), 2U);
+    BOOST_CHECK_EQUAL(blockFilter->CountTLBlocks(), 2U);
+    BOOST_CHECK(!blockFilter->CanSkipBlock(200));
+    BOOST_CHECK(blockFilter->CanSkipBlock(201));
+    BOOST_CHECK(!blockFilter->CanSkipBlock(300));
+
+    int nBlock = 0;
+    uint256 hashBlock;
+    BOOST_CHECK(blockFilter->GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK_EQUAL(nBlock, 300);
+    BOOST_CHECK(hashBlock == uint256S("f0"));
+
+    blockFilter->Clear();
+    blockFilter.reset();
+    blockFilter.reset(new CTLBlockFilter(GetDataDir() / "tl_blockfilter_test", false));
+    BOOST_CHECK(!blockFilter->GetAnchorBlock(nBlock, hashBlock));
+    BOOST_CHECK(!blockFilter->CanSkipBlock(201));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,68 @@
+#include <tradelayer/dbtradelist.h>
+
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+extern std::map<std::string,channel> channels_Map;
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_channels_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(channel_lookup)
+{
+    CMPTradeList tradeList(GetDataDir() / "tl_channels_test", true);
+
+    tradeList.recordNewChannel("channel", "alice", "bob", 500, 1);
+    tradeList.recordNewTrade(uint256S("01"), "alice", 1, 2, 100, 2);
+
+    channel chn = tradeList.getChannelAddresses("channel");
+    BOOST_CHECK_EQUAL(chn.multisig, "channel");
+    BOOST_CHECK_EQUAL(chn.first, "alice");
+    BOOST_CHECK_EQUAL(chn.second, "bob");
+    BOOST_CHECK_EQUAL(chn.expiry_height, 500);
+    BOOST_CHECK(tradeList.getChannelAddresses("unknown").multisig.empty());
+
+    // channels must also be active
+    BOOST_CHECK(!tradeList.checkChannelAddress("channel"));
+    channels_Map["channel"] = chn;
+    BOOST_CHECK(tradeList.checkChannelAddress("channel"));
+    BOOST_CHECK(!tradeList.checkChannelAddress("unknown"));
+    channels_Map.erase("channel");
+}
+
+BOOST_AUTO_TEST_CASE(channel_remaining)
+{
+    CMPTradeList tradeList(GetDataDir() / "tl_channels_test", true);
+
+    tradeList.recordNewChannel("channel", "alice", "bob", 500, 1);
+    tradeList.recordNewCommit(uint256S("01"), "channel", "alice", 3, 1000, 100, 1);
+    tradeList.recordNewCommit(uint256S("02"), "channel", "alice", 3, 500, 101, 1);
+    tradeList.recordNewCommit(uint256S("03"), "channel", "bob", 3, 700, 101, 2);
+    tradeList.recordNewWithdrawal(uint256S("04"), "channel", "alice", 3, 300, 102, 1);
+
+    BOOST_CHECK_EQUAL(tradeList.getRemaining("channel", "alice", 3), 1200U);
+    BOOST_CHECK_EQUAL(tradeList.getRemaining("channel", "bob", 3), 700U);
+    BOOST_CHECK_EQUAL(tradeList.getRemaining("channel", "alice", 4), 0U);
+
+    // the cache is kept up to date, and replaced records are only counted once
+    tradeList.recordNewCommit(uint256S("05"), "channel", "alice", 3, 100, 103, 1);
+    tradeList.recordNewCommit(uint256S("05"), "channel", "alice", 3, 100, 103, 1);
+    tradeList.recordNewTransfer(uint256S("06"), "channel", "alice", 3, 200, 103, 2);
+    BOOST_CHECK_EQUAL(tradeList.getRemaining("channel", "alice", 3), 1100U);
+
+    // the cache is rebuilt from the database
+    tradeList.deleteAboveBlock(1000);
+    BOOST_CHECK_EQUAL(tradeList.getRemaining("channel", "alice", 3), 1100U);
+
+    tradeList.Clear();
+    BOOST_CHECK_EQUAL(tradeList.getRemaining("channel", "alice", 3), 0U);
+    BOOST_CHECK(tradeList.getChannelAddresses("channel").multisig.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
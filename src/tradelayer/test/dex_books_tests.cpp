@@ -0,0 +1,127 @@
+#include <tradelayer/blockevents.h>
+#include <tradelayer/dex.h>
+#include <tradelayer/tally.h>
+#include <tradelayer/tradelayer.h>
+
+#include <sync.h>
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdint.h>
+#include <set>
+#include <string>
+
+using namespace mastercore;
+
+namespace
+{
+/** Provides empty DEx books and an empty tally map. */
+struct DExBooksTestingSetup : public BasicTestingSetup
+{
+    DExBooksTestingSetup() { ClearState(); }
+    ~DExBooksTestingSetup() { ClearState(); }
+
+    static void ClearState()
+    {
+        LOCK(cs_tally);
+        mp_tally_map.clear();
+        mapPropertyHolders.clear();
+        my_offers.clear();
+        DEx_acceptsClear();
+        ClearBlockEvents(BLOCK_EVENT_ACCEPT_EXPIRY);
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_dex_books_tests, DExBooksTestingSetup)
+
+BOOST_AUTO_TEST_CASE(dex_offers_of_seller)
+{
+    LOCK(cs_tally);
+    BOOST_CHECK(update_tally_map("seller", 5, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map("seller", 12, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map("sellerB", 3, 1000, BALANCE));
+
+    uint32_t tokenId = 0;
+    BOOST_CHECK(!DEx_hasOffer("seller"));
+    BOOST_CHECK(!DEx_getTokenForSale("seller", tokenId));
+
+    BOOST_CHECK_EQUAL(DEx_offerCreate("sellerB", 3, 100, 100, 50, 10, 5, uint256()), 0);
+    BOOST_CHECK(!DEx_hasOffer("seller"));
+
+    BOOST_CHECK_EQUAL(DEx_offerCreate("seller", 5, 100, 100, 50, 10, 5, uint256()), 0);
+    BOOST_CHECK(DEx_hasOffer("seller"));
+    BOOST_CHECK(DEx_getTokenForSale("seller", tokenId));
+    BOOST_CHECK_EQUAL(tokenId, 5U);
+
+    // the offer of the former first key "seller-12" is chosen
+    BOOST_CHECK_EQUAL(DEx_offerCreate("seller", 12, 100, 100, 50, 10, 5, uint256()), 0);
+    BOOST_CHECK(DEx_getTokenForSale("seller", tokenId));
+    BOOST_CHECK_EQUAL(tokenId, 12U);
+
+    BOOST_CHECK(DEx_offerExists("seller", 12));
+    BOOST_CHECK(!DEx_offerExists("seller", 3));
+    BOOST_CHECK_EQUAL(DEx_offerDestroy("seller", 12), 0);
+    BOOST_CHECK_EQUAL(DEx_offerDestroy("seller", 5), 0);
+    BOOST_CHECK(!DEx_hasOffer("seller"));
+    BOOST_CHECK(DEx_hasOffer("sellerB"));
+    BOOST_CHECK_EQUAL(GetTokenBalance("seller", 5, BALANCE), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(dex_accepts_expire)
+{
+    LOCK(cs_tally);
+    BOOST_CHECK(update_tally_map("seller", 12, 1000, BALANCE));
+    BOOST_CHECK_EQUAL(DEx_offerCreate("seller", 12, 600, 100, 50, 10, 5, uint256()), 0);
+
+    BOOST_CHECK_EQUAL(DEx_acceptCreate("buyerA", "seller", 12, 100, 100, 10), 0);
+    BOOST_CHECK_EQUAL(DEx_acceptCreate("buyerB", "seller", 12, 200, 102, 10), 0);
+    BOOST_CHECK(DEx_acceptExists("seller", 12, "buyerA"));
+    BOOST_CHECK(!DEx_acceptExists("seller", 12, "buyerC"));
+    BOOST_CHECK(DEx_getAccept("seller", 12, "buyerB") != nullptr);
+    BOOST_CHECK_EQUAL(GetTokenBalance("seller", 12, SELLOFFER_RESERVE), 300);
+
+    BOOST_CHECK_EQUAL(eraseExpiredAccepts(104), 0U);
+    BOOST_CHECK_EQUAL(eraseExpiredAccepts(105), 1U);
+    BOOST_CHECK(!DEx_acceptExists("seller", 12, "buyerA"));
+    BOOST_CHECK(DEx_acceptExists("seller", 12, "buyerB"));
+    BOOST_CHECK_EQUAL(GetTokenBalance("seller", 12, SELLOFFER_RESERVE), 400);
+
+    BOOST_CHECK_EQUAL(eraseExpiredAccepts(107), 1U);
+    BOOST_CHECK(my_accepts.empty());
+    BOOST_CHECK_EQUAL(GetTokenBalance("seller", 12, SELLOFFER_RESERVE), 600);
+}
+
+BOOST_AUTO_TEST_CASE(dex_accept_counterparties)
+{
+    LOCK(cs_tally);
+    BOOST_CHECK(update_tally_map("seller", 12, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map("buyerB", 3, 1000, BALANCE));
+    BOOST_CHECK_EQUAL(DEx_offerCreate("seller", 12, 600, 100, 50, 10, 5, uint256()), 0);
+    BOOST_CHECK_EQUAL(DEx_offerCreate("buyerB", 3, 600, 100, 50, 10, 5, uint256()), 0);
+    BOOST_CHECK_EQUAL(DEx_acceptCreate("buyerA", "seller", 12, 100, 100, 10), 0);
+    BOOST_CHECK_EQUAL(DEx_acceptCreate("buyerB", "seller", 12, 100, 100, 10), 0);
+    BOOST_CHECK_EQUAL(DEx_acceptCreate("seller", "buyerB", 3, 100, 100, 10), 0);
+
+    BOOST_CHECK(DEx_getAcceptCounterparties("nobody").empty());
+
+    std::set<std::string> expected = {"seller"};
+    BOOST_CHECK(DEx_getAcceptCounterparties("buyerA") == expected);
+    expected = {"buyerA", "buyerB"};
+    BOOST_CHECK(DEx_getAcceptCounterparties("seller") == expected);
+    expected = {"seller"};
+    BOOST_CHECK(DEx_getAcceptCounterparties("buyerB") == expected);
+
+    // the counterparties follow removed accepts
+    BOOST_CHECK_EQUAL(DEx_acceptDestroy("buyerA", "seller", 12, true), 0);
+    BOOST_CHECK(DEx_getAcceptCounterparties("buyerA").empty());
+    expected = {"buyerB"};
+    BOOST_CHECK(DEx_getAcceptCounterparties("seller") == expected);
+
+    DEx_acceptsClear();
+    BOOST_CHECK(DEx_getAcceptCounterparties("buyerB").empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+#include <tradelayer/dbfees.h>
+#include <tradelayer/sp.h>
+#include <tradelayer/tally.h>
+#include <tradelayer/tradelayer.h>
+
+#include <sync.h>
+#include <test/test_bitcoin.h>
+#include <util/system.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <set>
+#include <stdint.h>
+
+extern std::map<uint32_t, int64_t> distributionThresholds;
+
+using namespace mastercore;
+
+namespace
+{
+/** Provides temporary fee and property databases and an empty tally map. */
+struct FeeCacheTestingSetup : public BasicTestingSetup
+{
+    CMPSPInfo* pOldSpInfo;
+    CTLFeeCache* pOldFeeCache;
+    CTLFeeHistory* pOldFeeHistory;
+
+    FeeCacheTestingSetup() : pOldSpInfo(pDbSpInfo), pOldFeeCache(pDbFeeCache), pOldFeeHistory(pDbFeeHistory)
+    {
+        pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo_fees", true);
+        pDbFeeCache = new CTLFeeCache(GetDataDir() / "TL_feecache_fees", true);
+        pDbFeeHistory = new CTLFeeHistory(GetDataDir() / "TL_feehistory_fees", true);
+        ClearState();
+    }
+
+    ~FeeCacheTestingSetup()
+    {
+        ClearState();
+        delete pDbFeeHistory;
+        delete pDbFeeCache;
+        delete pDbSpInfo;
+        pDbFeeHistory = pOldFeeHistory;
+        pDbFeeCache = pOldFeeCache;
+        pDbSpInfo = pOldSpInfo;
+    }
+
+    static void ClearState()
+    {
+        LOCK(cs_tally);
+        mp_tally_map.clear();
+        mapPropertyHolders.clear();
+        distributionThresholds.clear();
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_feecache_tests, FeeCacheTestingSetup)
+
+BOOST_AUTO_TEST_CASE(fee_cache_written_at_block_end)
+{
+    const uint32_t property = 5;
+    distributionThresholds[property] = 1000;
+
+    pDbFeeCache->AddFee(property, 100, 10);
+    pDbFeeCache->AddFee(property, 100, 10);
+    BOOST_CHECK_EQUAL(pDbFeeCache->GetCachedAmount(property), 20);
+    BOOST_CHECK(pDbFeeCache->GetCacheHistory(property).empty());
+
+    pDbFeeCache->FlushCache(100);
+    std::set<feeCacheItem> expected = {feeCacheItem(100, 20)};
+    BOOST_CHECK(pDbFeeCache->GetCacheHistory(property) == expected);
+
+    pDbFeeCache->AddFee(property, 101, 5);
+    pDbFeeCache->FlushCache(101);
+    expected.insert(feeCacheItem(101, 25));
+    BOOST_CHECK(pDbFeeCache->GetCacheHistory(property) == expected);
+    BOOST_CHECK_EQUAL(pDbFeeCache->GetCachedAmount(property), 25);
+}
+
+BOOST_AUTO_TEST_CASE(fee_distribution_at_block_end)
+{
+    const uint32_t property = 5;
+    distributionThresholds[property] = 40;
+    BOOST_CHECK(update_tally_map("alice", TL_PROPERTY_MSC, 300, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", TL_PROPERTY_MSC, 100, BALANCE));
+
+    pDbFeeCache->AddFee(property, 100, 30);
+    pDbFeeCache->AddFee(property, 100, 10);
+
+    // the threshold is reached, but the distribution waits for the end of the block
+    BOOST_CHECK_EQUAL(pDbFeeCache->GetCachedAmount(property), 40);
+    BOOST_CHECK_EQUAL(GetTokenBalance("alice", property, BALANCE), 0);
+    BOOST_CHECK_EQUAL(pDbFeeHistory->CountRecords(), 0);
+
+    pDbFeeCache->FlushCache(100);
+    BOOST_CHECK_EQUAL(GetTokenBalance("alice", property, BALANCE), 30);
+    BOOST_CHECK_EQUAL(GetTokenBalance("bob", property, BALANCE), 10);
+    BOOST_CHECK_EQUAL(pDbFeeCache->GetCachedAmount(property), 0);
+    BOOST_CHECK_EQUAL(pDbFeeHistory->CountRecords(), 1);
+
+    std::set<feeCacheItem> expected = {feeCacheItem(100, 0)};
+    BOOST_CHECK(pDbFeeCache->GetCacheHistory(property) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(fee_distribution_threshold_raised)
+{
+    const uint32_t property = 5;
+    distributionThresholds[property] = 10;
+    BOOST_CHECK(update_tally_map("alice", TL_PROPERTY_MSC, 300, BALANCE));
+
+    pDbFeeCache->AddFee(property, 100, 10);
+    distributionThresholds[property] = 100;
+    pDbFeeCache->FlushCache(100);
+
+    BOOST_CHECK_EQUAL(GetTokenBalance("alice", property, BALANCE), 0);
+    BOOST_CHECK_EQUAL(pDbFeeCache->GetCachedAmount(property), 10);
+}
+
+BOOST_AUTO_TEST_CASE(fee_cache_rollback)
+{
+    const uint32_t property = TL_PROPERTY_TMSC;
+    distributionThresholds[property] = 1000;
+
+    pDbFeeCache->AddFee(property, 100, 10);
+    pDbFeeCache->FlushCache(100);
+    pDbFeeCache->AddFee(property, 101, 15);
+    pDbFeeCache->FlushCache(101);
+    BOOST_CHECK_EQUAL(pDbFeeCache->GetCachedAmount(property), 25);
+
+    pDbFeeCache->RollBackCache(101);
+    BOOST_CHECK_EQUAL(pDbFeeCache->GetCachedAmount(property), 10);
+
+    pDbFeeCache->Clear();
+    BOOST_CHECK_EQUAL(pDbFeeCache->GetCachedAmount(property), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,96 @@
+#include <tradelayer/inputcache.h>
+
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+
+#include <stdint.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+static Coin MakeCoin(int64_t nValue)
+{
+    return Coin(CTxOut(nValue, CScript() << OP_TRUE), 1, false);
+}
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_inputcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(input_cache_eviction_order)
+{
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    CInputCacheLRU inputCache(2);
+
+    const COutPoint first(uint256S("01"), 0);
+    const COutPoint second(uint256S("02"), 0);
+    const COutPoint third(uint256S("03"), 0);
+
+    BOOST_CHECK(!inputCache.Fetch(view, first));
+    inputCache.Add(view, first, MakeCoin(100));
+    inputCache.Add(view, second, MakeCoin(200));
+
+    // using the first coin makes the second one the least recently used
+    BOOST_CHECK(inputCache.Fetch(view, first));
+    inputCache.Reserve(view, 1);
+    inputCache.Add(view, third, MakeCoin(300));
+
+    BOOST_CHECK(inputCache.Fetch(view, first));
+    BOOST_CHECK(!inputCache.Fetch(view, second));
+    BOOST_CHECK(inputCache.Fetch(view, third));
+    BOOST_CHECK_EQUAL(view.GetCacheSize(), 2U);
+
+    InputCacheStats stats = inputCache.GetStats();
+    BOOST_CHECK_EQUAL(stats.size, 2U);
+    BOOST_CHECK_EQUAL(stats.limit, 2U);
+    BOOST_CHECK_EQUAL(stats.hits, 3U);
+    BOOST_CHECK_EQUAL(stats.misses, 2U);
+    BOOST_CHECK_EQUAL(stats.evictions, 1U);
+
+    inputCache.Clear(view);
+    BOOST_CHECK(!inputCache.Fetch(view, first));
+    BOOST_CHECK(!inputCache.Fetch(view, third));
+    BOOST_CHECK_EQUAL(view.GetCacheSize(), 0U);
+    BOOST_CHECK_EQUAL(inputCache.GetStats().size, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(input_cache_more_inputs_than_limit)
+{
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    CInputCacheLRU inputCache(1);
+
+    const COutPoint first(uint256S("01"), 0);
+    const COutPoint second(uint256S("02"), 0);
+    const COutPoint third(uint256S("03"), 1);
+
+    // all inputs of a transaction stay in the view, even above the limit
+    inputCache.Reserve(view, 3);
+    inputCache.Add(view, first, MakeCoin(100));
+    inputCache.Add(view, second, MakeCoin(200));
+    inputCache.Add(view, third, MakeCoin(300));
+    BOOST_CHECK(inputCache.Fetch(view, first));
+    BOOST_CHECK(inputCache.Fetch(view, second));
+    BOOST_CHECK(inputCache.Fetch(view, third));
+    BOOST_CHECK_EQUAL(view.GetCacheSize(), 3U);
+
+    // the next transaction evicts them
+    inputCache.Reserve(view, 1);
+    BOOST_CHECK_EQUAL(view.GetCacheSize(), 0U);
+    BOOST_CHECK_EQUAL(inputCache.GetStats().evictions, 3U);
+
+    // without any limit, the inputs of the current transaction are still kept
+    CInputCacheLRU noCache(0);
+    noCache.Reserve(view, 2);
+    noCache.Add(view, first, MakeCoin(100));
+    noCache.Add(view, second, MakeCoin(200));
+    BOOST_CHECK(noCache.Fetch(view, first));
+    BOOST_CHECK(noCache.Fetch(view, second));
+    noCache.Reserve(view, 1);
+    BOOST_CHECK_EQUAL(view.GetCacheSize(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
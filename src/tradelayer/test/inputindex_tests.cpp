@@ -0,0 +1,37 @@
+#include <tradelayer/dbinputs.h>
+
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_inputindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(input_index_roundtrip)
+{
+    CTLInputIndex inputIndex(GetDataDir() / "tl_inputs_test", true);
+
+    COutPoint prevout(uint256S("a1"), 3);
+    Coin coin(CTxOut(5000, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x11) << OP_EQUALVERIFY << OP_CHECKSIG), 250, false);
+
+    Coin found;
+    BOOST_CHECK(!inputIndex.GetCoin(prevout, found));
+    BOOST_CHECK(inputIndex.PutCoin(prevout, coin));
+
+    BOOST_CHECK(inputIndex.GetCoin(prevout, found));
+    BOOST_CHECK_EQUAL(found.out.nValue, 5000);
+    BOOST_CHECK(found.out.scriptPubKey == coin.out.scriptPubKey);
+    BOOST_CHECK_EQUAL(found.nHeight, 250U);
+
+    // other outputs of the same transaction are not affected
+    BOOST_CHECK(!inputIndex.GetCoin(COutPoint(uint256S("a1"), 2), found));
+
+    inputIndex.Clear();
+    BOOST_CHECK(!inputIndex.GetCoin(prevout, found));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+#include <tradelayer/oracleprices.h>
+
+#include <test/test_bitcoin.h>
+
+#include <stdint.h>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_oracleprices_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(oracle_series_twap)
+{
+    COracleSeries series(3);
+    OracleSummary summary;
+    BOOST_CHECK(!series.GetSummary(100, summary));
+
+    series.Add(100, 10, 5);
+    BOOST_CHECK(series.GetSummary(100, summary));
+    BOOST_CHECK_EQUAL(summary.twapHigh, 10);
+    BOOST_CHECK_EQUAL(summary.twapLow, 5);
+
+    series.Add(110, 20, 8);
+    BOOST_CHECK(series.GetSummary(120, summary));
+    BOOST_CHECK_EQUAL(summary.count, 2U);
+    BOOST_CHECK_EQUAL(summary.firstBlock, 100);
+    BOOST_CHECK_EQUAL(summary.last.block, 110);
+    BOOST_CHECK_EQUAL(summary.twapHigh, 15);
+    BOOST_CHECK_EQUAL(summary.twapLow, 6);
+    BOOST_CHECK_EQUAL(summary.maxHigh, 20);
+    BOOST_CHECK_EQUAL(summary.minLow, 5);
+}
+
+BOOST_AUTO_TEST_CASE(oracle_series_bounded)
+{
+    COracleSeries series(3);
+    OracleSummary summary;
+
+    series.Add(100, 10, 5);
+    series.Add(110, 20, 8);
+    series.Add(120, 30, 1);
+    series.Add(130, 40, 2);
+
+    // the oldest update was dropped
+    BOOST_CHECK(series.GetSummary(130, summary));
+    BOOST_CHECK_EQUAL(summary.count, 3U);
+    BOOST_CHECK_EQUAL(summary.firstBlock, 110);
+    BOOST_CHECK_EQUAL(summary.twapHigh, 25);
+    BOOST_CHECK_EQUAL(summary.twapLow, 4);
+    BOOST_CHECK_EQUAL(summary.maxHigh, 40);
+    BOOST_CHECK_EQUAL(summary.minLow, 1);
+
+    std::vector<OracleSample> samples = series.GetLast(2);
+    BOOST_REQUIRE_EQUAL(samples.size(), 2U);
+    BOOST_CHECK_EQUAL(samples[0].block, 130);
+    BOOST_CHECK_EQUAL(samples[1].block, 120);
+    BOOST_CHECK_EQUAL(series.GetLast(10).size(), 3U);
+}
+
+BOOST_AUTO_TEST_CASE(oracle_series_rollback)
+{
+    COracleSeries series(3);
+    OracleSummary summary;
+
+    series.Add(100, 10, 5);
+    series.Add(110, 20, 8);
+    series.Add(120, 30, 1);
+    series.Add(130, 40, 2);
+
+    series.DeleteAboveBlock(125);
+    BOOST_CHECK(series.GetSummary(130, summary));
+    BOOST_CHECK_EQUAL(summary.count, 2U);
+    BOOST_CHECK_EQUAL(summary.last.block, 120);
+    BOOST_CHECK_EQUAL(summary.twapHigh, 25);
+    BOOST_CHECK_EQUAL(summary.maxHigh, 30);
+
+    series.Add(126, 50, 3);
+    BOOST_CHECK(series.GetSummary(126, summary));
+    BOOST_CHECK_EQUAL(summary.count, 3U);
+    BOOST_CHECK_EQUAL(summary.last.high, 50);
+    BOOST_CHECK_EQUAL(summary.twapHigh, 23);
+
+    series.DeleteAboveBlock(0);
+    BOOST_CHECK(series.Empty());
+    series.Add(200, 7, 3);
+    BOOST_CHECK(series.GetSummary(250, summary));
+    BOOST_CHECK_EQUAL(summary.twapHigh, 7);
+}
+
+BOOST_AUTO_TEST_CASE(oracle_samples_by_contract)
+{
+    ClearOracleSamples();
+    BOOST_CHECK(GetOracleSeries(5) == nullptr);
+
+    AddOracleSample(5, 100, 10, 5);
+    AddOracleSample(5, 101, 11, 6);
+    AddOracleSample(6, 101, 20, 10);
+    BOOST_REQUIRE(GetOracleSeries(5) != nullptr);
+    BOOST_CHECK_EQUAL(GetOracleSeries(5)->Size(), 2U);
+    BOOST_CHECK_EQUAL(GetOracleSeries(5)->Last().high, 11);
+
+    DeleteOracleSamplesAboveBlock(101);
+    BOOST_CHECK_EQUAL(GetOracleSeries(5)->Size(), 1U);
+    BOOST_CHECK(GetOracleSeries(6) == nullptr);
+
+    ClearOracleSamples();
+    BOOST_CHECK(GetOracleSeries(5) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(oracle_samples_restore)
+{
+    ClearOracleSamples();
+
+    BOOST_CHECK(RestoreOracleSample(5, 100, 10, 5));
+    BOOST_CHECK(RestoreOracleSample(5, 110, 20, 8));
+    BOOST_CHECK(RestoreOracleSample(6, 90, 30, 15));
+    BOOST_CHECK(!RestoreOracleSample(5, 105, 15, 7));
+    BOOST_CHECK_EQUAL(GetAllOracleSeries().size(), 2U);
+
+    OracleSummary summary;
+    BOOST_REQUIRE(GetOracleSeries(5) != nullptr);
+    BOOST_CHECK(GetOracleSeries(5)->GetSummary(120, summary));
+    BOOST_CHECK_EQUAL(summary.count, 2U);
+    BOOST_CHECK_EQUAL(summary.twapHigh, 15);
+    BOOST_CHECK_EQUAL(summary.twapLow, 6);
+
+    ClearOracleSamples();
+    BOOST_CHECK(GetAllOracleSeries().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
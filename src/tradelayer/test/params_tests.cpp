@@ -89,5 +89,19 @@ BOOST_AUTO_TEST_CASE(update_feature)
     BOOST_CHECK_EQUAL(oldActivationBlock, ConsensusParams().MSC_BET_BLOCK);
 }
 
+BOOST_AUTO_TEST_CASE(wildcard_restrictions)
+{
+    const CConsensusParams& params = ConsensusParams();
+
+    // only some transactions may use 0 (= BTC) as property identifier
+    BOOST_CHECK(IsTransactionTypeAllowed(params.MSC_SEND_BLOCK, TL_PROPERTY_MSC, MSC_TYPE_SIMPLE_SEND, MP_TX_PKT_V0));
+    BOOST_CHECK(!IsTransactionTypeAllowed(params.MSC_SEND_BLOCK, TL_PROPERTY_BTC, MSC_TYPE_SIMPLE_SEND, MP_TX_PKT_V0));
+    BOOST_CHECK(IsTransactionTypeAllowed(params.MSC_ALERT_BLOCK, TL_PROPERTY_BTC, TRADELAYER_MESSAGE_TYPE_ALERT, 0xFFFF));
+
+    // unknown versions are never allowed
+    BOOST_CHECK(!IsTransactionTypeAllowed(params.MSC_SEND_BLOCK, TL_PROPERTY_MSC, MSC_TYPE_SIMPLE_SEND, 7));
+    BOOST_CHECK(!IsTransactionTypeAllowed(params.MSC_SEND_BLOCK, TL_PROPERTY_TMSC, MSC_TYPE_SIMPLE_SEND, 7));
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
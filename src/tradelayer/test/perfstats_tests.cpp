@@ -0,0 +1,67 @@
+#include <tradelayer/perfstats.h>
+
+#include <test/test_bitcoin.h>
+
+#include <stdint.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_perfstats_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(perf_histogram_buckets)
+{
+    BOOST_CHECK_EQUAL(CPerfHistogram::BucketIndex(0), 0);
+    BOOST_CHECK_EQUAL(CPerfHistogram::BucketIndex(1), 1);
+    BOOST_CHECK_EQUAL(CPerfHistogram::BucketIndex(2), 2);
+    BOOST_CHECK_EQUAL(CPerfHistogram::BucketIndex(3), 2);
+    BOOST_CHECK_EQUAL(CPerfHistogram::BucketIndex(4), 3);
+    BOOST_CHECK_EQUAL(CPerfHistogram::BucketIndex(1000), 10);
+    BOOST_CHECK_EQUAL(CPerfHistogram::BucketIndex(UINT64_MAX), PERF_HISTOGRAM_BUCKETS - 1);
+
+    for (uint64_t micros = 1; micros < 100000; micros += 37) {
+        int index = CPerfHistogram::BucketIndex(micros);
+        BOOST_CHECK(micros < CPerfHistogram::BucketUpperBound(index));
+        BOOST_CHECK(micros >= CPerfHistogram::BucketUpperBound(index - 1));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(perf_histogram_stats)
+{
+    CPerfHistogram histogram;
+    for (int i = 0; i < 90; ++i) histogram.Add(10);
+    for (int i = 0; i < 9; ++i) histogram.Add(1000);
+    histogram.Add(5000000);
+
+    PerfStageStats stats = histogram.GetStats();
+    BOOST_CHECK_EQUAL(stats.count, 100U);
+    BOOST_CHECK_EQUAL(stats.totalMicros, 900U + 9000U + 5000000U);
+    BOOST_CHECK_EQUAL(stats.maxMicros, 5000000U);
+    BOOST_CHECK_EQUAL(stats.buckets[CPerfHistogram::BucketIndex(10)], 90U);
+    BOOST_CHECK_EQUAL(stats.Percentile(50), 16U);
+    BOOST_CHECK_EQUAL(stats.Percentile(90), 1024U);
+    BOOST_CHECK_EQUAL(stats.Percentile(99), 8388608U);
+
+    histogram.Reset();
+    stats = histogram.GetStats();
+    BOOST_CHECK_EQUAL(stats.count, 0U);
+    BOOST_CHECK_EQUAL(stats.maxMicros, 0U);
+    BOOST_CHECK_EQUAL(stats.Percentile(50), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(perf_timer_records_stage)
+{
+    ResetPerfStats();
+    {
+        CPerfTimer timer(PERF_BLOCK_END);
+    }
+    std::vector<PerfStageStats> vStats = GetPerfStats();
+    BOOST_CHECK_EQUAL(vStats.size(), (size_t) PERF_STAGE_COUNT);
+    BOOST_CHECK_EQUAL(vStats[PERF_BLOCK_END].name, "handler_block_end");
+    BOOST_CHECK_EQUAL(vStats[PERF_BLOCK_END].count, 1U);
+    BOOST_CHECK_EQUAL(vStats[PERF_BLOCK_BEGIN].count, 0U);
+    ResetPerfStats();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
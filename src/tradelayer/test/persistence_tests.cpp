@@ -0,0 +1,162 @@
+#include <tradelayer/persistence.h>
+#include <tradelayer/sp.h>
+#include <tradelayer/tally.h>
+#include <tradelayer/tradelayer.h>
+
+#include <chain.h>
+#include <fs.h>
+#include <sync.h>
+#include <test/test_bitcoin.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+extern fs::path pathStateFiles;
+
+using namespace mastercore;
+
+namespace
+{
+//! The file type of the balances, as used by the state files
+const int FILETYPE_BALANCES = 0;
+
+const std::string ADDRESS_A = "1JFJ5TbeqmYLbwcxwqH3pnETutbZ8ZzuFp";
+const std::string ADDRESS_B = "1LoFy3ac8kuMRrK38qjQCgFrrPQCJVUfbb";
+
+/** Provides a temporary property database, state directory and an empty tally map. */
+struct PersistenceTestingSetup : public BasicTestingSetup
+{
+    CMPSPInfo* pOldSpInfo;
+    fs::path pathOldStateFiles;
+
+    PersistenceTestingSetup() : pOldSpInfo(pDbSpInfo), pathOldStateFiles(pathStateFiles)
+    {
+        pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo_persist", true);
+        pathStateFiles = GetDataDir() / "MP_persist";
+        TryCreateDirectories(pathStateFiles);
+        ClearTally();
+    }
+
+    ~PersistenceTestingSetup()
+    {
+        StopStatePersistence();
+        gArgs.ForceSetArg("-tlstatebaseinterval", "0");
+        ClearTally();
+        delete pDbSpInfo;
+        pDbSpInfo = pOldSpInfo;
+        pathStateFiles = pathOldStateFiles;
+    }
+
+    static void ClearTally()
+    {
+        LOCK(cs_tally);
+        mp_tally_map.clear();
+        mapPropertyHolders.clear();
+    }
+};
+
+std::string BalancesFile(const uint256& blockHash)
+{
+    return (pathStateFiles / strprintf("balances-%s.dat", blockHash.ToString())).string();
+}
+
+std::string FirstLine(const std::string& filename)
+{
+    std::ifstream file(filename.c_str());
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_persistence_tests, PersistenceTestingSetup)
+
+BOOST_AUTO_TEST_CASE(state_delta_roundtrip)
+{
+    gArgs.ForceSetArg("-tlstatebaseinterval", "20");
+
+    const int nBlocks = 80;
+    std::vector<uint256> hashes(nBlocks + 1);
+    std::vector<CBlockIndex> blocks(nBlocks + 1);
+    for (int n = 1; n <= nBlocks; ++n) {
+        hashes[n] = uint256S(strprintf("%064x", n));
+        blocks[n].phashBlock = &hashes[n];
+        blocks[n].nHeight = n;
+        blocks[n].pprev = (n > 1) ? &blocks[n - 1] : nullptr;
+        {
+            LOCK(cs_tally);
+            update_tally_map(ADDRESS_A, 3, 1, BALANCE);
+            if (n == 30) update_tally_map(ADDRESS_B, 5, 7, BALANCE);
+        }
+        BOOST_CHECK_EQUAL(PersistInMemoryState(&blocks[n]), 0);
+    }
+    FlushStatePersistence();
+
+    // full state files every 20 blocks, and deltas in between
+    BOOST_CHECK(!boost::starts_with(FirstLine(BalancesFile(hashes[60])), "#delta"));
+    BOOST_CHECK(!boost::starts_with(FirstLine(BalancesFile(hashes[80])), "#delta"));
+    BOOST_CHECK_EQUAL(FirstLine(BalancesFile(hashes[79])), "#delta " + hashes[78].ToString());
+
+    // the state is restored from the full state file and the chain of deltas
+    BOOST_CHECK_EQUAL(RestoreInMemoryState(BalancesFile(hashes[79]), FILETYPE_BALANCES, true), 0);
+    BOOST_CHECK_EQUAL(GetTokenBalance(ADDRESS_A, 3, BALANCE), 79);
+    BOOST_CHECK_EQUAL(GetTokenBalance(ADDRESS_B, 5, BALANCE), 7);
+
+    BOOST_CHECK_EQUAL(RestoreInMemoryState(BalancesFile(hashes[30]), FILETYPE_BALANCES, true), 0);
+    BOOST_CHECK_EQUAL(GetTokenBalance(ADDRESS_A, 3, BALANCE), 30);
+    BOOST_CHECK_EQUAL(GetTokenBalance(ADDRESS_B, 5, BALANCE), 7);
+
+    BOOST_CHECK_EQUAL(RestoreInMemoryState(BalancesFile(hashes[20]), FILETYPE_BALANCES, true), 0);
+    BOOST_CHECK_EQUAL(GetTokenBalance(ADDRESS_A, 3, BALANCE), 20);
+    BOOST_CHECK_EQUAL(GetTokenBalance(ADDRESS_B, 5, BALANCE), 0);
+
+    // old blocks are pruned, but the files the kept deltas are based on are kept
+    BOOST_CHECK(fs::exists(BalancesFile(hashes[20])));
+    BOOST_CHECK(fs::exists(BalancesFile(hashes[29])));
+    BOOST_CHECK(!fs::exists(BalancesFile(hashes[19])));
+    BOOST_CHECK(!fs::exists(BalancesFile(hashes[1])));
+
+    // a modified delta invalidates all states based on it
+    {
+        std::ofstream file(BalancesFile(hashes[61]).c_str(), std::ios::app);
+        file << "+" << ADDRESS_B << "=5:1,0,0,0;" << std::endl;
+    }
+    BOOST_CHECK_EQUAL(RestoreInMemoryState(BalancesFile(hashes[65]), FILETYPE_BALANCES, true), -1);
+    BOOST_CHECK_EQUAL(RestoreInMemoryState(BalancesFile(hashes[60]), FILETYPE_BALANCES, true), 0);
+    BOOST_CHECK_EQUAL(GetTokenBalance(ADDRESS_A, 3, BALANCE), 60);
+}
+
+BOOST_AUTO_TEST_CASE(state_delta_missing_base)
+{
+    gArgs.ForceSetArg("-tlstatebaseinterval", "10");
+
+    std::vector<uint256> hashes(4);
+    std::vector<CBlockIndex> blocks(4);
+    for (int n = 1; n <= 3; ++n) {
+        hashes[n] = uint256S(strprintf("%064x", 100 + n));
+        blocks[n].phashBlock = &hashes[n];
+        blocks[n].nHeight = n;
+        blocks[n].pprev = (n > 1) ? &blocks[n - 1] : nullptr;
+        {
+            LOCK(cs_tally);
+            update_tally_map(ADDRESS_A, 3, n, BALANCE);
+        }
+        BOOST_CHECK_EQUAL(PersistInMemoryState(&blocks[n]), 0);
+    }
+    FlushStatePersistence();
+
+    BOOST_CHECK_EQUAL(RestoreInMemoryState(BalancesFile(hashes[3]), FILETYPE_BALANCES, true), 0);
+    BOOST_CHECK_EQUAL(GetTokenBalance(ADDRESS_A, 3, BALANCE), 6);
+
+    fs::remove(BalancesFile(hashes[1]));
+    BOOST_CHECK_EQUAL(RestoreInMemoryState(BalancesFile(hashes[3]), FILETYPE_BALANCES, true), -1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
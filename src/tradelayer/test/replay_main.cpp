@@ -0,0 +1,184 @@
+/**
+ * @file replay_main.cpp
+ *
+ * Replays blocks recorded with tl_capturereplay through the Trade Layer block
+ * handlers, without a block chain or network, and reports the throughput, the
+ * time spent in each phase and whether the final consensus hash matches.
+ */
+
+#include <tradelayer/consensushash.h>
+#include <tradelayer/perfstats.h>
+#include <tradelayer/replay.h>
+#include <tradelayer/tally.h>
+#include <tradelayer/tradelayer.h>
+#include <tradelayer/tradelayer_matrices.h>
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <crypto/sha256.h>
+#include <fs.h>
+#include <key.h>
+#include <streams.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <stdint.h>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace mastercore;
+
+const std::function<std::string(const char*)> G_TRANSLATION_FUN = nullptr;
+
+static void SetupReplayArgs()
+{
+    SetupHelpOptions(gArgs);
+
+    gArgs.AddArg("-file=<file>", "Replay the blocks of this file, as written by tl_capturereplay", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-keepdatadir", "Do not remove the temporary data directory with the resulting state (default: false)", false, OptionsCategory::OPTIONS);
+}
+
+static fs::path SetDataDir()
+{
+    fs::path ret = fs::temp_directory_path() / "test_tradelayer_replay" / fs::unique_path();
+    fs::create_directories(ret);
+    gArgs.ForceSetArg("-datadir", ret.string());
+    return ret;
+}
+
+static double PerSecond(int count, int64_t micros)
+{
+    return micros > 0 ? count * 1000000.0 / micros : 0.0;
+}
+
+static void PrintStats(const CReplayStats& stats)
+{
+    tfm::format(std::cout, "Replayed %d blocks with %d transactions, %d of them valid Trade Layer transactions\n",
+            stats.nBlocks, stats.nTransactions, stats.nMetaTransactions);
+    tfm::format(std::cout, "Time in handlers: %.3f s (%.1f blocks/s, %.1f transactions/s)\n",
+            stats.nHandlerMicros / 1000000.0, PerSecond(stats.nBlocks, stats.nHandlerMicros), PerSecond(stats.nTransactions, stats.nHandlerMicros));
+    tfm::format(std::cout, "Time in total: %.3f s\n\n", stats.nTotalMicros / 1000000.0);
+
+    tfm::format(std::cout, "%-28s %10s %14s %10s %10s %10s %10s %12s\n", "stage", "count", "total_us", "avg_us", "p50_us", "p90_us", "p99_us", "max_us");
+    std::vector<PerfStageStats> vStats = GetPerfStats();
+    for (std::vector<PerfStageStats>::const_iterator it = vStats.begin(); it != vStats.end(); ++it) {
+        const PerfStageStats& s = *it;
+        if (s.count == 0) continue;
+        tfm::format(std::cout, "%-28s %10d %14d %10d %10d %10d %10d %12d\n", s.name, s.count, s.totalMicros,
+                s.totalMicros / s.count, s.Percentile(50), s.Percentile(90), s.Percentile(99), s.maxMicros);
+    }
+    tfm::format(std::cout, "\n");
+}
+
+int main(int argc, char** argv)
+{
+    extern int64_t factorE;
+    extern int64_t priceIndex;
+    extern int64_t allPrice;
+    extern double denMargin;
+    extern int n_cols;
+    extern int nVestingAddrs;
+    extern int64_t amountVesting;
+    extern int64_t totalVesting;
+    extern int volumeToVWAP;
+    extern int BlockS;
+    extern VectorTLS *pt_open_incr_long;
+    extern VectorTLS *pt_open_incr_short;
+    extern VectorTLS *pt_netted_npartly_long;
+    extern VectorTLS *pt_netted_npartly_short;
+    extern VectorTLS *pt_open_incr_anypos;
+    extern VectorTLS *pt_netted_npartly_anypos;
+    extern VectorTLS *pt_changepos_status;
+    extern VectorTLS *pt_expiration_dates;
+    extern std::string admin_addrs;
+    extern double CompoundRate;
+    extern double DecayRate;
+    extern double LongTailDecay;
+    extern int64_t SatoshiH;
+
+#include "initial_conditions.h"
+
+    SetupReplayArgs();
+    std::string error;
+    if (!gArgs.ParseParameters(argc, argv, error)) {
+        tfm::format(std::cerr, "Error parsing command line arguments: %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (HelpRequested(gArgs) || !gArgs.IsArgSet("-file")) {
+        std::cout << "Usage: test_tradelayer_replay -file=<file> [options]\n\n" << gArgs.GetHelpMessage();
+        return HelpRequested(gArgs) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    const std::string strFile = gArgs.GetArg("-file", "");
+    CAutoFile file(fsbridge::fopen(strFile, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        tfm::format(std::cerr, "Error: cannot open %s\n", strFile);
+        return EXIT_FAILURE;
+    }
+
+    CReplayHeader header;
+    try {
+        file >> header;
+        SelectParams(header.strNetwork);
+    } catch (const std::exception& e) {
+        tfm::format(std::cerr, "Error: cannot read %s: %s\n", strFile, e.what());
+        return EXIT_FAILURE;
+    }
+    if (header.nVersion != REPLAY_FILE_VERSION) {
+        tfm::format(std::cerr, "Error: unsupported replay file version %d\n", header.nVersion);
+        return EXIT_FAILURE;
+    }
+
+    const fs::path datadir = SetDataDir();
+
+    SHA256AutoDetect();
+    ECC_Start();
+    SetupEnvironment();
+
+    tfm::format(std::cout, "Replaying blocks %d to %d [%s] in %s\n", header.nStartBlock, header.nEndBlock, header.strNetwork, datadir.string());
+
+    mastercore_init();
+    ResetPerfStats();
+
+    int ret = EXIT_SUCCESS;
+    {
+        CBlockReplayer replayer;
+        if (!replayer.ReplayFile(file, header, error)) {
+            tfm::format(std::cerr, "Error: %s\n", error);
+            ret = EXIT_FAILURE;
+        }
+        PrintStats(replayer.GetStats());
+
+        uint256 consensusHash;
+        {
+            LOCK(cs_tally);
+            consensusHash = GetConsensusHash();
+        }
+        tfm::format(std::cout, "Consensus hash: %s\n", consensusHash.GetHex());
+
+        if (header.consensusHash.IsNull()) {
+            tfm::format(std::cout, "Expected:       unknown, not verified\n");
+        } else if (header.consensusHash != consensusHash) {
+            tfm::format(std::cout, "Expected:       %s, MISMATCH\n", header.consensusHash.GetHex());
+            ret = EXIT_FAILURE;
+        } else {
+            tfm::format(std::cout, "Expected:       %s, OK\n", header.consensusHash.GetHex());
+        }
+    }
+
+    mastercore_shutdown();
+
+    if (!gArgs.GetBoolArg("-keepdatadir", false)) {
+        fs::remove_all(datadir);
+    }
+
+    ECC_Stop();
+
+    return ret;
+}
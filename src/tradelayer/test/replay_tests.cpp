@@ -0,0 +1,84 @@
+#include <tradelayer/replay.h>
+
+#include <test/test_bitcoin.h>
+
+#include <amount.h>
+#include <clientversion.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <streams.h>
+#include <uint256.h>
+#include <util/strencodings.h>
+
+#include <stdint.h>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_replay_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(replay_header_roundtrip)
+{
+    CReplayHeader header;
+    header.strNetwork = "regtest";
+    header.nStartBlock = 101;
+    header.nEndBlock = 200;
+    header.consensusHash = uint256S("55b42cc5a8e04f6e3e5a1dc96f7a1ba7eb6d1aebb13a5a0a8e2d2d6d1dd6f45f");
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << header;
+
+    CReplayHeader decoded;
+    ss >> decoded;
+    BOOST_CHECK_EQUAL(decoded.nVersion, REPLAY_FILE_VERSION);
+    BOOST_CHECK_EQUAL(decoded.strNetwork, "regtest");
+    BOOST_CHECK_EQUAL(decoded.nStartBlock, 101);
+    BOOST_CHECK_EQUAL(decoded.nEndBlock, 200);
+    BOOST_CHECK_EQUAL(decoded.GetBlockCount(), 100);
+    BOOST_CHECK(decoded.consensusHash == header.consensusHash);
+    BOOST_CHECK(ss.empty());
+}
+
+BOOST_AUTO_TEST_CASE(replay_block_roundtrip)
+{
+    CMutableTransaction mutableTx;
+    mutableTx.vin.push_back(CTxIn(COutPoint(uint256S("01"), 2)));
+    mutableTx.vout.push_back(CTxOut(0, CScript() << OP_RETURN << ParseHex("6f6d6e6900000000000000070000000006dac2c0")));
+    mutableTx.vout.push_back(CTxOut(6000, CScript() << OP_TRUE));
+    CTransactionRef tx = MakeTransactionRef(mutableTx);
+
+    CReplayBlock block;
+    block.nHeight = 150;
+    block.hash = uint256S("02");
+    block.nTime = 1550000000;
+    block.nTxCount = 3;
+    block.vtx.push_back(std::make_pair(uint32_t(2), tx));
+    block.spentCoins.emplace(tx->vin[0].prevout, Coin(CTxOut(10 * COIN, CScript() << OP_TRUE), 120, false));
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+
+    CReplayBlock decoded;
+    ss >> decoded;
+    BOOST_CHECK_EQUAL(decoded.nHeight, 150);
+    BOOST_CHECK(decoded.hash == block.hash);
+    BOOST_CHECK_EQUAL(decoded.nTime, 1550000000);
+    BOOST_CHECK_EQUAL(decoded.nTxCount, 3U);
+    BOOST_REQUIRE_EQUAL(decoded.vtx.size(), 1U);
+    BOOST_CHECK_EQUAL(decoded.vtx[0].first, 2U);
+    BOOST_CHECK(decoded.vtx[0].second->GetHash() == tx->GetHash());
+    BOOST_REQUIRE_EQUAL(decoded.spentCoins.size(), 1U);
+
+    const Coin& coin = decoded.spentCoins.begin()->second;
+    BOOST_CHECK(decoded.spentCoins.begin()->first == tx->vin[0].prevout);
+    BOOST_CHECK_EQUAL(coin.out.nValue, 10 * COIN);
+    BOOST_CHECK(coin.out.scriptPubKey == (CScript() << OP_TRUE));
+    BOOST_CHECK(coin.nHeight == 120);
+    BOOST_CHECK(ss.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
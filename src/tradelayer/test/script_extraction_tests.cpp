@@ -3,6 +3,7 @@
 #include <base58.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <span.h>
 #include <test/test_bitcoin.h>
 #include <util/strencodings.h>
 
@@ -286,5 +287,44 @@ BOOST_AUTO_TEST_CASE(extract_anypush_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(extract_push_spans_test)
+{
+    std::vector<std::vector<unsigned char> > vvchPayloads;
+    vvchPayloads.push_back(std::vector<unsigned char>());
+    vvchPayloads.push_back(ParseHex("01"));
+    vvchPayloads.push_back(std::vector<unsigned char>(75, 0x11));
+    vvchPayloads.push_back(std::vector<unsigned char>(76, 0x22));
+    vvchPayloads.push_back(std::vector<unsigned char>(300, 0x33));
+    vvchPayloads.push_back(std::vector<unsigned char>(70000, 0x44));
+
+    // Pushes of all sizes: OP_0, direct push, OP_PUSHDATA1, OP_PUSHDATA2 and OP_PUSHDATA4
+    CScript script;
+    script << OP_RETURN;
+    for (size_t n = 0; n < vvchPayloads.size(); ++n) {
+        script << vvchPayloads[n] << OP_DROP;
+    }
+
+    // Confirm extracted data matches the hex-encoded pushes
+    for (bool fSkipFirst : {false, true}) {
+        std::vector<std::string> vstrSolutions;
+        std::vector<Span<const unsigned char> > vSolutions;
+        BOOST_CHECK(GetScriptPushes(script, vstrSolutions, fSkipFirst));
+        BOOST_CHECK(GetScriptPushes(script, vSolutions, fSkipFirst));
+        BOOST_CHECK_EQUAL(vSolutions.size(), vvchPayloads.size() - (fSkipFirst ? 1 : 0));
+        BOOST_CHECK_EQUAL(vSolutions.size(), vstrSolutions.size());
+        for (size_t n = 0; n < vSolutions.size() && n < vstrSolutions.size(); ++n) {
+            BOOST_CHECK_EQUAL(HexStr(vSolutions[n].begin(), vSolutions[n].end()), vstrSolutions[n]);
+        }
+    }
+
+    // Push of five bytes, but only one follows
+    CScript scriptInvalid;
+    scriptInvalid << OP_RETURN;
+    scriptInvalid.push_back(0x05);
+    scriptInvalid.push_back(0x11);
+    std::vector<Span<const unsigned char> > vSolutions;
+    BOOST_CHECK(!GetScriptPushes(scriptInvalid, vSolutions));
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
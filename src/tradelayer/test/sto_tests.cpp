@@ -0,0 +1,131 @@
+#include <tradelayer/dbstolist.h>
+#include <tradelayer/sp.h>
+#include <tradelayer/sto.h>
+#include <tradelayer/tally.h>
+#include <tradelayer/tradelayer.h>
+
+#include <sync.h>
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdint.h>
+#include <string>
+
+using namespace mastercore;
+
+namespace
+{
+/** Provides an empty tally map and a property database for FormatMP. */
+struct STOTestingSetup : public BasicTestingSetup
+{
+    CMPSPInfo* pOldSpInfo;
+
+    STOTestingSetup() : pOldSpInfo(pDbSpInfo)
+    {
+        pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo_sto", true);
+        ClearTallies();
+    }
+
+    ~STOTestingSetup()
+    {
+        ClearTallies();
+        delete pDbSpInfo;
+        pDbSpInfo = pOldSpInfo;
+    }
+
+    static void ClearTallies()
+    {
+        LOCK(cs_tally);
+        mp_tally_map.clear();
+        mapPropertyHolders.clear();
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_sto_tests, STOTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sto_receivers_pro_rata)
+{
+    const uint32_t property = 5;
+    BOOST_CHECK(update_tally_map("sender", property, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map("alice", property, 300, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", property, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", property, 100, SELLOFFER_RESERVE));
+    BOOST_CHECK(update_tally_map("carol", property, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("dave", property, 1, METADEX_RESERVE));
+    BOOST_CHECK(update_tally_map("erin", property + 1, 500, BALANCE));
+
+    // shares are rounded up, until the amount is used up
+    OwnerAddrType receivers = STO_GetReceivers("sender", property, 100);
+    BOOST_REQUIRE_EQUAL(receivers.size(), 3U);
+    BOOST_CHECK_EQUAL(receivers[0].first, 50);
+    BOOST_CHECK_EQUAL(receivers[0].second, "alice");
+    BOOST_CHECK_EQUAL(receivers[1].first, 34);
+    BOOST_CHECK_EQUAL(receivers[1].second, "bob");
+    BOOST_CHECK_EQUAL(receivers[2].first, 16);
+    BOOST_CHECK_EQUAL(receivers[2].second, "carol");
+
+    // no holders
+    BOOST_CHECK(STO_GetReceivers("sender", property + 2, 100).empty());
+}
+
+BOOST_AUTO_TEST_CASE(sto_receivers_order)
+{
+    const uint32_t property = 7;
+    BOOST_CHECK(update_tally_map("z", property, 11, BALANCE));
+    BOOST_CHECK(update_tally_map("y", property, 10, BALANCE));
+    BOOST_CHECK(update_tally_map("w", property, 1, BALANCE));
+
+    // equal amounts are ordered by address, even if the number of tokens differs
+    OwnerAddrType receivers = STO_GetReceivers("sender", property, 10);
+    BOOST_REQUIRE_EQUAL(receivers.size(), 2U);
+    BOOST_CHECK_EQUAL(receivers[0].first, 5);
+    BOOST_CHECK_EQUAL(receivers[0].second, "y");
+    BOOST_CHECK_EQUAL(receivers[1].first, 5);
+    BOOST_CHECK_EQUAL(receivers[1].second, "z");
+
+    // large balances don't overflow
+    BOOST_CHECK(update_tally_map("w", property, 4000000000000000000LL, BALANCE));
+    receivers = STO_GetReceivers("sender", property, 4000000000000000000LL);
+    BOOST_REQUIRE_EQUAL(receivers.size(), 3U);
+    BOOST_CHECK_EQUAL(receivers[0].first, 3999999999999999980LL);
+    BOOST_CHECK_EQUAL(receivers[0].second, "w");
+    BOOST_CHECK_EQUAL(receivers[1].first, 11);
+    BOOST_CHECK_EQUAL(receivers[2].first, 9);
+}
+
+BOOST_AUTO_TEST_CASE(sto_holders_pruned)
+{
+    const uint32_t property = 9;
+    BOOST_CHECK(update_tally_map("alice", property, 10, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", property, 10, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", property, -10, BALANCE));
+    BOOST_CHECK_EQUAL(mapPropertyHolders[property].size(), 2U);
+
+    // holders without tokens are dropped, and added again, once credited
+    BOOST_CHECK_EQUAL(STO_GetReceivers("sender", property, 5).size(), 1U);
+    BOOST_CHECK_EQUAL(mapPropertyHolders[property].count("bob"), 0U);
+
+    BOOST_CHECK(update_tally_map("bob", property, 10, BALANCE));
+    BOOST_CHECK_EQUAL(STO_GetReceivers("sender", property, 5).size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(sto_receipts_batch)
+{
+    CMPSTOList stoList(GetDataDir() / "MP_stolist_test", true);
+
+    OwnerAddrType receivers;
+    receivers.push_back(std::make_pair(50, "alice"));
+    receivers.push_back(std::make_pair(30, "bob"));
+
+    BOOST_CHECK(!stoList.exists("alice"));
+    stoList.recordSTOReceives(uint256S("a1"), 100, 5, receivers);
+    BOOST_CHECK(stoList.exists("alice"));
+    BOOST_CHECK(stoList.exists("bob"));
+    BOOST_CHECK(!stoList.exists("carol"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
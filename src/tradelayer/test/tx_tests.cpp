@@ -0,0 +1,62 @@
+#include <tradelayer/createpayload.h>
+#include <tradelayer/tx.h>
+
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(tradelayer_tx_tests, BasicTestingSetup)
+
+static void SetPayload(CMPTransaction& mp_obj, std::vector<unsigned char>& payload)
+{
+    mp_obj.Set("sender", "", 0, uint256(), 100, 1, payload.data(), payload.size(), 3, 0);
+}
+
+BOOST_AUTO_TEST_CASE(tx_property_strings)
+{
+    std::vector<unsigned char> payload = CreatePayload_IssuanceFixed(1, 1, 0, "Companies", "Bitcoin Mining",
+            "Quantum Miner", "builder.bitwatch.co", "", 1000000);
+
+    CMPTransaction mp_obj;
+    SetPayload(mp_obj, payload);
+    BOOST_CHECK(mp_obj.interpret_Transaction());
+    BOOST_CHECK_EQUAL(mp_obj.getPayloadSize(), static_cast<int>(payload.size()));
+    BOOST_CHECK_EQUAL(mp_obj.getPayload(), HexStr(payload));
+    BOOST_CHECK_EQUAL(mp_obj.getSPCategory(), "Companies");
+    BOOST_CHECK_EQUAL(mp_obj.getSPSubCategory(), "Bitcoin Mining");
+    BOOST_CHECK_EQUAL(mp_obj.getSPName(), "Quantum Miner");
+    BOOST_CHECK_EQUAL(mp_obj.getSPUrl(), "builder.bitwatch.co");
+    BOOST_CHECK_EQUAL(mp_obj.getSPData(), "");
+    BOOST_CHECK_EQUAL(mp_obj.getAmount(), 1000000U);
+
+    // the fields are cleared for the next transaction
+    mp_obj.SetNull();
+    BOOST_CHECK_EQUAL(mp_obj.getSPName(), "");
+    BOOST_CHECK_EQUAL(mp_obj.getPayloadSize(), 0);
+    BOOST_CHECK_EQUAL(mp_obj.getPayload(), "");
+}
+
+BOOST_AUTO_TEST_CASE(tx_truncated_payload)
+{
+    std::vector<unsigned char> payload = CreatePayload_IssuanceFixed(1, 1, 0, "Companies", "Bitcoin Mining",
+            "Quantum Miner", "builder.bitwatch.co", "", 1000000);
+
+    // the strings and the amount are cut off, and read as zeros past the payload
+    payload.resize(25);
+
+    CMPTransaction mp_obj;
+    SetPayload(mp_obj, payload);
+    BOOST_CHECK(!mp_obj.interpret_Transaction());
+    BOOST_CHECK_EQUAL(mp_obj.getPayloadSize(), 25);
+    BOOST_CHECK_EQUAL(mp_obj.getSPCategory(), "Companies");
+    BOOST_CHECK_EQUAL(mp_obj.getSPSubCategory(), "Bitc");
+    BOOST_CHECK_EQUAL(mp_obj.getSPName(), "");
+    BOOST_CHECK_EQUAL(mp_obj.getAmount(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,21 +7,28 @@
 #include <tradelayer/tradelayer.h>
 
 #include <tradelayer/activation.h>
+#include <tradelayer/blockcontext.h>
+#include <tradelayer/blockevents.h>
 #include <tradelayer/consensushash.h>
 #include <tradelayer/convert.h>
 #include <tradelayer/dbbase.h>
+#include <tradelayer/dbblockfilter.h>
 #include <tradelayer/dbfees.h>
+#include <tradelayer/dbinputs.h>
 #include <tradelayer/dbspinfo.h>
 #include <tradelayer/dbstolist.h>
 #include <tradelayer/dbtradelist.h>
 #include <tradelayer/dbtransaction.h>
 #include <tradelayer/dbtxlist.h>
 #include <tradelayer/dex.h>
+#include <tradelayer/inputcache.h>
 #include <tradelayer/log.h>
 #include <tradelayer/mdex.h>
 #include <tradelayer/notifications.h>
+#include <tradelayer/oracleprices.h>
 #include <tradelayer/parsing.h>
 #include <tradelayer/pending.h>
+#include <tradelayer/perfstats.h>
 #include <tradelayer/persistence.h>
 #include <tradelayer/rules.h>
 #include <tradelayer/script.h>
@@ -33,6 +40,7 @@
 #include <tradelayer/utilsui.h>
 #include <tradelayer/version.h>
 #include <tradelayer/walletcache.h>
+#include <tradelayer/walletfetchtxs.h>
 #include <tradelayer/walletutils.h>
 #include <tradelayer/operators_algo_clearing.h>
 #include <tradelayer/uint256_extensions.h>
@@ -51,6 +59,7 @@
 #include <script/script.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <span.h>
 #include <sync.h>
 #include <tinyformat.h>
 #include <uint256.h>
@@ -75,9 +84,12 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <deque>
+#include <map>
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <cmath>
 #include <iostream>
@@ -160,6 +172,13 @@ static int reorgRecoveryMode = 0;
 //! Block height to recover from after a block reorganization
 static int reorgRecoveryMaxHeight = 0;
 
+//! Data of the block, which is currently processed
+static CBlockContext blockContext;
+//! Number of transactions of the current block, which were processed
+static unsigned int nBlockTxsProcessed = 0;
+//! Flag to indicate whether the current block has Trade Layer transactions
+static bool fBlockHasTLTx = false;
+
 //! LevelDB based storage for currencies, smart properties and tokens
 CMPSPInfo* mastercore::pDbSpInfo;
 //! LevelDB based storage for transactions, with txid as key and validity bit, and other data as value
@@ -172,6 +191,10 @@ CMPTradeList* mastercore::pDbTradeList;
 CMPSTOList* mastercore::pDbStoList;
 //! LevelDB based storage for storing Trade Layer transaction validation and position in block data
 CTLTransactionDB* mastercore::pDbTransaction;
+//! LevelDB based storage for the inputs of Trade Layer transactions
+CTLInputIndex* mastercore::pDbInputIndex;
+//! LevelDB based storage of the blocks with Trade Layer transactions
+CTLBlockFilter* mastercore::pDbBlockFilter;
 //! LevelDB based storage for the MetaDEx fee cache
 CTLFeeCache* mastercore::pDbFeeCache;
 //! LevelDB based storage for the MetaDEx fee distributions
@@ -189,6 +212,8 @@ std::set<std::pair<std::string,uint32_t> > setFrozenAddresses;
 
 //! In-memory collection of all amounts for all addresses for all properties
 std::unordered_map<std::string, CMPTally> mastercore::mp_tally_map;
+//! Addresses, which were credited with tokens, indexed by property
+std::unordered_map<uint32_t, std::unordered_set<std::string> > mastercore::mapPropertyHolders;
 
 // Only needed for GUI:
 
@@ -580,6 +605,8 @@ bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, i
 
     CMPTally& tally = my_it->second;
     bRet = tally.updateMoney(propertyId, amount, ttype);
+    if (bRet) WalletCacheMarkDirty(who);
+    if (bRet && amount > 0) mapPropertyHolders[propertyId].insert(who);
 
     after = GetTokenBalance(who, propertyId, ttype);
     if (!bRet) {
@@ -677,6 +704,26 @@ static std::set<uint256> setMarkerCache;
 //! Guards marker cache
 static CCriticalSection cs_marker_cache;
 
+/** Result of parsing a transaction of the marker cache, before it is confirmed. */
+struct CParsedTx
+{
+    int nBlock; // the block height, the transaction was parsed for
+    std::vector<int> activations; // the activation heights of the parsing rules, when it was parsed
+    int tlClass;
+    std::string sender;
+    std::string reference;
+    std::vector<unsigned char> payload;
+    uint64_t fee;
+};
+
+//! Parsed transactions of the marker cache, reused when the transaction is connected
+static std::map<uint256, CParsedTx> mapParsedTxCache;
+
+//! Order in which transactions were added to the parsed transaction cache
+static std::deque<uint256> dequeParsedTxCache;
+
+static void AddToParsedTxCache(const CTransaction& tx);
+
 /**
  * Checks, if transaction has any Trade Layer marker.
  *
@@ -720,8 +767,11 @@ static bool HasMarkerUnsafe(const CTransactionRef& tx)
 void TryToAddToMarkerCache(const CTransactionRef &tx)
 {
     if (HasMarkerUnsafe(tx)) {
-        LOCK(cs_marker_cache);
-        setMarkerCache.insert(tx->GetHash());
+        {
+            LOCK(cs_marker_cache);
+            setMarkerCache.insert(tx->GetHash());
+        }
+        AddToParsedTxCache(*tx);
     }
 }
 
@@ -730,6 +780,7 @@ void RemoveFromMarkerCache(const uint256& txHash)
 {
     LOCK(cs_marker_cache);
     setMarkerCache.erase(txHash);
+    mapParsedTxCache.erase(txHash);
 }
 
 /** Checks, if transaction is in marker cache. */
@@ -781,7 +832,7 @@ int mastercore::GetEncodingClass(const CTransaction& tx, int nBlock)
     for (unsigned int n = 0; n < tx.vout.size(); ++n) {
         const CTxOut& output = tx.vout[n];
         std::string strSPB = HexStr(output.scriptPubKey.begin(), output.scriptPubKey.end());
-        if (nBlock < 395000) { // class C not enabled yet, no need to search for marker bytes
+        if (nBlock < CLASS_C_BLOCK) { // class C not enabled yet, no need to search for marker bytes
             continue;
         } else if (strSPB.find(strClassC) != std::string::npos) {
             examineClosely = true;
@@ -810,17 +861,17 @@ int mastercore::GetEncodingClass(const CTransaction& tx, int nBlock)
         if (outType == TX_NULL_DATA) {
             // Ensure there is a payload, and the first pushed element equals,
             // or starts with the "tl" marker
-            std::vector<std::string> scriptPushes;
+            std::vector<Span<const unsigned char> > scriptPushes;
             if (!GetScriptPushes(output.scriptPubKey, scriptPushes)) {
                 continue;
             }
             if (!scriptPushes.empty()) {
                 std::vector<unsigned char> vchMarker = GetTLMarker();
-                std::vector<unsigned char> vchPushed = ParseHex(scriptPushes[0]);
-                if (vchPushed.size() < vchMarker.size()) {
+                const Span<const unsigned char>& pushed = scriptPushes[0];
+                if (pushed.size() < static_cast<std::ptrdiff_t>(vchMarker.size())) {
                     continue;
                 }
-                if (std::equal(vchMarker.begin(), vchMarker.end(), vchPushed.begin())) {
+                if (std::equal(vchMarker.begin(), vchMarker.end(), pushed.begin())) {
                     hasOpReturn = true;
                 }
             }
@@ -842,12 +893,55 @@ CCoinsViewCache mastercore::view(&viewDummy);
 //! Guards coins view cache
 CCriticalSection mastercore::cs_tx_cache;
 
-static unsigned int nCacheHits = 0;
-static unsigned int nCacheMiss = 0;
+//! Whether the coins view cache is replaced by a temporary one, whose inputs aren't tracked
+static bool fTempInputView GUARDED_BY(cs_tx_cache) = false;
+
+CTempInputView::CTempInputView(CCoinsViewCache& viewIn) : viewTemp(viewIn)
+{
+    AssertLockHeld(cs_tx_cache);
+    std::swap(view, viewTemp);
+    fTempInputView = true;
+}
+
+CTempInputView::~CTempInputView()
+{
+    std::swap(viewTemp, view);
+    fTempInputView = false;
+}
+
+/** Returns the usage order of the transaction inputs in the coins view cache. */
+static CInputCacheLRU& GetInputCache()
+{
+    static CInputCacheLRU inputCache(gArgs.GetArg("-tltxcache", 500000));
+    return inputCache;
+}
+
+InputCacheStats mastercore::GetInputCacheStats()
+{
+    LOCK(cs_tx_cache);
+    return GetInputCache().GetStats();
+}
+
+/** Removes the cached transaction inputs, the coins of rolled back blocks may be cached with their old heights. */
+static void ClearTxInputCache()
+{
+    LOCK(cs_tx_cache);
+    GetInputCache().Clear(view);
+}
 
 /**
  * Fetches transaction inputs and adds them to the coins view cache.
  *
+ * The cache holds at most -tltxcache inputs, the least recently used ones are
+ * evicted first. The inputs of the transaction are never evicted, while it is
+ * filled, so the limit may be exceeded by the inputs of one transaction. The
+ * inputs of a temporary coins view aren't tracked.
+ *
+ * Inputs, which were resolved before, are taken from the input index, and
+ * otherwise added to it, so the previous transactions are only read once.
+ * Outputs of unconfirmed transactions aren't added to the index, because
+ * their height is not known yet.
+ *
  * Note: cs_tx_cache should be locked, when adding and accessing inputs!
  *
  * @param tx[in]  The transaction to fetch inputs for
@@ -855,34 +949,34 @@ static unsigned int nCacheMiss = 0;
  */
 static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins)
 {
-    static unsigned int nCacheSize = gArgs.GetArg("-tltxcache", 500000);
-
-    if (view.GetCacheSize() > nCacheSize) {
-        PrintToLog("%s(): clearing cache before insertion [size=%d, hit=%d, miss=%d]\n",
-                __func__, view.GetCacheSize(), nCacheHits, nCacheMiss);
-        view.Flush();
-    }
+    CInputCacheLRU& inputCache = GetInputCache();
+    const bool fTrack = !fTempInputView;
+    if (fTrack) inputCache.Reserve(view, tx.vin.size());
 
     for (std::vector<CTxIn>::const_iterator it = tx.vin.begin(); it != tx.vin.end(); ++it) {
         const CTxIn& txIn = *it;
         unsigned int nOut = txIn.prevout.n;
-        const Coin& coin = view.AccessCoin(txIn.prevout);
 
-        if (!coin.IsSpent()) {
-            ++nCacheHits;
+        if (fTrack ? inputCache.Fetch(view, txIn.prevout) : !view.AccessCoin(txIn.prevout).IsSpent()) {
+            continue;
+        }
+
+        Coin newcoin;
+        if (pDbInputIndex && pDbInputIndex->GetCoin(txIn.prevout, newcoin)) {
+            if (fTrack) inputCache.Add(view, txIn.prevout, std::move(newcoin));
+            else view.AddCoin(txIn.prevout, std::move(newcoin), false);
             continue;
-        } else {
-            ++nCacheMiss;
         }
 
         CTransactionRef txPrev;
         uint256 hashBlock;
-        Coin newcoin;
+        bool fKnownHeight = true;
         if (GetTransaction(txIn.prevout.hash, txPrev, Params().GetConsensus(), hashBlock)) {
             newcoin.out.scriptPubKey = txPrev->vout[nOut].scriptPubKey;
             newcoin.out.nValue = txPrev->vout[nOut].nValue;
-            BlockMap::iterator bit = mapBlockIndex.find(hashBlock);
-            newcoin.nHeight = bit != mapBlockIndex.end() ? bit->second->nHeight : 1;
+            BlockMap::iterator bit = hashBlock.IsNull() ? mapBlockIndex.end() : mapBlockIndex.find(hashBlock);
+            fKnownHeight = bit != mapBlockIndex.end();
+            newcoin.nHeight = fKnownHeight ? bit->second->nHeight : 1;
         } else if (removedCoins) {
             std::map<COutPoint, Coin>::const_iterator coinIt = removedCoins->find(txIn.prevout);
             if (coinIt != removedCoins->end()) {
@@ -894,12 +988,70 @@ static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::
             return false;
         }
 
-        view.AddCoin(txIn.prevout, std::move(newcoin), true);
+        // outputs of unconfirmed transactions are stored, once their height is known
+        if (pDbInputIndex && fKnownHeight) pDbInputIndex->PutCoin(txIn.prevout, newcoin);
+        if (fTrack) inputCache.Add(view, txIn.prevout, std::move(newcoin));
+        else view.AddCoin(txIn.prevout, std::move(newcoin), false);
+    }
+
+    return true;
+}
+
+/**
+ * Returns the activation heights of the parsing rules.
+ *
+ * The parser depends on the block height only via the activation of input and
+ * output types, and the activation of class C, see GetEncodingClass().
+ */
+static std::vector<int> GetParsingActivations()
+{
+    const CConsensusParams& params = ConsensusParams();
+    return {params.PUBKEYHASH_BLOCK, params.SCRIPTHASH_BLOCK, params.MULTISIG_BLOCK, params.NULLDATA_BLOCK, CLASS_C_BLOCK};
+}
+
+/**
+ * Checks, if a cached transaction is parsed the same way in the given block.
+ *
+ * The activation heights can be changed by feature activations and deactivations,
+ * after the transaction was parsed, in which case the result is not reused.
+ */
+static bool HaveSameParsingRules(const CParsedTx& parsed, int nBlock)
+{
+    const std::vector<int> activations = GetParsingActivations();
+    if (activations != parsed.activations) {
+        return false;
+    }
+
+    for (const int activation : activations) {
+        if ((parsed.nBlock >= activation) != (nBlock >= activation)) {
+            return false;
+        }
     }
 
     return true;
 }
 
+/**
+ * Takes the parsing result of a transaction out of the parsed transaction cache.
+ *
+ * @return True, if the transaction was parsed for a block with the same parsing rules
+ */
+static bool TakeFromParsedTxCache(const uint256& txid, int nBlock, CParsedTx& parsed)
+{
+    LOCK(cs_marker_cache);
+    std::map<uint256, CParsedTx>::iterator it = mapParsedTxCache.find(txid);
+    if (it == mapParsedTxCache.end()) {
+        return false;
+    }
+    bool fSameRules = HaveSameParsingRules(it->second, nBlock);
+    if (fSameRules) {
+        parsed = std::move(it->second);
+    }
+    mapParsedTxCache.erase(it);
+
+    return fSameRules;
+}
+
 // idx is position within the block, 0-based
 // int msc_tx_push(const CTransaction &wtx, int nBlock, unsigned int idx)
 // INPUT: bRPConly -- set to true to avoid moving funds; to be called from various RPC calls like this
@@ -908,11 +1060,16 @@ static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::
 // RETURNS: >0 if 1 or more payments have been made
 static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock, unsigned int idx, CMPTransaction& mp_tx, unsigned int nTime, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins = nullptr)
 {
+    CPerfTimer perfTimer(PERF_PARSE_TRANSACTION);
     assert(bRPConly == mp_tx.isRpcOnly());
     mp_tx.Set(wtx.GetHash(), nBlock, idx, nTime);
 
+    // transactions, which were already parsed when entering the mempool, don't need to be parsed again
+    CParsedTx parsed;
+    const bool fParsed = !bRPConly && TakeFromParsedTxCache(wtx.GetHash(), nBlock, parsed);
+
     // ### CLASS IDENTIFICATION AND MARKER CHECK ###
-    int tlClass = GetEncodingClass(wtx, nBlock);
+    int tlClass = fParsed ? parsed.tlClass : GetEncodingClass(wtx, nBlock);
 
     if (tlClass == NO_MARKER) {
         return -1; // Not a valid tradelayer transaction
@@ -923,6 +1080,12 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         PrintToLog("%s(block=%d, %s idx= %d); txid: %s\n", __FUNCTION__, nBlock, FormatISO8601DateTime(nTime), idx, wtx.GetHash().GetHex());
     }
 
+    if (fParsed) {
+        if (msc_debug_verbose) PrintToLog("The Sender: %s : fee= %s (parsed in mempool)\n", parsed.sender, FormatDivisibleMP(parsed.fee));
+        mp_tx.Set(parsed.sender, parsed.reference, 0, wtx.GetHash(), nBlock, idx, parsed.payload.data(), parsed.payload.size(), tlClass, parsed.fee);
+        return 0;
+    }
+
     // ### SENDER IDENTIFICATION ###
     std::string strSender;
     int64_t inAll = 0;
@@ -981,7 +1144,6 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
     std::string strReference;
     unsigned char single_pkt[MAX_PACKETS * PACKET_SIZE];
     unsigned int packet_size = 0;
-    std::vector<std::string> script_data;
     std::vector<std::string> address_data;
     std::vector<int64_t> value_data;
 
@@ -995,14 +1157,13 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         }
         CTxDestination dest;
         if (ExtractDestination(wtx.vout[n].scriptPubKey, dest)) {
-                // saving for Class A processing or reference
-                GetScriptPushes(wtx.vout[n].scriptPubKey, script_data);
+                // saving for reference
                 address_data.push_back(EncodeDestination(dest));
                 value_data.push_back(wtx.vout[n].nValue);
                 if (msc_debug_parser_data) PrintToLog("saving address_data #%d: %s:%s\n", n, EncodeDestination(dest), ScriptToAsmStr(wtx.vout[n].scriptPubKey));
         }
     }
-    if (msc_debug_parser_data) PrintToLog(" address_data.size=%lu\n script_data.size=%lu\n value_data.size=%lu\n", address_data.size(), script_data.size(), value_data.size());
+    if (msc_debug_parser_data) PrintToLog(" address_data.size=%lu\n value_data.size=%lu\n", address_data.size(), value_data.size());
 
     // ### CLASS B / CLASS C PARSING ###
     if (tlClass == TL_CLASS_C) {
@@ -1012,7 +1173,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         unsigned int potentialReferenceOutputs = 0; // int to hold number of potential reference outputs
         for (unsigned k = 0; k < address_data.size(); ++k) { // how many potential reference outputs do we have, if just one select it right here
             const std::string& addr = address_data[k];
-            if (msc_debug_parser_data) PrintToLog("ref? data[%d]:%s: %s (%s)\n", k, script_data[k], addr, FormatIndivisibleMP(value_data[k]));
+            if (msc_debug_parser_data) PrintToLog("ref? data[%d]: %s (%s)\n", k, addr, FormatIndivisibleMP(value_data[k]));
                 ++potentialReferenceOutputs;
                 if (1 == potentialReferenceOutputs) {
                     strReference = addr;
@@ -1043,7 +1204,8 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
 
         if (msc_debug_parser_data) PrintToLog("Ending reference identification\nFinal decision on reference identification is: %s\n", strReference);
 
-        std::vector<std::string> op_return_script_data;
+        // the pushed data, pointing into the scripts of the transaction
+        std::vector<Span<const unsigned char> > op_return_script_data;
 
         // ### POPULATE OP RETURN SCRIPT DATA ###
         for (unsigned int n = 0; n < wtx.vout.size(); ++n) {
@@ -1056,26 +1218,24 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             }
             if (whichType == TX_NULL_DATA) {
                 // only consider outputs, which are explicitly tagged
-                std::vector<std::string> vstrPushes;
-                if (!GetScriptPushes(wtx.vout[n].scriptPubKey, vstrPushes)) {
+                std::vector<Span<const unsigned char> > vPushes;
+                if (!GetScriptPushes(wtx.vout[n].scriptPubKey, vPushes)) {
                     continue;
                 }
                 // TODO: maybe encapsulate the following sort of messy code
-                if (!vstrPushes.empty()) {
+                if (!vPushes.empty()) {
                     std::vector<unsigned char> vchMarker = GetTLMarker();
-                    std::vector<unsigned char> vchPushed = ParseHex(vstrPushes[0]);
-                    if (vchPushed.size() < vchMarker.size()) {
+                    if (vPushes[0].size() < static_cast<std::ptrdiff_t>(vchMarker.size())) {
                         continue;
                     }
-                    if (std::equal(vchMarker.begin(), vchMarker.end(), vchPushed.begin())) {
-                        size_t sizeHex = vchMarker.size() * 2;
+                    if (std::equal(vchMarker.begin(), vchMarker.end(), vPushes[0].begin())) {
                         // strip out the marker at the very beginning
-                        vstrPushes[0] = vstrPushes[0].substr(sizeHex);
+                        vPushes[0] = vPushes[0].subspan(vchMarker.size());
                         // add the data to the rest
-                        op_return_script_data.insert(op_return_script_data.end(), vstrPushes.begin(), vstrPushes.end());
+                        op_return_script_data.insert(op_return_script_data.end(), vPushes.begin(), vPushes.end());
 
                         if (msc_debug_parser_data) {
-                            PrintToLog("Class C transaction detected: %s parsed to %s at vout %d\n", wtx.GetHash().GetHex(), vstrPushes[0], n);
+                            PrintToLog("Class C transaction detected: %s parsed to %s at vout %d\n", wtx.GetHash().GetHex(), HexStr(vPushes[0].begin(), vPushes[0].end()), n);
                         }
                     }
                 }
@@ -1083,16 +1243,15 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         }
         // ### EXTRACT PAYLOAD FOR CLASS C ###
         for (unsigned int n = 0; n < op_return_script_data.size(); ++n) {
-            if (!op_return_script_data[n].empty()) {
-                assert(IsHex(op_return_script_data[n])); // via GetScriptPushes()
-                std::vector<unsigned char> vch = ParseHex(op_return_script_data[n]);
+            if (op_return_script_data[n].size() > 0) {
+                const Span<const unsigned char>& vch = op_return_script_data[n];
                 unsigned int payload_size = vch.size();
                 if (packet_size + payload_size > MAX_PACKETS * PACKET_SIZE) {
                     payload_size = MAX_PACKETS * PACKET_SIZE - packet_size;
                     PrintToLog("limiting payload size to %d byte\n", packet_size + payload_size);
                 }
                 if (payload_size > 0) {
-                    memcpy(single_pkt+packet_size, &vch[0], payload_size);
+                    memcpy(single_pkt+packet_size, vch.data(), payload_size);
                     packet_size += payload_size;
                 }
                 if (MAX_PACKETS * PACKET_SIZE == packet_size) {
@@ -1109,6 +1268,84 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
     return 0;
 }
 
+/**
+ * Checks, if all inputs of a transaction are in the coins view cache or the
+ * input index, so they can be resolved without reading previous transactions.
+ *
+ * Note: cs_tx_cache should be locked!
+ */
+static bool HaveResolvedInputs(const CTransaction& tx)
+{
+    AssertLockHeld(cs_tx_cache);
+
+    for (const CTxIn& txIn : tx.vin) {
+        if (!view.AccessCoin(txIn.prevout).IsSpent()) {
+            continue;
+        }
+        Coin coin;
+        if (!pDbInputIndex || !pDbInputIndex->GetCoin(txIn.prevout, coin)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Parses a transaction, which enters the mempool, and keeps the result until
+ * the transaction is connected.
+ *
+ * The transaction is only parsed, if its inputs were resolved before, so no
+ * previous transactions are read from disk, when entering the mempool. Other
+ * transactions are parsed, when they are connected.
+ *
+ * The cache holds at most -tlparsedtxcache transactions, the oldest ones are
+ * dropped first.
+ */
+static void AddToParsedTxCache(const CTransaction& tx)
+{
+    static size_t nCacheSize = gArgs.GetArg("-tlparsedtxcache", 10000);
+
+    const int nBlock = GetHeight() + 1;
+    if (GetEncodingClass(tx, nBlock) == NO_MARKER) {
+        return;
+    }
+
+    CMPTransaction mp_tx;
+    {
+        // the inputs must not be evicted, before the transaction is parsed
+        LOCK2(cs_main, cs_tx_cache);
+        if (!HaveResolvedInputs(tx)) {
+            return;
+        }
+        if (parseTransaction(true, tx, nBlock, 0, mp_tx, 0) != 0) {
+            return;
+        }
+    }
+    // transactions without payload are invalid anyway
+    if (mp_tx.getPayloadSize() == 0) {
+        return;
+    }
+
+    CParsedTx parsed;
+    parsed.nBlock = nBlock;
+    parsed.activations = GetParsingActivations();
+    parsed.tlClass = mp_tx.getEncodingClass();
+    parsed.sender = mp_tx.getSender();
+    parsed.reference = mp_tx.getReceiver();
+    parsed.payload = mp_tx.getPayloadBytes();
+    parsed.fee = mp_tx.getFeePaid();
+
+    LOCK(cs_marker_cache);
+    mapParsedTxCache[tx.GetHash()] = std::move(parsed);
+    dequeParsedTxCache.push_back(tx.GetHash());
+
+    while (dequeParsedTxCache.size() > nCacheSize) {
+        mapParsedTxCache.erase(dequeParsedTxCache.front());
+        dequeParsedTxCache.pop_front();
+    }
+}
+
 /**
  * Provides access to parseTransaction in read-only mode.
  */
@@ -1129,12 +1366,25 @@ static bool HandleDExPayments(const CTransaction& tx, int nBlock, const std::str
 {
     int count = 0;
 
+    // only outputs to counterparties of open accepts of the sender can be payments,
+    // so the outputs are matched by destination, before any address is encoded
+    std::set<CTxDestination> setCounterparties;
+    const std::set<std::string> counterparties = DEx_getAcceptCounterparties(strSender);
+    for (std::set<std::string>::const_iterator it = counterparties.begin(); it != counterparties.end(); ++it) {
+        if (*it == strSender) continue;
+        CTxDestination dest = DecodeDestination(*it);
+        if (IsValidDestination(dest)) setCounterparties.insert(dest);
+    }
+    if (setCounterparties.empty()) {
+        return false;
+    }
+
     for (unsigned int n = 0; n < tx.vout.size(); ++n) {
         CTxDestination dest;
         if (ExtractDestination(tx.vout[n].scriptPubKey, dest)) {
-            std::string strAddress = EncodeDestination(dest);
-            if (strAddress == strSender)
+            if (!setCounterparties.count(dest))
                 continue;
+            std::string strAddress = EncodeDestination(dest);
 
             if (msc_debug_parser_dex) PrintToLog("payment #%d %s %s\n", count, strAddress, FormatIndivisibleMP(tx.vout[n].nValue));
 
@@ -1261,6 +1511,15 @@ static int msc_initial_scan(int nFirstBlock)
     // check if using seed block filter should be disabled
     bool seedBlockFilterEnabled = gArgs.GetBoolArg("-tlseedblockfilter", true);
 
+    // the recorded blocks can only be skipped, if they are still part of the active chain
+    int nFilterBlock = -1;
+    uint256 hashFilterBlock;
+    if (pDbBlockFilter->GetAnchorBlock(nFilterBlock, hashFilterBlock) &&
+            (nFilterBlock > nLastBlock || chainActive[nFilterBlock]->GetBlockHash() != hashFilterBlock)) {
+        PrintToLog("Block filter anchor %d is not part of the active chain, clearing it\n", nFilterBlock);
+        pDbBlockFilter->Clear();
+    }
+
     for (nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock)
     {
         if (ShutdownRequested()) {
@@ -1284,7 +1543,11 @@ static int msc_initial_scan(int nFirstBlock)
         unsigned int nTxsFoundInBlock = 0;
         mastercore_handler_block_begin(nBlock, pblockindex);
 
-        if (!seedBlockFilterEnabled || !SkipBlock(nBlock)) {
+        bool fSkipBlock = seedBlockFilterEnabled && (pDbBlockFilter->CanSkipBlock(nBlock) || SkipBlock(nBlock));
+        if (fSkipBlock) {
+            // blocks of the seed list are recorded as processed as well
+            pDbBlockFilter->RecordBlock(nBlock, pblockindex->GetBlockHash(), false);
+        } else {
             CBlock block;
             if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) break;
 
@@ -1318,14 +1581,19 @@ void clear_all_state()
 
     // Memory based storage
     mp_tally_map.clear();
+    mapPropertyHolders.clear();
+    WalletCacheInvalidate();
     my_offers.clear();
-    my_accepts.clear();
+    DEx_acceptsClear();
+    ClearBlockEvents(BLOCK_EVENT_ACCEPT_EXPIRY);
     metadex.clear();
     my_pending.clear();
     ResetConsensusParams();
     ClearActivations();
     ClearAlerts();
     ClearFreezeState();
+    ClearOracleSamples();
+    ClearTxInputCache();
 
     // LevelDB based storage
     pDbSpInfo->Clear();
@@ -1333,8 +1601,9 @@ void clear_all_state()
     pDbStoList->Clear();
     pDbTradeList->Clear();
     pDbTransaction->Clear();
-    pDbFeeCache->Clear();
-    pDbFeeHistory->Clear();
+    if (pDbFeeCache) pDbFeeCache->Clear();
+    WalletTxIndexClear();
+    if (pDbFeeHistory) pDbFeeHistory->Clear();
     assert(pDbTransactionList->setDBVersion() == DB_VERSION); // new set of databases, set DB version
 }
 
@@ -1347,8 +1616,16 @@ void RewindDBsAndState(int nHeight, int nBlockPrev = 0, bool fInitialParse = fal
     pDbTransactionList->isMPinBlockRange(nHeight, reorgRecoveryMaxHeight, true);
     pDbTradeList->deleteAboveBlock(nHeight);
     pDbStoList->deleteAboveBlock(nHeight);
-    pDbFeeCache->RollBackCache(nHeight);
-    pDbFeeHistory->RollBackHistory(nHeight);
+    WalletTxIndexDeleteAboveBlock(nHeight);
+    DeleteOracleSamplesAboveBlock(nHeight);
+    ClearTxInputCache();
+    if (pDbFeeCache) pDbFeeCache->RollBackCache(nHeight);
+    if (pDbFeeHistory) pDbFeeHistory->RollBackHistory(nHeight);
+    if (pDbBlockFilter) {
+        // the previous block is still part of the active chain
+        const CBlockIndex* pPrevIndex = chainActive[nHeight - 1];
+        pDbBlockFilter->DeleteAboveBlock(nHeight, pPrevIndex ? pPrevIndex->GetBlockHash() : uint256());
+    }
     reorgRecoveryMaxHeight = 0;
 
     nWaterlineBlock = ConsensusParams().GENESIS_BLOCK - 1;
@@ -1419,6 +1696,8 @@ int mastercore_init()
                 fs::path spPath = GetDataDir() / "MP_spinfo";
                 fs::path stoPath = GetDataDir() / "MP_stolist";
                 fs::path tlTXDBPath = GetDataDir() / "TL_TXDB";
+                fs::path inputsPath = GetDataDir() / "TL_inputs";
+                fs::path blockFilterPath = GetDataDir() / "TL_blockfilter";
                 // fs::path feesPath = GetDataDir() / "TL_feecache";
                 // fs::path feeHistoryPath = GetDataDir() / "TL_feehistory";
                 if (fs::exists(persistPath)) fs::remove_all(persistPath);
@@ -1427,6 +1706,8 @@ int mastercore_init()
                 if (fs::exists(spPath)) fs::remove_all(spPath);
                 if (fs::exists(stoPath)) fs::remove_all(stoPath);
                 if (fs::exists(tlTXDBPath)) fs::remove_all(tlTXDBPath);
+                if (fs::exists(inputsPath)) fs::remove_all(inputsPath);
+                if (fs::exists(blockFilterPath)) fs::remove_all(blockFilterPath);
                 // if (fs::exists(feesPath)) fs::remove_all(feesPath);
                 // if (fs::exists(feeHistoryPath)) fs::remove_all(feeHistoryPath);
                 PrintToLog("Success clearing persistence files in datadir %s\n", GetDataDir().string());
@@ -1442,6 +1723,8 @@ int mastercore_init()
         pDbTransactionList = new CMPTxList(GetDataDir() / "MP_txlist", fReindex);
         pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo", fReindex);
         pDbTransaction = new CTLTransactionDB(GetDataDir() / "TL_TXDB", fReindex);
+        pDbInputIndex = new CTLInputIndex(GetDataDir() / "TL_inputs", fReindex);
+        pDbBlockFilter = new CTLBlockFilter(GetDataDir() / "TL_blockfilter", fReindex);
         // pDbFeeCache = new CTLFeeCache(GetDataDir() / "TL_feecache", fReindex);
         // pDbFeeHistory = new CTLFeeHistory(GetDataDir() / "TL_feehistory", fReindex);
 
@@ -1553,6 +1836,8 @@ int mastercore_shutdown()
 {
     LOCK(cs_tally);
 
+    StopStatePersistence();
+
     if (pDbTransactionList) {
         delete pDbTransactionList;
         pDbTransactionList = nullptr;
@@ -1573,6 +1858,14 @@ int mastercore_shutdown()
         delete pDbTransaction;
         pDbTransaction = nullptr;
     }
+    if (pDbInputIndex) {
+        delete pDbInputIndex;
+        pDbInputIndex = nullptr;
+    }
+    if (pDbBlockFilter) {
+        delete pDbBlockFilter;
+        pDbBlockFilter = nullptr;
+    }
 
     mastercoreInitialized = 0;
 
@@ -1581,6 +1874,8 @@ int mastercore_shutdown()
 
     PrintToConsole("Trade Layer shutdown completed\n");
 
+    StopDebugLog();
+
     return 0;
 }
 
@@ -1598,6 +1893,7 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
     ui128 numQuad128;
 
     LOCK(cs_tally);
+    CPerfTimer perfTimer(PERF_HANDLER_TX);
 
     if (!mastercoreInitialized) {
         mastercore_init();
@@ -1612,6 +1908,7 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
     // we do not care about parsing blocks prior to our waterline (empty blockchain defense)
     if (nBlock < nWaterlineBlock) return false;
     int64_t nBlockTime = pBlockIndex->GetBlockTime();
+    ++nBlockTxsProcessed;
 
 
     // int nBlockNow = GetHeight();
@@ -1650,12 +1947,15 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
       } else expirationAchieve = 0;
     } else expirationAchieve = 0;
 
+    // the block can't be skipped during a reparse, if it triggers per-transaction logic
+    if (checkExpiration || static_cast<int>(pBlockIndex->nHeight) == params.MSC_VESTING_BLOCK) fBlockHasTLTx = true;
 
     bool fFoundTx = false;
     int pop_ret = parseTransaction(false, tx, nBlock, idx, mp_obj, nBlockTime, removedCoins);
 
     if (0 == pop_ret) {
-        int interp_ret = mp_obj.interpretPacket();
+        fBlockHasTLTx = true;
+        int interp_ret = mp_obj.interpretPacket(blockContext.IsFor(pBlockIndex) ? &blockContext : nullptr);
         if (interp_ret) PrintToLog("!!! interpretPacket() returned %d !!!\n", interp_ret);
 
         // Only structurally valid transactions get recorded in levelDB
@@ -1664,6 +1964,7 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
             bool bValid = (0 <= interp_ret);
             pDbTransactionList->recordTX(tx.GetHash(), bValid, nBlock, mp_obj.getType(), mp_obj.getNewAmount());
             pDbTransaction->RecordTransaction(tx.GetHash(), idx, interp_ret);
+            WalletTxIndexAdd(tx, nBlock, idx, mp_obj.getSender());
         }
 
         // if interpretPacket returns 1, that means we have an instant trade between LTCs and tokens.
@@ -1707,18 +2008,25 @@ bool mastercore::UseEncodingClassC(size_t nDataSize)
 int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockIndex)
 {
     LOCK(cs_tally);
+    CPerfTimer perfTimer(PERF_BLOCK_BEGIN);
 
     if (reorgRecoveryMode > 0) {
         reorgRecoveryMode = 0; // clear reorgRecovery here as this is likely re-entrant
         RewindDBsAndState(pBlockIndex->nHeight, nBlockPrev);
     }
 
-    // handle any features that go live with this block
-    CheckLiveActivations(pBlockIndex->nHeight);
+    // shared by the transactions of this block, set after a rescan of the previous blocks
+    blockContext = CBlockContext(pBlockIndex);
+    nBlockTxsProcessed = 0;
+    fBlockHasTLTx = false;
 
     // handle any features that go live with this block
+    if (!PopDueBlockEvents(BLOCK_EVENT_ACTIVATION, pBlockIndex->nHeight).empty()) {
+        CheckLiveActivations(pBlockIndex->nHeight);
+    }
+
+    // pay out channel withdrawals, which are due in this block
     makeWithdrawals(pBlockIndex->nHeight);
-    CheckLiveActivations(pBlockIndex->nHeight);
     update_sum_upnls();
     // marginMain(pBlockIndex->nHeight);
     // addInterestPegged(nBlockPrev,pBlockIndex);
@@ -1734,6 +2042,7 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         unsigned int countMP)
 {
     LOCK(cs_tally);
+    CPerfTimer perfTimer(PERF_BLOCK_END);
 
     if (!mastercoreInitialized) {
         mastercore_init();
@@ -1756,8 +2065,21 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
     //     PrintToLog("devmsc for block %d: %d, Exodus balance: %d\n", nBlockNow, devmsc, FormatDivisibleMP(balance));
     // }
 
-    // check the alert status, do we need to do anything else here?
-    CheckExpiredAlerts(nBlockNow, pBlockIndex->GetBlockTime());
+    // check the alert status, if any alert may expire in this block
+    if (!PopDueBlockEvents(BLOCK_EVENT_ALERT_EXPIRY, nBlockNow).empty()) {
+        CheckExpiredAlerts(nBlockNow, pBlockIndex->GetBlockTime());
+    }
+
+    // store the latest oracle prices of contracts updated in this block
+    FlushOracleUpdates();
+
+    // distribute the fee caches, which reached their thresholds, and store the changed fee caches
+    if (pDbFeeCache) pDbFeeCache->FlushCache(nBlockNow);
+
+    // record the processed block, so a reparse can skip it, if it has no Trade Layer transactions
+    if (pDbBlockFilter && nBlockTxsProcessed > 0) {
+        pDbBlockFilter->RecordBlock(nBlockNow, pBlockIndex->GetBlockHash(), fBlockHasTLTx);
+    }
 
     // check that pending transactions are still in the mempool
     PendingCheck();
@@ -1782,6 +2104,7 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         PrintToLog(msg);
         if (!gArgs.GetBoolArg("-overrideforcedshutdown", false)) {
             fs::path persistPath = GetDataDir() / "MP_persist";
+            StopStatePersistence();
             if (fs::exists(persistPath)) fs::remove_all(persistPath); // prevent the node being restarted without a reparse after forced shutdown
             DoAbortNode(msg, msg);
         }
@@ -2030,6 +2353,8 @@ void printing_edges_database(std::map<std::string, std::string> &path_ele)
 
 bool mastercore::marginMain(int Block)
 {
+  CPerfTimer perfTimer(PERF_MARGIN_MAIN);
+
   //checking in map for address and the UPNL.
     if(msc_debug_margin_main) PrintToLog("%s: Block in marginMain: %d\n", __func__, Block);
     LOCK(cs_tally);
@@ -2242,6 +2567,8 @@ int64_t mastercore::sum_check_upnl(std::string address)
 
 void mastercore::update_sum_upnls()
 {
+    CPerfTimer perfTimer(PERF_UPDATE_SUM_UPNLS);
+
     //cleaning the sum_upnls map
     if(!sum_upnls.empty())
         sum_upnls.clear();
@@ -2545,8 +2872,16 @@ bool mastercore::Instant_x_Trade(const uint256& txid, uint8_t tradingAction, std
 
 bool mastercore::makeWithdrawals(int Block)
 {
-    for(std::map<std::string,vector<withdrawalAccepted>>::iterator it = withdrawal_Map.begin(); it != withdrawal_Map.end(); ++it)
+    CPerfTimer perfTimer(PERF_MAKE_WITHDRAWALS);
+
+    // only channels with a withdrawal deadline in this block are looked at
+    const std::set<std::string> channels = PopDueBlockEvents(BLOCK_EVENT_WITHDRAWAL, Block);
+
+    for (std::set<std::string>::const_iterator itChannel = channels.begin(); itChannel != channels.end(); ++itChannel)
     {
+        std::map<std::string,vector<withdrawalAccepted>>::iterator it = withdrawal_Map.find(*itChannel);
+        if (it == withdrawal_Map.end()) continue;
+
         std::string channelAddress = it->first;
 
         vector<withdrawalAccepted> &accepted = it->second;
@@ -2575,7 +2910,7 @@ bool mastercore::makeWithdrawals(int Block)
             assert(update_tally_map(channelAddress, propertyId, -amount, CHANNEL_RESERVE));
 
             // deleting element from vector
-            accepted.erase(itt);
+            itt = accepted.erase(itt);
 
         }
 
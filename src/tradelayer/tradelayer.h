@@ -7,6 +7,7 @@ class CCoinsViewCache;
 class CTransaction;
 class Coin;
 
+#include <tradelayer/inputcache.h>
 #include <tradelayer/log.h>
 #include <tradelayer/tally.h>
 #include <tradelayer/dbtradelist.h>
@@ -25,6 +26,7 @@ class Coin;
 #include <vector>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
@@ -38,6 +40,9 @@ typedef boost::rational<boost::multiprecision::checked_int128_t> rational_t;
 int const MAX_STATE_HISTORY = 50;
 int const STORE_EVERY_N_BLOCK = 10000;
 
+//! Block height, from which on class C (op-return) transactions are searched for
+int const CLASS_C_BLOCK = 395000;
+
 #define TEST_ECO_PROPERTY_1 (0x80000003UL)
 
 // increment this value to force a refresh of the state (similar to --startclean)
@@ -275,6 +280,8 @@ namespace mastercore
 {
 //! In-memory collection of all amounts for all addresses for all properties
 extern std::unordered_map<std::string, CMPTally> mp_tally_map;
+//! Addresses, which were credited with tokens, indexed by property; may include addresses without tokens
+extern std::unordered_map<uint32_t, std::unordered_set<std::string> > mapPropertyHolders;
 
 // TODO: move, rename
 extern CCoinsView viewDummy;
@@ -282,6 +289,25 @@ extern CCoinsViewCache view;
 //! Guards coins view cache
 extern CCriticalSection cs_tx_cache;
 
+/**
+ * Replaces the coins view cache for transaction inputs with a temporary one,
+ * while in scope. The inputs added meanwhile aren't tracked by the input cache.
+ *
+ * Note: cs_tx_cache must be held, while the object exists.
+ */
+class CTempInputView
+{
+private:
+    CCoinsViewCache& viewTemp;
+
+public:
+    explicit CTempInputView(CCoinsViewCache& viewIn);
+    ~CTempInputView();
+};
+
+/** Returns the usage statistics of the transaction input cache. */
+InputCacheStats GetInputCacheStats();
+
 /** Returns the encoding class, used to embed a payload. */
 int GetEncodingClass(const CTransaction& tx, int nBlock);
 
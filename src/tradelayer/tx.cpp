@@ -3,6 +3,9 @@
 #include <tradelayer/tx.h>
 
 #include <tradelayer/activation.h>
+#include <tradelayer/arith128.h>
+#include <tradelayer/blockcontext.h>
+#include <tradelayer/blockevents.h>
 #include <tradelayer/dbfees.h>
 #include <tradelayer/dbspinfo.h>
 #include <tradelayer/dbstolist.h>
@@ -12,13 +15,14 @@
 #include <tradelayer/log.h>
 #include <tradelayer/mdex.h>
 #include <tradelayer/notifications.h>
+#include <tradelayer/oracleprices.h>
 #include <tradelayer/parsing.h>
 #include <tradelayer/rules.h>
 #include <tradelayer/sp.h>
 #include <tradelayer/sto.h>
-#include <tradelayer/uint256_extensions.h>
 #include <tradelayer/utilsbitcoin.h>
 #include <tradelayer/version.h>
+#include <tradelayer/walletfetchtxs.h>
 
 
 #include <amount.h>
@@ -29,12 +33,12 @@
 #include <util/time.h>
 
 #include <boost/algorithm/string.hpp>
-#include <boost/lexical_cast.hpp>
 
 #include <stdio.h>
 #include <string.h>
 
 #include <algorithm>
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -43,10 +47,8 @@ using boost::algorithm::token_compress_on;
 using namespace mastercore;
 
 typedef boost::rational<boost::multiprecision::checked_int128_t> rational_t;
-typedef boost::multiprecision::cpp_dec_float_100 dec_float;
 typedef boost::multiprecision::checked_int128_t int128_t;
 extern std::map<std::string,uint32_t> peggedIssuers;
-extern std::map<uint32_t,oracledata> oraclePrices;
 extern std::map<std::string,vector<withdrawalAccepted>> withdrawal_Map;
 extern std::map<std::string,channel> channels_Map;
 extern int64_t factorE;
@@ -121,7 +123,7 @@ static std::string intToClass(int encodingClass)
 /** Checks whether a pointer to the payload is past it's last position. */
 bool CMPTransaction::isOverrun(const char* p)
 {
-    ptrdiff_t pos = (char*) p - (char*) &pkt;
+    ptrdiff_t pos = (char*) p - (char*) pkt.data();
     return (pos > pkt_size);
 }
 
@@ -564,7 +566,7 @@ bool CMPTransaction::interpret_CreatePropertyFixed()
     if (pkt_size < 25) {
         return false;
     }
-    const char* p = 11 + (char*) &pkt;
+    const char* p = 11 + (char*) pkt.data();
     std::vector<std::string> spstr;
     memcpy(&ecosystem, &pkt[4], 1);
     memcpy(&prop_type, &pkt[5], 2);
@@ -576,11 +578,11 @@ bool CMPTransaction::interpret_CreatePropertyFixed()
         p += spstr.back().size() + 1;
     }
     int i = 0;
-    memcpy(category, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(category)-1)); i++;
-    memcpy(subcategory, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(subcategory)-1)); i++;
-    memcpy(name, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(name)-1)); i++;
-    memcpy(url, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(url)-1)); i++;
-    memcpy(data, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(data)-1)); i++;
+    category = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    subcategory = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    name = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    url = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    data = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
     memcpy(&nValue, p, 8);
     SwapByteOrder64(nValue);
     p += 8;
@@ -612,7 +614,7 @@ bool CMPTransaction::interpret_CreatePropertyVariable()
     if (pkt_size < 39) {
         return false;
     }
-    const char* p = 11 + (char*) &pkt;
+    const char* p = 11 + (char*) pkt.data();
     std::vector<std::string> spstr;
     memcpy(&ecosystem, &pkt[4], 1);
     memcpy(&prop_type, &pkt[5], 2);
@@ -624,11 +626,11 @@ bool CMPTransaction::interpret_CreatePropertyVariable()
         p += spstr.back().size() + 1;
     }
     int i = 0;
-    memcpy(category, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(category)-1)); i++;
-    memcpy(subcategory, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(subcategory)-1)); i++;
-    memcpy(name, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(name)-1)); i++;
-    memcpy(url, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(url)-1)); i++;
-    memcpy(data, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(data)-1)); i++;
+    category = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    subcategory = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    name = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    url = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    data = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
     memcpy(&property, p, 4);
     SwapByteOrder32(property);
     p += 4;
@@ -672,7 +674,7 @@ bool CMPTransaction::interpret_CreatePropertyManaged()
     if (pkt_size < 17) {
         return false;
     }
-    const char* p = 11 + (char*) &pkt;
+    const char* p = 11 + (char*) pkt.data();
     std::vector<std::string> spstr;
     memcpy(&ecosystem, &pkt[4], 1);
     memcpy(&prop_type, &pkt[5], 2);
@@ -684,11 +686,11 @@ bool CMPTransaction::interpret_CreatePropertyManaged()
         p += spstr.back().size() + 1;
     }
     int i = 0;
-    memcpy(category, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(category)-1)); i++;
-    memcpy(subcategory, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(subcategory)-1)); i++;
-    memcpy(name, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(name)-1)); i++;
-    memcpy(url, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(url)-1)); i++;
-    memcpy(data, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(data)-1)); i++;
+    category = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    subcategory = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    name = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    url = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
+    data = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
 
     if ((!rpcOnly && msc_debug_packets) || msc_debug_packets_readonly) {
         PrintToLog("\t       ecosystem: %d\n", ecosystem);
@@ -930,9 +932,9 @@ bool CMPTransaction::interpret_Alert()
     memcpy(&alert_expiry, &pkt[6], 4);
     SwapByteOrder32(alert_expiry);
 
-    const char* p = 10 + (char*) &pkt;
+    const char* p = 10 + (char*) pkt.data();
     std::string spstr(p);
-    memcpy(alert_text, spstr.c_str(), std::min(spstr.length(), sizeof(alert_text)-1));
+    alert_text = spstr.substr(0, SP_STRING_FIELD_LEN-1);
 
     if ((!rpcOnly && msc_debug_packets) || msc_debug_packets_readonly) {
         PrintToLog("\t      alert type: %d\n", alert_type);
@@ -992,7 +994,7 @@ bool CMPTransaction::interpret_CreateContractDex()
   }
 
   int i = 0;
-  memcpy(name, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(name)-1)); i++;
+  name = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
 
   prop_type = ALL_PROPERTY_TYPE_CONTRACT;
 
@@ -1040,7 +1042,7 @@ bool CMPTransaction::interpret_CreateOracleContract()
     }
 
     int i = 0;
-    memcpy(name, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(name)-1)); i++;
+    name = spstr[i].substr(0, SP_STRING_FIELD_LEN-1); i++;
 
 
     prop_type = ALL_PROPERTY_TYPE_ORACLE_CONTRACT;
@@ -1088,7 +1090,7 @@ bool CMPTransaction::interpret_ContractDexTrade()
       p += spstr.back().size() + 1;
   }
 
-  memcpy(name, spstr[0].c_str(), std::min(spstr[0].length(), sizeof(name)-1));
+  name = spstr[0].substr(0, SP_STRING_FIELD_LEN-1);
 
 
   if ((!rpcOnly && msc_debug_packets) || msc_debug_packets_readonly)
@@ -1266,7 +1268,7 @@ bool CMPTransaction::interpret_Create_Channel()
     spstr.push_back(std::string(p));
     p += spstr.back().size() + 1;
 
-    memcpy(channel_address, spstr[0].c_str(), std::min(spstr[0].length(), sizeof(channel_address)-1));
+    channel_address = spstr[0].substr(0, SP_STRING_FIELD_LEN-1);
 
 
   if ((!rpcOnly && msc_debug_packets) || msc_debug_packets_readonly)
@@ -1415,8 +1417,8 @@ bool CMPTransaction::interpret_New_Id_Registration()
 
   int i = 0;
 
-  memcpy(website, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(website)-1));i++;
-  memcpy(company_name, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(company_name)-1));i++;
+  website = spstr[i].substr(0, SP_STRING_FIELD_LEN-1);i++;
+  company_name = spstr[i].substr(0, SP_STRING_FIELD_LEN-1);i++;
 
   if ((!rpcOnly && msc_debug_packets) || msc_debug_packets_readonly)
   {
@@ -1532,7 +1534,7 @@ bool CMPTransaction::interpret_CreatePeggedCurrency()
 
   int i = 0;
 
-  memcpy(name, spstr[i].c_str(), std::min(spstr[i].length(), sizeof(name)-1));i++;
+  name = spstr[i].substr(0, SP_STRING_FIELD_LEN-1);i++;
 
   prop_type = ALL_PROPERTY_TYPE_PEGGEDS;
 
@@ -1599,6 +1601,43 @@ bool CMPTransaction::interpret_RedemptionPegged()
   return true;
 }
 
+/**
+ * Retrieves the hash of the block of the transaction, from the block context,
+ * if available, or otherwise from the active chain.
+ *
+ * @return False, if the block is not in the active chain
+ */
+bool CMPTransaction::GetBlockHash(uint256& blockHash) const
+{
+    if (pBlockContext) {
+        blockHash = pBlockContext->hash;
+        return true;
+    }
+
+    LOCK(cs_main);
+
+    CBlockIndex* pindex = chainActive[block];
+    if (pindex == nullptr) {
+        return false;
+    }
+    blockHash = pindex->GetBlockHash();
+
+    return true;
+}
+
+/**
+ * Checks whether the type and version of the transaction is allowed for the
+ * given property in the block of the transaction.
+ */
+bool CMPTransaction::IsTypeAllowed(uint32_t txProperty) const
+{
+    if (pBlockContext) {
+        return pBlockContext->IsTransactionTypeAllowed(txProperty, type, version);
+    }
+
+    return IsTransactionTypeAllowed(block, txProperty, type, version);
+}
+
 // ---------------------- CORE LOGIC -------------------------
 
 /**
@@ -1607,8 +1646,11 @@ bool CMPTransaction::interpret_RedemptionPegged()
  * @return  0  if the transaction is fully valid
  *         <0  if the transaction is invalid
  */
-int CMPTransaction::interpretPacket()
+int CMPTransaction::interpretPacket(const CBlockContext* pContext)
 {
+    // the context may only be used for transactions of its block
+    pBlockContext = (pContext && pContext->nHeight == block) ? pContext : nullptr;
+
     if (rpcOnly) {
         PrintToLog("%s(): ERROR: attempt to execute logic in RPC mode\n", __func__);
         return (PKT_ERROR -1);
@@ -1767,18 +1809,12 @@ int CMPTransaction::interpretPacket()
 int CMPTransaction::logicMath_CommitChannel()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == NULL) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -1821,7 +1857,7 @@ int CMPTransaction::logicMath_CommitChannel()
 /** Tx 0 */
 int CMPTransaction::logicMath_SimpleSend()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -1867,7 +1903,7 @@ int CMPTransaction::logicMath_SimpleSend()
 /** Tx 3 */
 int CMPTransaction::logicMath_SendToOwners()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -1962,7 +1998,7 @@ int CMPTransaction::logicMath_SendToOwners()
 
     // split up what was taken and distribute between all holders
     int64_t sent_so_far = 0;
-    for (OwnerAddrType::reverse_iterator it = receiversSet.rbegin(); it != receiversSet.rend(); ++it) {
+    for (OwnerAddrType::const_iterator it = receiversSet.begin(); it != receiversSet.end(); ++it) {
         const std::string& address = it->second;
 
         int64_t will_really_receive = it->first;
@@ -1972,9 +2008,6 @@ int CMPTransaction::logicMath_SendToOwners()
         assert(update_tally_map(sender, property, -will_really_receive, BALANCE));
         assert(update_tally_map(address, property, will_really_receive, BALANCE));
 
-        // add to stodb
-        pDbStoList->recordSTOReceive(address, txid, block, property, will_really_receive);
-
         if (sent_so_far != (int64_t)nValue) {
             PrintToLog("sent_so_far= %14d, nValue= %14d, n_owners= %d\n", sent_so_far, nValue, numberOfReceivers);
         } else {
@@ -1985,6 +2018,10 @@ int CMPTransaction::logicMath_SendToOwners()
     // sent_so_far must equal nValue here
     assert(sent_so_far == (int64_t)nValue);
 
+    // add to stodb
+    pDbStoList->recordSTOReceives(txid, block, property, receiversSet);
+    WalletTxIndexAddSTOReceipts(txid, block, tx_idx, receiversSet);
+
     // Number of tokens has changed, update fee distribution thresholds
     if (version == MP_TX_PKT_V0) NotifyTotalTokensChanged(TL_PROPERTY_MSC, block); // fee was burned
 
@@ -1994,7 +2031,7 @@ int CMPTransaction::logicMath_SendToOwners()
 /** Tx 4 */
 int CMPTransaction::logicMath_SendAll()
 {
-    if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+    if (!IsTypeAllowed(ecosystem)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2064,7 +2101,7 @@ int CMPTransaction::logicMath_SendVestingTokens()
 /** Tx 20 */
 int CMPTransaction::logicMath_TradeOffer()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2163,7 +2200,7 @@ int CMPTransaction::logicMath_TradeOffer()
 /** Tx 22 */
 int CMPTransaction::logicMath_AcceptOffer_BTC()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2189,7 +2226,7 @@ int CMPTransaction::logicMath_AcceptOffer_BTC()
 /** Tx 25 */
 int CMPTransaction::logicMath_MetaDExTrade()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2265,7 +2302,7 @@ int CMPTransaction::logicMath_MetaDExTrade()
 /** Tx 26 */
 int CMPTransaction::logicMath_MetaDExCancelPrice()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2321,7 +2358,7 @@ int CMPTransaction::logicMath_MetaDExCancelPrice()
 /** Tx 27 */
 int CMPTransaction::logicMath_MetaDExCancelPair()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2367,7 +2404,7 @@ int CMPTransaction::logicMath_MetaDExCancelPair()
 /** Tx 28 */
 int CMPTransaction::logicMath_MetaDExCancelEcosystem()
 {
-    if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+    if (!IsTypeAllowed(ecosystem)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2391,15 +2428,9 @@ int CMPTransaction::logicMath_MetaDExCancelEcosystem()
 int CMPTransaction::logicMath_CreatePropertyFixed()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_SP -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_SP -20);
     }
 
     if (TL_PROPERTY_MSC != ecosystem && TL_PROPERTY_TMSC != ecosystem) {
@@ -2407,7 +2438,7 @@ int CMPTransaction::logicMath_CreatePropertyFixed()
         return (PKT_ERROR_SP -21);
     }
 
-    if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+    if (!IsTypeAllowed(ecosystem)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2427,7 +2458,7 @@ int CMPTransaction::logicMath_CreatePropertyFixed()
         return (PKT_ERROR_SP -36);
     }
 
-    if ('\0' == name[0]) {
+    if (name.empty()) {
         PrintToLog("%s(): rejected: property name must not be empty\n", __func__);
         return (PKT_ERROR_SP -37);
     }
@@ -2462,15 +2493,9 @@ int CMPTransaction::logicMath_CreatePropertyFixed()
 int CMPTransaction::logicMath_CreatePropertyVariable()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_SP -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_SP -20);
     }
 
     if (TL_PROPERTY_MSC != ecosystem && TL_PROPERTY_TMSC != ecosystem) {
@@ -2491,7 +2516,7 @@ int CMPTransaction::logicMath_CreatePropertyVariable()
     // }
     // }
 
-    if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+    if (!IsTypeAllowed(ecosystem)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2516,7 +2541,7 @@ int CMPTransaction::logicMath_CreatePropertyVariable()
         return (PKT_ERROR_SP -36);
     }
 
-    if ('\0' == name[0]) {
+    if (name.empty()) {
         PrintToLog("%s(): rejected: property name must not be empty\n", __func__);
         return (PKT_ERROR_SP -37);
     }
@@ -2559,15 +2584,9 @@ int CMPTransaction::logicMath_CreatePropertyVariable()
 int CMPTransaction::logicMath_CreatePropertyManaged()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_SP -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_SP -20);
     }
 
     if (TL_PROPERTY_MSC != ecosystem && TL_PROPERTY_TMSC != ecosystem) {
@@ -2575,7 +2594,7 @@ int CMPTransaction::logicMath_CreatePropertyManaged()
         return (PKT_ERROR_SP -21);
     }
 
-    if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+    if (!IsTypeAllowed(ecosystem)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2590,7 +2609,7 @@ int CMPTransaction::logicMath_CreatePropertyManaged()
         return (PKT_ERROR_SP -36);
     }
 
-    if ('\0' == name[0]) {
+    if (name.empty()) {
         PrintToLog("%s(): rejected: property name must not be empty\n", __func__);
         return (PKT_ERROR_SP -37);
     }
@@ -2624,18 +2643,12 @@ int CMPTransaction::logicMath_CreatePropertyManaged()
 int CMPTransaction::logicMath_GrantTokens()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_SP -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_SP -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2711,18 +2724,12 @@ int CMPTransaction::logicMath_GrantTokens()
 int CMPTransaction::logicMath_RevokeTokens()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2781,18 +2788,12 @@ int CMPTransaction::logicMath_RevokeTokens()
 int CMPTransaction::logicMath_ChangeIssuer()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2836,18 +2837,12 @@ int CMPTransaction::logicMath_ChangeIssuer()
 int CMPTransaction::logicMath_EnableFreezing()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2897,18 +2892,12 @@ int CMPTransaction::logicMath_EnableFreezing()
 int CMPTransaction::logicMath_DisableFreezing()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -2950,18 +2939,12 @@ int CMPTransaction::logicMath_DisableFreezing()
 int CMPTransaction::logicMath_FreezeTokens()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3008,18 +2991,12 @@ int CMPTransaction::logicMath_FreezeTokens()
 int CMPTransaction::logicMath_UnfreezeTokens()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == nullptr) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3065,7 +3042,7 @@ int CMPTransaction::logicMath_UnfreezeTokens()
 /** Tx 65533 */
 int CMPTransaction::logicMath_Deactivation()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3108,7 +3085,7 @@ int CMPTransaction::logicMath_Deactivation()
 /** Tx 65534 */
 int CMPTransaction::logicMath_Activation()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3143,7 +3120,7 @@ int CMPTransaction::logicMath_Activation()
 /** Tx 65535 */
 int CMPTransaction::logicMath_Alert()
 {
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3195,7 +3172,7 @@ int CMPTransaction::logicMath_DEx_Payment()
 {
   int rc = 2;
 
-  if (!IsTransactionTypeAllowed(block, property, type, version)) {
+  if (!IsTypeAllowed(property)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
               __func__,
               type,
@@ -3213,19 +3190,12 @@ int CMPTransaction::logicMath_DEx_Payment()
 int CMPTransaction::logicMath_CreateContractDex()
 {
   uint256 blockHash;
-  {
-    LOCK(cs_main);
-
-    CBlockIndex* pindex = chainActive[block];
-
-      if (pindex == NULL) {
-	PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-	return (PKT_ERROR_SP -20);
-      }
-      blockHash = pindex->GetBlockHash();
+  if (!GetBlockHash(blockHash)) {
+      PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+      return (PKT_ERROR_SP -20);
   }
 
-  if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+  if (!IsTypeAllowed(ecosystem)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
           __func__,
           type,
@@ -3235,7 +3205,7 @@ int CMPTransaction::logicMath_CreateContractDex()
       return (PKT_ERROR_SP -22);
   }
 
-  if ('\0' == name[0]) {
+  if (name.empty()) {
     PrintToLog("%s(): rejected: property name must not be empty\n", __func__);
     return (PKT_ERROR_SP -37);
   }
@@ -3274,18 +3244,10 @@ int CMPTransaction::logicMath_CreateContractDex()
 int CMPTransaction::logicMath_CreateOracleContract()
 {
   uint256 blockHash;
+  if (!GetBlockHash(blockHash))
   {
-    LOCK(cs_main);
-
-    CBlockIndex* pindex = chainActive[block];
-
-      if (pindex == NULL)
-      {
-	        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-	        return (PKT_ERROR_SP -20);
-      }
-
-      blockHash = pindex->GetBlockHash();
+      PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+      return (PKT_ERROR_SP -20);
   }
 
   if (sender == receiver)
@@ -3299,7 +3261,7 @@ int CMPTransaction::logicMath_CreateOracleContract()
       return (PKT_ERROR_SP -21);
   }
 
-  if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+  if (!IsTypeAllowed(ecosystem)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
           __func__,
           type,
@@ -3309,7 +3271,7 @@ int CMPTransaction::logicMath_CreateOracleContract()
       return (PKT_ERROR_SP -22);
   }
 
-  if ('\0' == name[0])
+  if (name.empty())
   {
       PrintToLog("%s(): rejected: property name must not be empty\n", __func__);
       return (PKT_ERROR_SP -37);
@@ -3350,16 +3312,10 @@ int CMPTransaction::logicMath_ContractDexTrade()
 {
 
   uint256 blockHash;
+  if (!GetBlockHash(blockHash))
   {
-    LOCK(cs_main);
-
-    CBlockIndex* pindex = chainActive[block];
-    if (pindex == NULL)
-    {
-	      PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-	      return (PKT_ERROR_SP -20);
-    }
-    blockHash = pindex->GetBlockHash();
+      PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+      return (PKT_ERROR_SP -20);
   }
 
   int result;
@@ -3387,8 +3343,7 @@ int CMPTransaction::logicMath_ContractDexTrade()
   rational_t conv = rational_t(1,1);
   int64_t num = conv.numerator().convert_to<int64_t>();
   int64_t den = conv.denominator().convert_to<int64_t>();
-  arith_uint256 amountTR = (ConvertTo256(amount)*ConvertTo256(marginRe)*ConvertTo256(num))/(ConvertTo256(den)*ConvertTo256(leverage));
-  int64_t amountToReserve = ConvertTo64(amountTR);
+  int64_t amountToReserve = MulMulDiv(amount, marginRe, num, den, leverage);
 
   if (nBalance < amountToReserve || nBalance == 0)
     {
@@ -3432,7 +3387,7 @@ int CMPTransaction::logicMath_ContractDexTrade()
 /** Tx 32 */
 int CMPTransaction::logicMath_ContractDexCancelEcosystem()
 {
-  if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+  if (!IsTypeAllowed(ecosystem)) {
     PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
 	       __func__,
 	       type,
@@ -3458,7 +3413,7 @@ int CMPTransaction::logicMath_ContractDexCancelEcosystem()
 /** Tx 33 */
 int CMPTransaction::logicMath_ContractDexClosePosition()
 {
-    if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+    if (!IsTypeAllowed(ecosystem)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
             __func__,
             type,
@@ -3493,7 +3448,7 @@ int CMPTransaction::logicMath_ContractDexClosePosition()
 
 int CMPTransaction::logicMath_ContractDex_Cancel_Orders_By_Block()
 {
-  if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+  if (!IsTypeAllowed(ecosystem)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
               __func__,
               type,
@@ -3517,18 +3472,12 @@ int CMPTransaction::logicMath_ContractDex_Cancel_Orders_By_Block()
 int CMPTransaction::logicMath_Set_Oracle()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == NULL) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3554,17 +3503,8 @@ int CMPTransaction::logicMath_Set_Oracle()
 
     // ------------------------------------------
 
-    // putting data on memory
-    oraclePrices[contractId].block = block;
-    oraclePrices[contractId].high = oracle_high;
-    oraclePrices[contractId].low = oracle_low;
-
-    // saving on db
-    sp.oracle_high = oracle_high;
-    sp.oracle_low = oracle_low;
-    sp.oracle_last_update = block;
-
-    assert(pDbSpInfo->updateSP(contractId, sp));
+    // putting data on memory, the property entry is updated at the end of the block
+    AddOracleSample(contractId, block, oracle_high, oracle_low);
 
     if (msc_debug_set_oracle) PrintToLog("oracle data for contract: block: %d,high:%d, low:%d\n",block, oracle_high, oracle_low);
 
@@ -3575,18 +3515,12 @@ int CMPTransaction::logicMath_Set_Oracle()
 int CMPTransaction::logicMath_CloseOracle()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == NULL) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3625,18 +3559,12 @@ int CMPTransaction::logicMath_CloseOracle()
 int CMPTransaction::logicMath_OracleBackup()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == NULL) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3673,18 +3601,12 @@ int CMPTransaction::logicMath_OracleBackup()
 int CMPTransaction::logicMath_Change_OracleRef()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == NULL) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3726,18 +3648,12 @@ int CMPTransaction::logicMath_Change_OracleRef()
 int CMPTransaction::logicMath_Create_Channel()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == NULL) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3772,18 +3688,12 @@ int CMPTransaction::logicMath_Create_Channel()
 int CMPTransaction::logicMath_Withdrawal_FromChannel()
 {
     uint256 blockHash;
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == NULL) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_TOKENS -20);
-        }
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_TOKENS -20);
     }
 
-    if (!IsTransactionTypeAllowed(block, property, type, version)) {
+    if (!IsTypeAllowed(property)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -3837,6 +3747,7 @@ int CMPTransaction::logicMath_Withdrawal_FromChannel()
     if (msc_debug_withdrawal_from_channel) PrintToLog("checking wthd element : address: %s, deadline: %d, propertyId: %d, amount: %d \n", wthd.address, wthd.deadline_block, wthd.propertyId, wthd.amount);
 
     withdrawal_Map[receiver].push_back(wthd);
+    ScheduleBlockEvent(BLOCK_EVENT_WITHDRAWAL, wthd.deadline_block, receiver);
 
     pDbTradeList->recordNewWithdrawal(txid, receiver, sender, propertyId, amount_to_withdraw, block, tx_idx);
 
@@ -3848,7 +3759,7 @@ int CMPTransaction::logicMath_Instant_Trade()
 {
   int rc = 0;
 
-  if (!IsTransactionTypeAllowed(block, property, type, version)) {
+  if (!IsTypeAllowed(property)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
               __func__,
               type,
@@ -3967,7 +3878,7 @@ int CMPTransaction::logicMath_Contract_Instant()
   int rc = 0;
 
 
-  if (!IsTransactionTypeAllowed(block, property, type, version)) {
+  if (!IsTypeAllowed(property)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
               __func__,
               type,
@@ -4031,8 +3942,7 @@ int CMPTransaction::logicMath_Contract_Instant()
   rational_t conv = rational_t(1,1);
   int64_t num = conv.numerator().convert_to<int64_t>();
   int64_t den = conv.denominator().convert_to<int64_t>();
-  arith_uint256 amountTR = (ConvertTo256(instant_amount)*ConvertTo256(marginRe)*ConvertTo256(num))/(ConvertTo256(den)*ConvertTo256(ileverage));
-  int64_t amountToReserve = ConvertTo64(amountTR);
+  int64_t amountToReserve = MulMulDiv(instant_amount, marginRe, num, den, ileverage);
 
   if(msc_debug_contract_instant_trade) PrintToLog("%s: AmountToReserve: %d, channel Balance: %d\n", __func__, amountToReserve,nBalance);
 
@@ -4058,8 +3968,8 @@ int CMPTransaction::logicMath_Contract_Instant()
       if (amountToReserve > 0)
        {
            assert(update_tally_map(sender, colateralh, -amountToReserve, CHANNEL_RESERVE));
-           assert(update_tally_map(chnAddrs.first, colateralh, ConvertTo64(amountTR), CONTRACTDEX_MARGIN));
-           assert(update_tally_map(chnAddrs.second, colateralh, ConvertTo64(amountTR), CONTRACTDEX_MARGIN));
+           assert(update_tally_map(chnAddrs.first, colateralh, amountToReserve, CONTRACTDEX_MARGIN));
+           assert(update_tally_map(chnAddrs.second, colateralh, amountToReserve, CONTRACTDEX_MARGIN));
        }
   }
 
@@ -4105,18 +4015,12 @@ int CMPTransaction::logicMath_Contract_Instant()
 int CMPTransaction::logicMath_New_Id_Registration()
 {
   uint256 blockHash;
-  {
-      LOCK(cs_main);
-
-      CBlockIndex* pindex = chainActive[block];
-      if (pindex == NULL) {
-          PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-          return (PKT_ERROR_TOKENS -20);
-      }
-      blockHash = pindex->GetBlockHash();
+  if (!GetBlockHash(blockHash)) {
+      PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+      return (PKT_ERROR_TOKENS -20);
   }
 
-  if (!IsTransactionTypeAllowed(block, property, type, version)) {
+  if (!IsTypeAllowed(property)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
               __func__,
               type,
@@ -4140,18 +4044,12 @@ int CMPTransaction::logicMath_New_Id_Registration()
 int CMPTransaction::logicMath_Update_Id_Registration()
 {
   uint256 blockHash;
-  {
-      LOCK(cs_main);
-
-      CBlockIndex* pindex = chainActive[block];
-      if (pindex == NULL) {
-          PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-          return (PKT_ERROR_TOKENS -20);
-      }
-      blockHash = pindex->GetBlockHash();
+  if (!GetBlockHash(blockHash)) {
+      PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+      return (PKT_ERROR_TOKENS -20);
   }
 
-  if (!IsTransactionTypeAllowed(block, property, type, version)) {
+  if (!IsTypeAllowed(property)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
               __func__,
               type,
@@ -4172,18 +4070,12 @@ int CMPTransaction::logicMath_Update_Id_Registration()
 int CMPTransaction::logicMath_Transfer()
 {
   uint256 blockHash;
-  {
-      LOCK(cs_main);
-
-      CBlockIndex* pindex = chainActive[block];
-      if (pindex == NULL) {
-          PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-          return (PKT_ERROR_TOKENS -20);
-      }
-      blockHash = pindex->GetBlockHash();
+  if (!GetBlockHash(blockHash)) {
+      PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+      return (PKT_ERROR_TOKENS -20);
   }
 
-  if (!IsTransactionTypeAllowed(block, property, type, version)) {
+  if (!IsTypeAllowed(property)) {
       PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
               __func__,
               type,
@@ -4217,7 +4109,7 @@ int CMPTransaction::logicMath_Transfer()
 /*Tx 21*/
 int CMPTransaction::logicMath_DExBuy()
 {
-    if (!IsTransactionTypeAllowed(block, propertyId, type, version)) {
+    if (!IsTypeAllowed(propertyId)) {
      PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
              __func__,
              type,
@@ -4322,16 +4214,9 @@ int CMPTransaction::logicMath_CreatePeggedCurrency()
     int64_t amountNeeded;
     int64_t contracts;
 
-    {
-        LOCK(cs_main);
-
-        CBlockIndex* pindex = chainActive[block];
-        if (pindex == NULL) {
-            PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
-            return (PKT_ERROR_SP -20);
-        }
-
-        blockHash = pindex->GetBlockHash();
+    if (!GetBlockHash(blockHash)) {
+        PrintToLog("%s(): ERROR: block %d not in the active chain\n", __func__, block);
+        return (PKT_ERROR_SP -20);
     }
 
     if (TL_PROPERTY_ALL != ecosystem && TL_PROPERTY_TALL != ecosystem) {
@@ -4339,7 +4224,7 @@ int CMPTransaction::logicMath_CreatePeggedCurrency()
         return (PKT_ERROR_SP -21);
     }
 
-    if (!IsTransactionTypeAllowed(block, ecosystem, type, version)) {
+    if (!IsTypeAllowed(ecosystem)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -4354,7 +4239,7 @@ int CMPTransaction::logicMath_CreatePeggedCurrency()
         return (PKT_ERROR_SP -36);
     }
 
-    if ('\0' == name[0]) {
+    if (name.empty()) {
         PrintToLog("%s(): rejected: property name must not be empty\n", __func__);
         PrintToLog("rejected: property name must not be empty\n");
         return (PKT_ERROR_SP -37);
@@ -4402,11 +4287,21 @@ int CMPTransaction::logicMath_CreatePeggedCurrency()
         den = sp.denomination;
     }
 
+    if (amount <= 0 || MAX_INT_8_BYTES < amount) {
+        PrintToLog("%s(): rejected: value out of range or zero: %d\n", __func__, amount);
+        return (PKT_ERROR_SEND -23);
+    }
+
+    // the short position must cover the amount, rounded up to whole units
+    int64_t units = 0;
+    if (!MulDivChecked(amount, notSize, factorE, units, ROUND_UP) || units > std::numeric_limits<int64_t>::max() / factorE) {
+        PrintToLog("%s(): rejected: contracts needed for %d out of range\n", __func__, amount);
+        return (PKT_ERROR_SEND -23);
+    }
+
     int64_t position = GetTokenBalance(sender, contractId, NEGATIVE_BALANCE);
-    arith_uint256 rAmount = ConvertTo256(amount); // Alls needed
-    arith_uint256 Contracts = DivideAndRoundUp(rAmount * ConvertTo256(notSize), ConvertTo256(factorE));
-    amountNeeded = ConvertTo64(rAmount);
-    contracts = ConvertTo64(Contracts * ConvertTo256(factorE));
+    amountNeeded = static_cast<int64_t>(amount); // Alls needed
+    contracts = units * factorE;
 
     if (nBalance < amountNeeded || position < contracts) {
         PrintToLog("rejected:Sender has not required short position on this contract or balance enough\n");
@@ -4451,7 +4346,7 @@ int CMPTransaction::logicMath_CreatePeggedCurrency()
         CMPSPInfo::Entry newSP;
         pDbSpInfo->getSP(npropertyId, newSP);
         int64_t inf = (newSP.num_tokens) / factorE + 1 ;
-        newSP.num_tokens += ConvertTo64(rAmount);
+        newSP.num_tokens += amountNeeded;
         int64_t sup = (newSP.num_tokens) / factorE ;
         newSP.series = strprintf("Nº %d - %d",inf,sup);
         pDbSpInfo->updateSP(npropertyId, newSP);
@@ -4528,7 +4423,7 @@ struct FutureContractObject *getFutureContractObject(uint32_t property_type, std
 
 int CMPTransaction::logicMath_SendPeggedCurrency()
 {
-    if (!IsTransactionTypeAllowed(block, propertyId, type, version)) {
+    if (!IsTypeAllowed(propertyId)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
             __func__,
             type,
@@ -4580,7 +4475,7 @@ int CMPTransaction::logicMath_SendPeggedCurrency()
 
 int CMPTransaction::logicMath_RedemptionPegged()
 {
-    if (!IsTransactionTypeAllowed(block, propertyId, type, version)) {
+    if (!IsTypeAllowed(propertyId)) {
         PrintToLog("%s(): rejected: type %d or version %d not permitted for property %d at block %d\n",
                 __func__,
                 type,
@@ -4629,8 +4524,18 @@ int CMPTransaction::logicMath_RedemptionPegged()
         }
     }
 
-    arith_uint256 conNeeded = ConvertTo256(amount) / ConvertTo256(notSize);
-    int64_t contractsNeeded = ConvertTo64(conNeeded);
+    if (notSize <= 0) {
+        PrintToLog("%s(): rejected: contract %d has no notional size\n", __func__, contractId);
+        return (PKT_ERROR_CONTRACTDEX -21);
+    }
+
+    // a zero amount redeems nothing, but is still valid
+    if (MAX_INT_8_BYTES < amount) {
+        PrintToLog("%s(): rejected: value out of range: %d\n", __func__, amount);
+        return (PKT_ERROR_SEND -23);
+    }
+
+    int64_t contractsNeeded = static_cast<int64_t>(amount) / notSize;
 
     if ((contractsNeeded > 0) && (amount > 0)) {
        // Delete the tokens
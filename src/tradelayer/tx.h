@@ -6,6 +6,11 @@ class CMPOffer;
 class CTransaction;
 class CMPContractDex;
 
+namespace mastercore
+{
+class CBlockContext;
+}
+
 #include <tradelayer/tradelayer.h>
 #include <tradelayer/parsing.h>
 
@@ -16,6 +21,7 @@ class CMPContractDex;
 #include <string.h>
 
 #include <string>
+#include <vector>
 
 using mastercore::strTransactionType;
 
@@ -30,14 +36,21 @@ class CMPTransaction
     friend class CMPContractDex;
 
 private:
+    //! The longest payload, which is interpreted
+    static const unsigned int MAX_PAYLOAD_SIZE = 1 + MAX_PACKETS * PACKET_SIZE;
+    //! Zero bytes after the payload, so fields and strings can be read past its end, as before
+    static const unsigned int PAYLOAD_PADDING = SP_STRING_FIELD_LEN;
+
     uint256 txid;
     int block;
+    const mastercore::CBlockContext* pBlockContext; // set while the logic is executed, if available
     int64_t blockTime;  // internally nTime is still an "unsigned int"
     unsigned int tx_idx;  // tx # within the block, 0-based
     uint64_t tx_fee_paid;
 
     int pkt_size;
-    unsigned char pkt[1 + MAX_PACKETS * PACKET_SIZE];
+    // the payload, followed by PAYLOAD_PADDING zero bytes
+    std::vector<unsigned char> pkt;
     int encodingClass;  // No Marker = 0, Class A = 1, Class B = 2, Class C = 3
 
     std::string sender;
@@ -65,15 +78,15 @@ private:
     // CreatePropertyFixed, CreatePropertyVariable, CreatePropertyMananged
     unsigned short prop_type;
     unsigned int prev_prop_id;
-    char category[SP_STRING_FIELD_LEN];
-    char subcategory[SP_STRING_FIELD_LEN];
-    char name[SP_STRING_FIELD_LEN];
-    char url[SP_STRING_FIELD_LEN];
-    char data[SP_STRING_FIELD_LEN];
+    std::string category;
+    std::string subcategory;
+    std::string name;
+    std::string url;
+    std::string data;
 
     /* New things for contracts */
-    char stxid[SP_STRING_FIELD_LEN];
-    char name_traded[SP_STRING_FIELD_LEN];
+    std::string stxid;
+    std::string name_traded;
 
     uint64_t deadline;
     unsigned char early_bird;
@@ -99,7 +112,7 @@ private:
     // Alert
     uint16_t alert_type;
     uint32_t alert_expiry;
-    char alert_text[SP_STRING_FIELD_LEN];
+    std::string alert_text;
 
     // Activation
     uint16_t feature_id;
@@ -125,7 +138,7 @@ private:
     uint32_t denomination;
 
     //Multisig channels
-    char channel_address[SP_STRING_FIELD_LEN];
+    std::string channel_address;
     uint64_t amount_commited;
     uint64_t amount_to_withdraw;
     uint64_t pnl_amount;
@@ -137,8 +150,8 @@ private:
 
 
     //KYC
-    char company_name[SP_STRING_FIELD_LEN];
-    char website[SP_STRING_FIELD_LEN];
+    std::string company_name;
+    std::string website;
     int block_forexpiry;
     uint8_t tokens, ltc, natives, oracles;
 
@@ -262,6 +275,8 @@ private:
      * Logic helpers
      */
     int logicHelper_CrowdsaleParticipation();
+    bool GetBlockHash(uint256& blockHash) const;
+    bool IsTypeAllowed(uint32_t txProperty) const;
 
 public:
     //! DEx and MetaDEx action values
@@ -290,7 +305,8 @@ public:
     uint64_t getFeePaid() const { return tx_fee_paid; }
     std::string getSender() const { return sender; }
     std::string getReceiver() const { return receiver; }
-    std::string getPayload() const { return HexStr(pkt, pkt + pkt_size); }
+    std::string getPayload() const { return HexStr(pkt.begin(), pkt.begin() + pkt_size); }
+    std::vector<unsigned char> getPayloadBytes() const { return std::vector<unsigned char>(pkt.begin(), pkt.begin() + pkt_size); }
     uint64_t getAmount() const { return nValue; }
     uint64_t getNewAmount() const { return nNewValue; }
     uint8_t getEcosystem() const { return ecosystem; }
@@ -329,11 +345,12 @@ public:
     {
         txid.SetNull();
         block = -1;
+        pBlockContext = nullptr;
         blockTime = 0;
         tx_idx = 0;
         tx_fee_paid = 0;
         pkt_size = 0;
-        memset(&pkt, 0, sizeof(pkt));
+        pkt.clear();
         encodingClass = 0;
         sender.clear();
         receiver.clear();
@@ -345,11 +362,11 @@ public:
         ecosystem = 0;
         prop_type = 0;
         prev_prop_id = 0;
-        memset(&category, 0, sizeof(category));
-        memset(&subcategory, 0, sizeof(subcategory));
-        memset(&name, 0, sizeof(name));
-        memset(&url, 0, sizeof(url));
-        memset(&data, 0, sizeof(data));
+        category.clear();
+        subcategory.clear();
+        name.clear();
+        url.clear();
+        data.clear();
         deadline = 0;
         early_bird = 0;
         percentage = 0;
@@ -362,7 +379,7 @@ public:
         subaction = 0;
         alert_type = 0;
         alert_expiry = 0;
-        memset(&alert_text, 0, sizeof(alert_text));
+        alert_text.clear();
         rpcOnly = true;
         feature_id = 0;
         activation_block = 0;
@@ -379,10 +396,11 @@ public:
         // timeLimit = 0;
         // denomination = 0;
 
-        memset(&name_traded, 0, sizeof(name_traded));
-        memset(&channel_address, 0, sizeof(channel_address));
-        memset(&website, 0, sizeof(website));
-        memset(&company_name, 0, sizeof(company_name));
+        stxid.clear();
+        name_traded.clear();
+        channel_address.clear();
+        website.clear();
+        company_name.clear();
 
         //Multisig channels
         amount_commited = 0;
@@ -419,19 +437,25 @@ public:
         txid = t;
         block = b;
         tx_idx = idx;
-        pkt_size = size < sizeof (pkt) ? size : sizeof (pkt);
+        pkt_size = size < MAX_PAYLOAD_SIZE ? size : MAX_PAYLOAD_SIZE;
         nValue = n;
         nNewValue = n;
         encodingClass = encodingClassIn;
         tx_fee_paid = txf;
-        memcpy(&pkt, p, pkt_size);
+        pkt.assign(p, p + pkt_size);
+        pkt.resize(pkt_size + PAYLOAD_PADDING, 0);
     }
 
     /** Parses the packet or payload. */
     bool interpret_Transaction();
 
-    /** Interprets the payload and executes the logic. */
-    int interpretPacket();
+    /**
+     * Interprets the payload and executes the logic.
+     *
+     * The context of the block, which is currently processed, is used instead
+     * of looking up the block, if it belongs to the block of the transaction.
+     */
+    int interpretPacket(const mastercore::CBlockContext* pContext = nullptr);
 
     /** Enables access of interpretPacket. */
     void unlockLogic() { rpcOnly = false; };
@@ -503,14 +527,6 @@ public:
 int64_t LosingSatoshiLongTail(int BlockNow, int64_t Reward);
 /**********************************************************************/
 
-struct oracledata
-{
-    int block;
-    int64_t high;
-    int64_t low;
-    uint32_t contractId;
-};
-
 struct withdrawalAccepted
 {
     std::string address;
@@ -32,10 +32,81 @@ namespace mastercore
 {
 //! Map of wallet balances
 static std::map<std::string, CMPTally> walletBalancesCache;
+//! Addresses, whose tallies changed since the last update
+static std::set<std::string> setDirtyAddresses;
+//! Whether the next update has to check all addresses
+static bool fCheckAllAddresses = true;
+//! Whether changed addresses are recorded, which is the case once the cache is used
+static bool fTrackDirtyAddresses = false;
+
+void WalletCacheMarkDirty(const std::string& address)
+{
+    LOCK(cs_tally);
+
+    if (fTrackDirtyAddresses && !fCheckAllAddresses) {
+        setDirtyAddresses.insert(address);
+    }
+}
+
+void WalletCacheInvalidate()
+{
+    LOCK(cs_tally);
+
+    fCheckAllAddresses = true;
+    setDirtyAddresses.clear();
+}
+
+/**
+ * Compares the tally of a wallet address with the cached one, and updates the
+ * cache, if they differ.
+ *
+ * @return True, if the cache was updated
+ */
+static bool UpdateCachedTally(const std::string& address, CMPTally& tally)
+{
+    // determine if this address is in the wallet
+    int addressIsMine = IsMyAddressAllWallets(address, true);
+    if (!addressIsMine) {
+        if (msc_debug_walletcache) PrintToLog("WALLETCACHE: Ignoring non-wallet address %s\n", address);
+        return false; // ignore this address, not in wallet
+    }
+
+    // init the tally
+    tally.init();
+
+    // check cache for miss on address
+    std::map<std::string, CMPTally>::iterator search_it = walletBalancesCache.find(address);
+    if (search_it == walletBalancesCache.end()) { // cache miss, new address
+        walletBalancesCache.insert(std::make_pair(address,tally));
+        if (msc_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s not in cache\n", address);
+        return true;
+    }
+
+    // check cache for miss on balance - TODO TRY AND OPTIMIZE THIS
+    CMPTally &cacheTally = search_it->second;
+    uint32_t propertyId;
+    while (0 != (propertyId = (tally.next()))) {
+        if (tally.getMoney(propertyId, BALANCE) != cacheTally.getMoney(propertyId, BALANCE) ||
+                tally.getMoney(propertyId, PENDING) != cacheTally.getMoney(propertyId, PENDING) ||
+                tally.getMoney(propertyId, SELLOFFER_RESERVE) != cacheTally.getMoney(propertyId, SELLOFFER_RESERVE) ||
+                tally.getMoney(propertyId, ACCEPT_RESERVE) != cacheTally.getMoney(propertyId, ACCEPT_RESERVE) ||
+                tally.getMoney(propertyId, METADEX_RESERVE) != cacheTally.getMoney(propertyId, METADEX_RESERVE)) { // cache miss, balance
+            walletBalancesCache.erase(search_it);
+            walletBalancesCache.insert(std::make_pair(address,tally));
+            if (msc_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s balance for property %d differs\n", address, propertyId);
+            return true;
+        }
+    }
+
+    return false;
+}
 
 /**
  * Updates the cache with the latest state, returning true if changes were made to wallet addresses (including watch only).
  *
+ * Only the addresses, whose tallies changed since the last update, are checked,
+ * unless the state was invalidated.
+ *
  * Also prepares a list of addresses that were changed (for future usage).
  */
 int WalletCacheUpdate()
@@ -46,48 +117,28 @@ int WalletCacheUpdate()
 
     LOCK(cs_tally);
 
-    for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        const std::string& address = my_it->first;
-
-        // determine if this address is in the wallet
-        int addressIsMine = IsMyAddressAllWallets(address, true);
-        if (!addressIsMine) {
-            if (msc_debug_walletcache) PrintToLog("WALLETCACHE: Ignoring non-wallet address %s\n", address);
-            continue; // ignore this address, not in wallet
-        }
-
-        // obtain & init the tally
-        CMPTally& tally = my_it->second;
-        tally.init();
-
-        // check cache for miss on address
-        std::map<std::string, CMPTally>::iterator search_it = walletBalancesCache.find(address);
-        if (search_it == walletBalancesCache.end()) { // cache miss, new address
-            ++numChanges;
-            changedAddresses.insert(address);
-            walletBalancesCache.insert(std::make_pair(address,tally));
-            if (msc_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s not in cache\n", address);
-            continue;
+    if (fCheckAllAddresses) {
+        for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+            if (UpdateCachedTally(my_it->first, my_it->second)) {
+                ++numChanges;
+                changedAddresses.insert(my_it->first);
+            }
         }
-
-        // check cache for miss on balance - TODO TRY AND OPTIMIZE THIS
-        CMPTally &cacheTally = search_it->second;
-        uint32_t propertyId;
-        while (0 != (propertyId = (tally.next()))) {
-            if (tally.getMoney(propertyId, BALANCE) != cacheTally.getMoney(propertyId, BALANCE) ||
-                    tally.getMoney(propertyId, PENDING) != cacheTally.getMoney(propertyId, PENDING) ||
-                    tally.getMoney(propertyId, SELLOFFER_RESERVE) != cacheTally.getMoney(propertyId, SELLOFFER_RESERVE) ||
-                    tally.getMoney(propertyId, ACCEPT_RESERVE) != cacheTally.getMoney(propertyId, ACCEPT_RESERVE) ||
-                    tally.getMoney(propertyId, METADEX_RESERVE) != cacheTally.getMoney(propertyId, METADEX_RESERVE)) { // cache miss, balance
+    } else {
+        for (std::set<std::string>::const_iterator it = setDirtyAddresses.begin(); it != setDirtyAddresses.end(); ++it) {
+            std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(*it);
+            if (my_it == mp_tally_map.end()) continue;
+            if (UpdateCachedTally(my_it->first, my_it->second)) {
                 ++numChanges;
-                changedAddresses.insert(address);
-                walletBalancesCache.erase(search_it);
-                walletBalancesCache.insert(std::make_pair(address,tally));
-                if (msc_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s balance for property %d differs\n", address, propertyId);
-                break;
+                changedAddresses.insert(my_it->first);
             }
         }
     }
+
+    setDirtyAddresses.clear();
+    fCheckAllAddresses = false;
+    fTrackDirtyAddresses = true;
+
     if (msc_debug_walletcache) PrintToLog("WALLETCACHE: Update finished - there were %d changes\n", numChanges);
     return numChanges;
 }
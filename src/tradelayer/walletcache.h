@@ -3,12 +3,17 @@
 
 class uint256;
 
+#include <string>
 #include <vector>
 
 namespace mastercore
 {
 /** Updates the cache and returns whether any wallet addresses were changed */
 int WalletCacheUpdate();
+/** Records that the tally of an address changed, so the next update checks it */
+void WalletCacheMarkDirty(const std::string& address);
+/** Lets the next update check all addresses, used when the tally map is rebuilt */
+void WalletCacheInvalidate();
 }
 
 #endif // BITCOIN_TRADELAYER_WALLETCACHE_H
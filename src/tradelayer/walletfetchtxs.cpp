@@ -3,23 +3,34 @@
  *
  * The fetch functions provide a sorted list of transaction hashes ordered by block,
  * position in block and position in wallet including STO receipts.
+ *
+ * The Trade Layer transactions and STO receipts of the wallets are kept in an
+ * index, ordered by block and position in block, which is updated while
+ * transactions are processed, so the latest transactions can be listed
+ * without a pass over the whole wallet and the whole STO database. A wallet
+ * is indexed again, after keys or scripts were imported, or it was rescanned.
  */
 
 #include <tradelayer/walletfetchtxs.h>
 
 #include <tradelayer/dbstolist.h>
+#include <tradelayer/dbtransaction.h>
 #include <tradelayer/dbtxlist.h>
 #include <tradelayer/log.h>
 #include <tradelayer/tradelayer.h>
 #include <tradelayer/pending.h>
 #include <tradelayer/utilsbitcoin.h>
+#include <tradelayer/walletutils.h>
 
 #include <init.h>
+#include <interfaces/handler.h>
 #include <interfaces/wallet.h>
+#include <key_io.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
 #include <validation.h>
 #include <sync.h>
 #include <tinyformat.h>
-#include <index/txindex.h>
 #ifdef ENABLE_WALLET
 #include <wallet/wallet.h>
 #endif
@@ -27,8 +38,10 @@
 #include <boost/algorithm/string.hpp>
 
 #include <stdint.h>
+#include <algorithm>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
@@ -36,60 +49,211 @@
 
 namespace mastercore
 {
+namespace
+{
+/** A Trade Layer transaction or STO receipt of a wallet. */
+struct WalletTxIndexEntry
+{
+    int block;
+    uint32_t position;
+    //! The receiving address of an STO receipt, or empty for transactions
+    std::string receiver;
+    uint256 txid;
+
+    WalletTxIndexEntry(int blockIn, uint32_t positionIn, const std::string& receiverIn = "", const uint256& txidIn = uint256())
+        : block(blockIn), position(positionIn), receiver(receiverIn), txid(txidIn) {}
+
+    bool operator<(const WalletTxIndexEntry& other) const
+    {
+        if (block != other.block) return block < other.block;
+        if (position != other.position) return position < other.position;
+        return receiver < other.receiver;
+    }
+};
+}
+
+//! Guards the index of wallet transactions
+static CCriticalSection cs_wallet_tx_index;
+//! Trade Layer transactions and STO receipts of the wallets, ordered by block and position in block
+static std::set<WalletTxIndexEntry> setWalletTxIndex GUARDED_BY(cs_wallet_tx_index);
+//! Wallets, whose earlier transactions and STO receipts were added to the index
+static std::set<std::string> setIndexedWallets GUARDED_BY(cs_wallet_tx_index);
+#ifdef ENABLE_WALLET
+//! Number of changes per wallet, which require to index the wallet again
+static std::map<std::string, int> mapWalletChanges GUARDED_BY(cs_wallet_tx_index);
+//! Handlers of the wallet notifications, which require to index a wallet again
+static std::map<std::string, std::vector<std::unique_ptr<interfaces::Handler> > > mapWalletHandlers GUARDED_BY(cs_wallet_tx_index);
+#endif
+
 /**
- * Gets the byte offset of a transaction from the transaction index.
+ * Adds a Trade Layer transaction to the index, if the sender or an output
+ * belongs to a wallet.
  */
-static unsigned int GetTransactionByteOffset(const uint256& txid)
+void WalletTxIndexAdd(const CTransaction& tx, int block, uint32_t position, const std::string& sender)
 {
-    LOCK(cs_main);
+#ifdef ENABLE_WALLET
+    if (!HasWallets()) {
+        return;
+    }
 
-    if (g_txindex) {
-        return g_txindex->ReadTxPos(txid);
+    bool fMine = !sender.empty() && IsMyAddressAllWallets(sender, true);
+    for (unsigned int n = 0; !fMine && n < tx.vout.size(); ++n) {
+        CTxDestination dest;
+        if (ExtractDestination(tx.vout[n].scriptPubKey, dest)) {
+            fMine = IsMyAddressAllWallets(EncodeDestination(dest), true);
+        }
+    }
+    if (!fMine) {
+        return;
     }
 
-    return 0;
+    LOCK(cs_wallet_tx_index);
+    setWalletTxIndex.insert(WalletTxIndexEntry(block, position, "", tx.GetHash()));
+#endif
 }
 
 /**
- * Returns an ordered list of Tradelayer transactions including STO receipts that are relevant to the wallet.
- *
- * Ignores order in the wallet (which can be skewed by watch addresses) and utilizes block height and position within block.
+ * Adds the STO receipts of wallet addresses to the index.
  */
-std::map<std::string, uint256> FetchWalletTLTransactions(interfaces::Wallet& iWallet, unsigned int count, int startBlock, int endBlock)
+void WalletTxIndexAddSTOReceipts(const uint256& txid, int block, uint32_t position, const OwnerAddrType& receivers)
 {
-    std::map<std::string, uint256> mapResponse;
 #ifdef ENABLE_WALLET
     if (!HasWallets()) {
-        return mapResponse;
+        return;
     }
-    std::set<uint256> seenHashes;
-    std::multimap<int64_t, const interfaces::WalletTx*> txOrdered;
-    const std::vector<interfaces::WalletTx>& transactions = iWallet.getWalletTxs();
-    for (const auto& transaction : transactions)
-        txOrdered.insert(std::make_pair(transaction.order_pos, &transaction));
 
-    // Iterate backwards through wallet transactions until we have count items to return:
-    for (std::multimap<int64_t, const interfaces::WalletTx*>::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
-        const interfaces::WalletTx* pwtx = it->second;
-        const uint256& txHash = pwtx->tx->GetHash();
+    std::vector<std::string> vReceivers;
+    for (OwnerAddrType::const_iterator it = receivers.begin(); it != receivers.end(); ++it) {
+        if (IsMyAddressAllWallets(it->second, true)) {
+            vReceivers.push_back(it->second);
+        }
+    }
+
+    LOCK(cs_wallet_tx_index);
+    for (std::vector<std::string>::const_iterator it = vReceivers.begin(); it != vReceivers.end(); ++it) {
+        setWalletTxIndex.insert(WalletTxIndexEntry(block, position, *it, txid));
+    }
+#endif
+}
+
+/**
+ * Removes the indexed transactions at or above the given block.
+ */
+void WalletTxIndexDeleteAboveBlock(int block)
+{
+    LOCK(cs_wallet_tx_index);
+    setWalletTxIndex.erase(setWalletTxIndex.lower_bound(WalletTxIndexEntry(block, 0)), setWalletTxIndex.end());
+}
+
+/**
+ * Clears the index, the wallets are indexed again on the next request.
+ */
+void WalletTxIndexClear()
+{
+    LOCK(cs_wallet_tx_index);
+    setWalletTxIndex.clear();
+    setIndexedWallets.clear();
+}
+
+#ifdef ENABLE_WALLET
+/**
+ * Marks a wallet to be indexed again on the next request.
+ */
+static void WalletTxIndexInvalidate(const std::string& walletName)
+{
+    LOCK(cs_wallet_tx_index);
+    setIndexedWallets.erase(walletName);
+    ++mapWalletChanges[walletName];
+}
+
+/**
+ * Removes a wallet, which is unloaded, from the indexed wallets, and
+ * disconnects its handlers.
+ */
+static void WalletTxIndexUnload(const std::string& walletName)
+{
+    std::vector<std::unique_ptr<interfaces::Handler> > vHandlers;
+    {
+        LOCK(cs_wallet_tx_index);
+        setIndexedWallets.erase(walletName);
+        ++mapWalletChanges[walletName];
+        std::map<std::string, std::vector<std::unique_ptr<interfaces::Handler> > >::iterator it = mapWalletHandlers.find(walletName);
+        if (it != mapWalletHandlers.end()) {
+            vHandlers.swap(it->second);
+            mapWalletHandlers.erase(it);
+        }
+    }
+}
+
+/**
+ * Registers the handlers, which mark a wallet to be indexed again.
+ *
+ * Imported keys, addresses and scripts are added to the address book, and
+ * earlier transactions are added by a rescan, which reports its completion.
+ */
+static void RegisterWalletHandlers(interfaces::Wallet& iWallet, const std::string& walletName)
+{
+    std::vector<std::unique_ptr<interfaces::Handler> > vHandlers;
+    vHandlers.push_back(iWallet.handleAddressBookChanged([walletName](const CTxDestination& address,
+            const std::string& label, bool is_mine, const std::string& purpose, ChangeType status) {
+        if (status != CT_DELETED) WalletTxIndexInvalidate(walletName);
+    }));
+    vHandlers.push_back(iWallet.handleWatchOnlyChanged([walletName](bool have_watch_only) {
+        WalletTxIndexInvalidate(walletName);
+    }));
+    vHandlers.push_back(iWallet.handleShowProgress([walletName](const std::string& title, int progress) {
+        if (progress == 100) WalletTxIndexInvalidate(walletName);
+    }));
+    vHandlers.push_back(iWallet.handleUnload([walletName]() {
+        WalletTxIndexUnload(walletName);
+    }));
+
+    LOCK(cs_wallet_tx_index);
+    if (mapWalletHandlers.count(walletName) == 0) {
+        mapWalletHandlers[walletName].swap(vHandlers);
+    }
+}
+
+/**
+ * Adds the Trade Layer transactions and STO receipts of a wallet, which is
+ * not yet indexed, to the index.
+ *
+ * This requires a pass over the wallet and the STO database, which is only
+ * done once per wallet, until keys or scripts are imported, or the wallet is
+ * rescanned; later transactions are added while they are processed.
+ */
+static void IndexWallet(interfaces::Wallet& iWallet)
+{
+    const std::string walletName = iWallet.getWalletName();
+    int nChanges = 0;
+    bool fRegister = false;
+    {
+        LOCK(cs_wallet_tx_index);
+        if (setIndexedWallets.count(walletName)) return;
+        nChanges = mapWalletChanges[walletName];
+        fRegister = (mapWalletHandlers.count(walletName) == 0);
+    }
+    if (fRegister) {
+        RegisterWalletHandlers(iWallet, walletName);
+    }
+
+    std::vector<WalletTxIndexEntry> vEntries;
+
+    const std::vector<interfaces::WalletTx>& transactions = iWallet.getWalletTxs();
+    for (const auto& transaction : transactions) {
+        const uint256& txHash = transaction.tx->GetHash();
+        const uint256& blockHash = transaction.hash_block;
+        if (blockHash.IsNull()) continue;
         {
             LOCK(cs_tally);
             if (!pDbTransactionList->exists(txHash)) continue;
         }
-        const uint256& blockHash = pwtx->hash_block;
-        if (blockHash.IsNull()) continue;
         const CBlockIndex* pBlockIndex = GetBlockIndex(blockHash);
         if (pBlockIndex == nullptr) continue;
-        int blockHeight = pBlockIndex->nHeight;
-        if (blockHeight < startBlock || blockHeight > endBlock) continue;
-        int blockPosition = GetTransactionByteOffset(txHash);
-        std::string sortKey = strprintf("%06d%010d", blockHeight, blockPosition);
-        mapResponse.insert(std::make_pair(sortKey, txHash));
-        seenHashes.insert(txHash);
-        if (mapResponse.size() >= count) break;
+        vEntries.push_back(WalletTxIndexEntry(pBlockIndex->nHeight, pDbTransaction->FetchTransactionPosition(txHash), "", txHash));
     }
 
-    // Insert STO receipts - receiving an STO has no inbound transaction to the wallet, so we will insert these manually into the response
+    // Insert STO receipts - receiving an STO has no inbound transaction to the wallet
     std::string mySTOReceipts;
     {
         LOCK(cs_tally);
@@ -100,19 +264,65 @@ std::map<std::string, uint256> FetchWalletTLTransactions(interfaces::Wallet& iWa
         boost::split(vecReceipts, mySTOReceipts, boost::is_any_of(","), boost::token_compress_on);
     }
     for (size_t i = 0; i < vecReceipts.size(); i++) {
+        // "txid:block:address:property"
         std::vector<std::string> svstr;
         boost::split(svstr, vecReceipts[i], boost::is_any_of(":"), boost::token_compress_on);
         if (svstr.size() != 4) {
             PrintToLog("STODB Error - number of tokens is not as expected (%s)\n", vecReceipts[i]);
             continue;
         }
-        int blockHeight = atoi(svstr[1]);
-        if (blockHeight < startBlock || blockHeight > endBlock) continue;
         uint256 txHash = uint256S(svstr[0]);
-        if (seenHashes.find(txHash) != seenHashes.end()) continue; // an STO may already be in the wallet if we sent it
-        int blockPosition = GetTransactionByteOffset(txHash);
-        std::string sortKey = strprintf("%06d%010d", blockHeight, blockPosition);
-        mapResponse.insert(std::make_pair(sortKey, txHash));
+        vEntries.push_back(WalletTxIndexEntry(atoi(svstr[1]), pDbTransaction->FetchTransactionPosition(txHash), svstr[2], txHash));
+    }
+
+    LOCK(cs_wallet_tx_index);
+    setWalletTxIndex.insert(vEntries.begin(), vEntries.end());
+    // the wallet changed during the pass, so it's indexed again on the next request
+    if (mapWalletChanges[walletName] == nChanges) {
+        setIndexedWallets.insert(walletName);
+    }
+}
+#endif
+
+/**
+ * Returns an ordered list of Tradelayer transactions including STO receipts that are relevant to the wallet.
+ *
+ * Ignores order in the wallet (which can be skewed by watch addresses) and utilizes block height and position within block.
+ */
+std::map<std::string, uint256> FetchWalletTLTransactions(interfaces::Wallet& iWallet, unsigned int count, int startBlock, int endBlock)
+{
+    std::map<std::string, uint256> mapResponse;
+#ifdef ENABLE_WALLET
+    if (!HasWallets()) {
+        return mapResponse;
+    }
+
+    IndexWallet(iWallet);
+
+    // Iterate backwards through the index in chunks, so the index isn't locked while the wallet is queried
+    const size_t nChunkSize = std::max(count, 10U);
+    bool fDone = false;
+    WalletTxIndexEntry cursor(endBlock + 1, 0);
+    while (!fDone && mapResponse.size() < count) {
+        std::vector<WalletTxIndexEntry> vEntries;
+        {
+            LOCK(cs_wallet_tx_index);
+            std::set<WalletTxIndexEntry>::const_iterator it = setWalletTxIndex.lower_bound(cursor);
+            while (vEntries.size() < nChunkSize && it != setWalletTxIndex.begin()) {
+                --it;
+                if (it->block < startBlock) break;
+                vEntries.push_back(*it);
+            }
+            fDone = (vEntries.size() < nChunkSize);
+        }
+        if (!vEntries.empty()) cursor = vEntries.back();
+
+        for (std::vector<WalletTxIndexEntry>::const_iterator it = vEntries.begin(); it != vEntries.end() && mapResponse.size() < count; ++it) {
+            // the index covers all wallets
+            if (it->receiver.empty() ? !iWallet.getTx(it->txid) : !IsMyAddress(it->receiver, &iWallet)) continue;
+            std::string sortKey = strprintf("%06d%010d", it->block, it->position);
+            mapResponse.insert(std::make_pair(sortKey, it->txid));
+        }
     }
 
     // Insert pending transactions (sets block as 999999 and position as wallet position)
@@ -123,11 +333,8 @@ std::map<std::string, uint256> FetchWalletTLTransactions(interfaces::Wallet& iWa
         int blockHeight = 999999;
         if (blockHeight < startBlock || blockHeight > endBlock) continue;
         int blockPosition = 0;
-        {
-            for (const auto& transaction : transactions)
-                if (transaction.tx->GetHash() == txHash)
-                    blockPosition = transaction.order_pos;
-        }
+        const interfaces::WalletTx transaction = iWallet.getWalletTx(txHash);
+        if (transaction.tx) blockPosition = transaction.order_pos;
         std::string sortKey = strprintf("%06d%010d", blockHeight, blockPosition);
         mapResponse.insert(std::make_pair(sortKey, txHash));
     }
@@ -1,6 +1,7 @@
 #ifndef BITCOIN_TRADELAYER_WALLETFETCHTXS_H
 #define BITCOIN_TRADELAYER_WALLETFETCHTXS_H
 
+class CTransaction;
 class CWallet;
 class uint256;
 
@@ -8,6 +9,9 @@ namespace interfaces {
 class Wallet;
 } // namespace interfaces
 
+#include <tradelayer/sto.h>
+
+#include <stdint.h>
 #include <map>
 #include <string>
 
@@ -15,6 +19,15 @@ namespace mastercore
 {
 /** Returns an ordered list of Trade Layer transactions that are relevant to the wallet. */
 std::map<std::string, uint256> FetchWalletTLTransactions(interfaces::Wallet& iWallet, unsigned int count, int startBlock = 0, int endBlock = 999999);
+
+/** Adds a processed Trade Layer transaction to the index of wallet transactions, if the sender or an output belongs to a wallet. */
+void WalletTxIndexAdd(const CTransaction& tx, int block, uint32_t position, const std::string& sender);
+/** Adds the STO receipts of wallet addresses to the index of wallet transactions. */
+void WalletTxIndexAddSTOReceipts(const uint256& txid, int block, uint32_t position, const OwnerAddrType& receivers);
+/** Removes the indexed transactions at or above the given block, used for rollbacks. */
+void WalletTxIndexDeleteAboveBlock(int block);
+/** Clears the index of wallet transactions. */
+void WalletTxIndexClear();
 }
 
 #endif // BITCOIN_TRADELAYER_WALLETFETCHTXS_H
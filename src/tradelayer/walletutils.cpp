@@ -214,60 +214,35 @@ int64_t SelectCoins(interfaces::Wallet& iWallet, const std::string& fromAddress,
     // if referenceamount is set it is needed to be accounted for here too
     if (0 < additional) nMax += additional;
 
-    std::map<uint256, interfaces::WalletTxStatus> tx_status;
-    const std::vector<interfaces::WalletTx>& transactions = iWallet.getWalletTxsDetails(tx_status);
+    // only use funds from the sender's address
+    CTxDestination fromDest = DecodeDestination(fromAddress);
+    if (!IsValidDestination(fromDest) || !iWallet.isMine(fromDest)) {
+        return nTotal;
+    }
 
-    // iterate over the wallet
-    for (std::vector<interfaces::WalletTx>::const_iterator it = transactions.begin(); it != transactions.end(); ++it) {
-        const CTransactionRef tx = it->tx;
-        const uint256& txid = tx->GetHash();
+    // iterate over the unspent outputs of the sender, taken from the wallet's address index
+    const std::vector<std::pair<COutPoint, CTxOut> > outputs = iWallet.getAddressOutputs(fromDest);
+    for (std::vector<std::pair<COutPoint, CTxOut> >::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
+        const COutPoint& outpoint = it->first;
+        const CTxOut& txOut = it->second;
 
-        auto status = tx_status.find(txid);
-        if (status == tx_status.end() || !status->second.is_trusted) {
+        CTxDestination dest;
+        if (!CheckInput(txOut, nHeight, dest)) {
             continue;
         }
-
-        if (!it->available_credit) {
+        if (txOut.nValue < GetEconomicThreshold(iWallet, txOut)) {
+            if (msc_debug_tokens)
+                PrintToLog("%s: output value below economic threshold: %s:%d, value: %d\n",
+                        __func__, outpoint.hash.GetHex(), outpoint.n, txOut.nValue);
             continue;
         }
 
-        for (unsigned int n = 0; n < tx->vout.size(); n++) {
-            const CTxOut& txOut = tx->vout[n];
-
-            CTxDestination dest;
-            if (!CheckInput(txOut, nHeight, dest)) {
-                continue;
-            }
-            if (!iWallet.isMine(dest)) {
-                continue;
-            }
-            if (iWallet.isSpent(txid, n)) {
-                continue;
-            }
-            if (iWallet.isLockedCoin(COutPoint(txid, n))) {
-                continue;
-            }
-            if (txOut.nValue < GetEconomicThreshold(iWallet, txOut)) {
-                if (msc_debug_tokens)
-                    PrintToLog("%s: output value below economic threshold: %s:%d, value: %d\n",
-                            __func__, txid.GetHex(), n, txOut.nValue);
-                continue;
-            }
-
-            std::string sAddress = EncodeDestination(dest);
-            if (msc_debug_tokens)
-                PrintToLog("%s: sender: %s, outpoint: %s:%d, value: %d\n", __func__, sAddress, txid.GetHex(), n, txOut.nValue);
-
-            // only use funds from the sender's address
-            if (fromAddress == sAddress) {
-                COutPoint outpoint(txid, n);
-                coinControl.Select(outpoint);
+        if (msc_debug_tokens)
+            PrintToLog("%s: sender: %s, outpoint: %s:%d, value: %d\n", __func__, fromAddress, outpoint.hash.GetHex(), outpoint.n, txOut.nValue);
 
-                nTotal += txOut.nValue;
+        coinControl.Select(outpoint);
 
-                if (nMax <= nTotal) break;
-            }
-        }
+        nTotal += txOut.nValue;
 
         if (nMax <= nTotal) break;
     }
@@ -281,53 +256,30 @@ int64_t SelectAllCoins(interfaces::Wallet& iWallet, const std::string& fromAddre
     int64_t nTotal = 0;
     int nHeight = chainActive.Height();
 
-    std::map<uint256, interfaces::WalletTxStatus> tx_status;
-    const std::vector<interfaces::WalletTx>& transactions = iWallet.getWalletTxsDetails(tx_status);
+    // only use funds from the sender's address
+    CTxDestination fromDest = DecodeDestination(fromAddress);
+    if (!IsValidDestination(fromDest) || !iWallet.isSpendable(fromDest)) {
+        return nTotal;
+    }
 
-    // iterate over the wallet
-    for (std::vector<interfaces::WalletTx>::const_iterator it = transactions.begin(); it != transactions.end(); ++it) {
-        const CTransactionRef tx = it->tx;
-        const uint256& txid = tx->GetHash();
+    // iterate over the unspent outputs of the sender, taken from the wallet's address index
+    const std::vector<std::pair<COutPoint, CTxOut> > outputs = iWallet.getAddressOutputs(fromDest);
+    for (std::vector<std::pair<COutPoint, CTxOut> >::const_iterator it = outputs.begin(); it != outputs.end(); ++it) {
+        const COutPoint& outpoint = it->first;
+        const CTxOut& txOut = it->second;
 
-        auto status = tx_status.find(txid);
-        if (status == tx_status.end() || !status->second.is_trusted) {
+        CTxDestination dest;
+        if (!CheckInput(txOut, nHeight, dest)) {
             continue;
         }
 
-        if (!it->available_credit) {
-            continue;
+        if (msc_debug_tokens) {
+            PrintToLog("%s: sender: %s, outpoint: %s:%d, value: %d\n", __func__, fromAddress, outpoint.hash.GetHex(), outpoint.n, txOut.nValue);
         }
 
-        for (unsigned int n = 0; n < tx->vout.size(); n++) {
-            const CTxOut& txOut = tx->vout[n];
-
-            CTxDestination dest;
-            if (!CheckInput(txOut, nHeight, dest)) {
-                continue;
-            }
-            if (!iWallet.isSpendable(dest)) {
-                continue;
-            }
-            if (iWallet.isSpent(txid, n)) {
-                continue;
-            }
-            if (iWallet.isLockedCoin(COutPoint(txid, n))) {
-                continue;
-            }
-
-            std::string sAddress = EncodeDestination(dest);
-            if (msc_debug_tokens) {
-                PrintToLog("%s: sender: %s, outpoint: %s:%d, value: %d\n", __func__, sAddress, txid.GetHex(), n, txOut.nValue);
-            }
-
-            // only use funds from the sender's address
-            if (fromAddress == sAddress) {
-                COutPoint outpoint(txid, n);
-                coinControl.Select(outpoint);
-
-                nTotal += txOut.nValue;
-            }
-        }
+        coinControl.Select(outpoint);
+
+        nTotal += txOut.nValue;
     }
 
     return nTotal;
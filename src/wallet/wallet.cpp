@@ -724,6 +724,45 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+void CWallet::AddToAddressIndex(const CWalletTx& wtx)
+{
+    const uint256& hash = wtx.GetHash();
+    for (unsigned int n = 0; n < wtx.tx->vout.size(); n++) {
+        CTxDestination dest;
+        if (ExtractDestination(wtx.tx->vout[n].scriptPubKey, dest)) {
+            mapAddressOutputs[dest].insert(COutPoint(hash, n));
+        }
+    }
+}
+
+std::vector<std::pair<COutPoint, CTxOut>> CWallet::GetAddressOutputs(interfaces::Chain::Lock& locked_chain, const CTxDestination& dest) const
+{
+    AssertLockHeld(cs_wallet);
+
+    std::vector<std::pair<COutPoint, CTxOut>> outputs;
+    auto it = mapAddressOutputs.find(dest);
+    if (it == mapAddressOutputs.end()) {
+        return outputs;
+    }
+
+    for (const COutPoint& outpoint : it->second) {
+        auto mi = mapWallet.find(outpoint.hash);
+        if (mi == mapWallet.end()) {
+            continue;
+        }
+        const CWalletTx& wtx = mi->second;
+        if (wtx.IsImmatureCoinBase(locked_chain) || !wtx.IsTrusted(locked_chain, true)) {
+            continue;
+        }
+        if (IsSpent(locked_chain, outpoint.hash, outpoint.n) || IsLockedCoin(outpoint.hash, outpoint.n)) {
+            continue;
+        }
+        outputs.emplace_back(outpoint, wtx.tx->vout[outpoint.n]);
+    }
+
+    return outputs;
+}
+
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
     if (IsCrypted())
@@ -946,6 +985,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
         wtx.nTimeSmart = ComputeTimeSmart(wtx);
         AddToSpends(hash);
+        AddToAddressIndex(wtx);
     }
 
     bool fUpdated = false;
@@ -1019,6 +1059,7 @@ void CWallet::LoadToWallet(const CWalletTx& wtxIn)
     wtx.BindWallet(this);
     if (/* insertion took place */ ins.second) {
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
+        AddToAddressIndex(wtx);
     }
     AddToSpends(hash);
     for (const CTxIn& txin : wtx.tx->vin) {
@@ -670,6 +670,14 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void AddToSpends(const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /**
+     * Outputs of wallet transactions, indexed by destination, so the coins of
+     * an address can be found without a pass over the whole wallet. Entries are
+     * only added; spent outputs and removed transactions are filtered on lookup.
+     */
+    std::map<CTxDestination, std::set<COutPoint>> mapAddressOutputs GUARDED_BY(cs_wallet);
+    void AddToAddressIndex(const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /**
      * Add a transaction to the wallet, or update it.  pIndex and posInBlock should
      * be set when the transaction was known to be included in a block.  When
@@ -846,6 +854,12 @@ public:
     bool IsSpent(interfaces::Chain::Lock& locked_chain, const uint256& hash, unsigned int n) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     std::vector<OutputGroup> GroupOutputs(const std::vector<COutput>& outputs, bool single_coin) const;
 
+    /**
+     * Returns the unspent and unlocked outputs of trusted, mature wallet
+     * transactions, which pay to the destination, ordered by outpoint.
+     */
+    std::vector<std::pair<COutPoint, CTxOut>> GetAddressOutputs(interfaces::Chain::Lock& locked_chain, const CTxDestination& dest) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     bool IsLockedCoin(uint256 hash, unsigned int n) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void LockCoin(const COutPoint& output) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void UnlockCoin(const COutPoint& output) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);